@@ -0,0 +1,27 @@
+# Generates a C header embedding every shader in SHADER_DIR as a
+# NUL-terminated string, used when no shader directory is found at runtime.
+#   cmake -DSHADER_DIR=<dir> -DOUTPUT=<header> -P EmbedShaders.cmake
+
+file(GLOB shader_files RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*.vert ${SHADER_DIR}/*.frag)
+list(SORT shader_files)
+
+set(body "// Generated from shaders/ by cmake/EmbedShaders.cmake. Do not edit.\n")
+set(table "")
+set(index 0)
+foreach(name ${shader_files})
+    file(READ ${SHADER_DIR}/${name} hex HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    set(body "${body}static const char embedded_shader_${index}[] = { ${bytes}0x00 };\n")
+    set(table "${table}    { \"${name}\", embedded_shader_${index} },\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+set(body "${body}\nstatic const struct { const char *name; const char *source; } embedded_shaders[] = {\n${table}};\n")
+
+# Only touch the header when the content changes to avoid needless rebuilds
+if (EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+endif()
+if (NOT "${previous}" STREQUAL "${body}")
+    file(WRITE ${OUTPUT} "${body}")
+endif()
@@ -0,0 +1,111 @@
+# Runs one case of the performance suite (RAVIZ_PERF_TESTS) and checks its
+# --perf-report against BASELINE_DIR/<case>.json.
+#
+#   cmake -DRAVIZ=<exe> -DCASE=<name> -DCASE_ARGS="<raviz args>"
+#         -DBASELINE_DIR=<dir> -DWORK_DIR=<dir> -DTHREADS=<n>
+#         [-DUPDATE=ON] -P PerfCase.cmake
+#
+# A metric regresses when it is worse than the baseline by more than its
+# tolerance_pct (BASELINE_DIR/tolerances.json); timings also get slack_ms
+# of absolute headroom so stages that take a few microseconds don't fail
+# on noise. With UPDATE=ON the report becomes the case's baseline instead.
+cmake_minimum_required(VERSION 3.19)
+
+# Fixed-point with 4 decimals: math(EXPR) only does integers
+function(to_fixed value out)
+    if(value MATCHES "^(-?)([0-9]+)\\.?([0-9]*)")
+        string(SUBSTRING "${CMAKE_MATCH_3}0000" 0 4 frac)
+        math(EXPR fixed "${CMAKE_MATCH_2} * 10000 + 1${frac} - 10000")
+        set(${out} "${CMAKE_MATCH_1}${fixed}" PARENT_SCOPE)
+    else()
+        message(FATAL_ERROR "Not a number: '${value}'")
+    endif()
+endfunction()
+
+separate_arguments(case_args UNIX_COMMAND "${CASE_ARGS}")
+set(report "${WORK_DIR}/${CASE}.json")
+file(REMOVE "${report}")
+# A private HOME keeps the user's config.toml out of the workload
+file(MAKE_DIRECTORY "${WORK_DIR}/home")
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E env HOME=${WORK_DIR}/home
+            LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe LP_NUM_THREADS=${THREADS}
+            ${RAVIZ} --headless --no-shader-cache --output /dev/null --perf-report ${report} ${case_args}
+    WORKING_DIRECTORY ${WORK_DIR}
+    RESULT_VARIABLE status
+    OUTPUT_VARIABLE log
+    ERROR_VARIABLE log
+)
+if(NOT status EQUAL 0 OR NOT EXISTS "${report}")
+    message(FATAL_ERROR "raviz exited with ${status}:\n${log}")
+endif()
+file(READ "${report}" measured)
+message("${CASE}: ${measured}")
+
+set(baseline_file "${BASELINE_DIR}/${CASE}.json")
+if(UPDATE)
+    # Copied verbatim: string(JSON SET) would reprint every number
+    configure_file("${report}" "${baseline_file}" COPYONLY)
+    message("Baseline for ${CASE} updated")
+    return()
+endif()
+if(NOT EXISTS "${baseline_file}")
+    message(WARNING "No baseline for ${CASE}; configure with -DRAVIZ_PERF_UPDATE_BASELINE=ON to record one")
+    return()
+endif()
+file(READ "${baseline_file}" expected)
+file(READ "${BASELINE_DIR}/tolerances.json" tolerances)
+string(JSON slack_ms GET "${tolerances}" slack_ms)
+to_fixed(${slack_ms} slack)
+
+# metric path | tolerance key | direction
+set(metrics
+    "fps|fps|higher"
+    "cpu_ms analysis|cpu_ms|lower"
+    "cpu_ms update|cpu_ms|lower"
+    "cpu_ms draw|cpu_ms|lower"
+    "gpu_ms|gpu_ms|lower"
+    "peak_rss_kb|peak_rss_kb|lower"
+)
+set(failures "")
+foreach(metric ${metrics})
+    string(REPLACE "|" ";" fields "${metric}")
+    list(GET fields 0 path)
+    list(GET fields 1 tolerance_key)
+    list(GET fields 2 direction)
+    string(REPLACE " " ";" path "${path}")
+
+    string(JSON base_type ERROR_VARIABLE err TYPE "${expected}" ${path})
+    string(JSON got_type ERROR_VARIABLE err TYPE "${measured}" ${path})
+    # GPU time is null where timer queries aren't available
+    if(NOT base_type STREQUAL "NUMBER" OR NOT got_type STREQUAL "NUMBER")
+        continue()
+    endif()
+    string(JSON base GET "${expected}" ${path})
+    string(JSON got GET "${measured}" ${path})
+    string(JSON pct GET "${tolerances}" tolerance_pct ${tolerance_key})
+    to_fixed(${base} base_fixed)
+    to_fixed(${got} got_fixed)
+
+    string(REPLACE ";" "." name "${path}")
+    if(direction STREQUAL "higher")
+        math(EXPR limit "${base_fixed} * (100 - ${pct}) / 100")
+        if(got_fixed LESS limit)
+            list(APPEND failures "${name}: ${got} < ${base} - ${pct}%")
+        endif()
+    else()
+        math(EXPR limit "${base_fixed} * (100 + ${pct}) / 100")
+        if(NOT tolerance_key STREQUAL "peak_rss_kb")
+            math(EXPR limit "${limit} + ${slack}")
+        endif()
+        if(got_fixed GREATER limit)
+            list(APPEND failures "${name}: ${got} > ${base} + ${pct}%")
+        endif()
+    endif()
+endforeach()
+
+if(failures)
+    string(REPLACE ";" "\n  " failures "${failures}")
+    message(FATAL_ERROR "${CASE} regressed against ${baseline_file}:\n  ${failures}")
+endif()
@@ -0,0 +1,107 @@
+# Profile-guided, link-time optimised release build (the raviz_pgo target).
+#
+#   cmake -DSOURCE_DIR=<raviz checkout> -DBUILD_DIR=<dir>
+#         [-DCONFIGURE_ARGS="<extra cmake args>"] -P PgoBuild.cmake
+#
+# 1. Configures BUILD_DIR with RAVIZ_PGO=GENERATE and builds the
+#    instrumented raviz plus the synthetic test signals.
+# 2. Runs the workload below: the recorded signals through capture-free
+#    analysis and every scene, rendered offscreen on llvmpipe. Profiles of
+#    the CPU side are all that matter, so the GPU does not.
+# 3. Reconfigures the same tree with RAVIZ_PGO=USE and RAVIZ_LTO=ON and
+#    rebuilds. Object paths stay the same, which GCC's profiles are keyed on.
+#
+# BUILD_DIR then holds an ordinary build: `cmake --install BUILD_DIR`
+# installs the optimised binary. Add -DRAVIZ_TARGET_CLONES=ON to
+# CONFIGURE_ARGS for the AVX2/AVX-512 copies of the analysis loops.
+cmake_minimum_required(VERSION 3.13)
+
+if(NOT SOURCE_DIR OR NOT BUILD_DIR)
+    message(FATAL_ERROR "Usage: cmake -DSOURCE_DIR=<dir> -DBUILD_DIR=<dir> [-DCONFIGURE_ARGS=...] -P PgoBuild.cmake")
+endif()
+get_filename_component(BUILD_DIR "${BUILD_DIR}" ABSOLUTE)
+separate_arguments(configure_args UNIX_COMMAND "${CONFIGURE_ARGS}")
+if(NOT CONFIGURE_ARGS MATCHES "CMAKE_BUILD_TYPE")
+    list(APPEND configure_args -DCMAKE_BUILD_TYPE=Release)
+endif()
+set(profile_dir "${BUILD_DIR}/pgo-profile")
+set(work_dir "${BUILD_DIR}/pgo-workload")
+set(perf_dir "${BUILD_DIR}/perf")
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        string(REPLACE ";" " " command "${ARGN}")
+        message(FATAL_ERROR "Failed (${status}): ${command}")
+    endif()
+endfunction()
+
+# The malloc interposer would be trained into, and shipped with, a build
+# that is only meant to be fast
+function(configure_and_build stage)
+    message(STATUS "PGO: ${stage} build")
+    run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BUILD_DIR} ${configure_args}
+        -DRAVIZ_ALLOC_AUDIT=OFF -DRAVIZ_PGO=${stage} -DRAVIZ_PGO_DIR=${profile_dir} ${ARGN})
+    run(${CMAKE_COMMAND} --build ${BUILD_DIR} --parallel)
+endfunction()
+
+# Stale counters from an earlier run would be merged into this one
+file(REMOVE_RECURSE "${profile_dir}" "${work_dir}")
+file(MAKE_DIRECTORY "${profile_dir}" "${work_dir}/home")
+configure_and_build(GENERATE -DRAVIZ_LTO=OFF)
+
+# Same shape as the performance suite: one case per path worth profiling
+set(common --headless --no-shader-cache --output /dev/null --size 480x270 --frames 240)
+set(beats "--input ${perf_dir}/beats.wav")
+set(cases
+    "sphere_mesh|${beats} --lat 160 --lon 160"
+    "sphere_procedural|${beats} --procedural --color reactive"
+    "sphere_spring|${beats} --spring --lat 160 --lon 160"
+    "sphere_bloom|${beats} --bloom --color reactive"
+    "history|${beats} --scene history"
+    "particles|${beats} --scene particles --particles 100000"
+    "scope|${beats} --scene scope"
+    "sweep_analysis|--input ${perf_dir}/sweep.wav --bins 64"
+    "record|${beats} --record-spectra ${work_dir}/beats.spectra"
+    "replay|--replay-spectra ${work_dir}/beats.spectra"
+)
+set(ran 0)
+foreach(workload ${cases})
+    string(REPLACE "|" ";" workload "${workload}")
+    list(GET workload 0 name)
+    list(GET workload 1 args)
+    separate_arguments(args UNIX_COMMAND "${args}")
+    # A private HOME keeps the user's config.toml out of the profile
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E env HOME=${work_dir}/home
+                LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe
+                ${BUILD_DIR}/raviz ${common} ${args}
+        WORKING_DIRECTORY ${work_dir}
+        RESULT_VARIABLE status
+        OUTPUT_VARIABLE log
+        ERROR_VARIABLE log
+    )
+    if(status EQUAL 0)
+        message(STATUS "PGO: workload ${name} done")
+        math(EXPR ran "${ran} + 1")
+    else()
+        # Partial training is fine; unprofiled code is optimised as usual
+        message(WARNING "PGO: workload ${name} failed (${status}), continuing without it:\n${log}")
+    endif()
+endforeach()
+if(ran EQUAL 0)
+    message(FATAL_ERROR "PGO: no workload ran, so there is no profile to build from")
+endif()
+
+# Clang writes raw profiles that have to be merged first
+file(GLOB raw_profiles "${profile_dir}/*.profraw")
+if(raw_profiles)
+    find_program(LLVM_PROFDATA NAMES llvm-profdata)
+    if(NOT LLVM_PROFDATA)
+        message(FATAL_ERROR "PGO: llvm-profdata is needed to merge Clang profiles")
+    endif()
+    run(${LLVM_PROFDATA} merge -output=${profile_dir}/raviz.profdata ${raw_profiles})
+endif()
+
+configure_and_build(USE -DRAVIZ_LTO=ON)
+message(STATUS "PGO: optimised build in ${BUILD_DIR}")
@@ -0,0 +1,99 @@
+#ifndef RAVIZ_SPECTRUM_SHM_H
+#define RAVIZ_SPECTRUM_SHM_H
+
+/*
+ * Shared-memory spectrum feed published by `raviz --publish`.
+ *
+ * raviz writes every analysis hop into a POSIX shared-memory object
+ * (default RAVIZ_SHM_DEFAULT_NAME, i.e. /dev/shm/raviz-spectrum). Other
+ * processes map it read-only and copy the latest frame out with
+ * raviz_shm_read(): no syscall per frame, no locks, and a reader can never
+ * block the writer.
+ *
+ * The frame is guarded by a seqlock: 'sequence' is odd while the writer is
+ * inside the frame and even otherwise. A reader copies the frame and keeps
+ * the copy only if 'sequence' was even and unchanged across the copy.
+ * frame.seq counts hops, so a reader polling slower than the hop rate can
+ * tell how many it missed.
+ *
+ * This header is self-contained (C99 plus the GCC/Clang __atomic builtins)
+ * so external programs can copy it as is.
+ */
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define RAVIZ_SHM_DEFAULT_NAME "/raviz-spectrum"
+#define RAVIZ_SHM_MAGIC        0x5a495652u   /* "RVIZ" */
+#define RAVIZ_SHM_VERSION      1u
+#define RAVIZ_SHM_MAX_BINS     256
+
+/* Band energies: mean bin magnitude per frequency range */
+enum {
+    RAVIZ_BAND_LOW,     /* below 300 Hz */
+    RAVIZ_BAND_MID,     /* 300 Hz - 4 kHz */
+    RAVIZ_BAND_HIGH,    /* above 4 kHz */
+    RAVIZ_NUM_BANDS
+};
+
+/* RavizAnalysisFrame.flags */
+#define RAVIZ_FRAME_BEAT  0x1u   /* Low-band onset detected on this hop */
+
+typedef struct {
+    uint64_t seq;               /* Hop counter, 1 for the first frame */
+    int64_t timestamp_ns;       /* CLOCK_MONOTONIC arrival of the hop's samples */
+    uint32_t sample_rate;
+    uint32_t fft_size;
+    uint32_t num_bins;          /* Valid entries in bins[] */
+    uint32_t flags;             /* RAVIZ_FRAME_* */
+    float bands[RAVIZ_NUM_BANDS];
+    float bins[RAVIZ_SHM_MAX_BINS]; /* Smoothed, auto-gained magnitudes, 0-1 */
+} RavizAnalysisFrame;
+
+typedef struct {
+    uint32_t magic;             /* RAVIZ_SHM_MAGIC once initialised */
+    uint32_t version;           /* RAVIZ_SHM_VERSION */
+    uint32_t frame_size;        /* sizeof(RavizAnalysisFrame) */
+    uint32_t sequence;          /* Seqlock counter, odd while writing */
+    RavizAnalysisFrame frame;
+} RavizSpectrumShm;
+
+/* Copy the latest frame. Returns 1 on success, 0 if nothing has been
+ * published yet or the writer kept the frame busy for every attempt. */
+static inline int raviz_shm_read(const RavizSpectrumShm *shm, RavizAnalysisFrame *out) {
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        uint32_t begin = __atomic_load_n(&shm->sequence, __ATOMIC_ACQUIRE);
+        if (begin == 0) return 0;
+        if (begin & 1u) continue;
+        *out = shm->frame;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shm->sequence, __ATOMIC_RELAXED) == begin) return 1;
+    }
+    return 0;
+}
+
+/* Map the feed read-only. Returns NULL if raviz is not publishing under
+ * 'name' (NULL for the default) or the layout does not match. */
+static inline const RavizSpectrumShm* raviz_shm_open(const char *name) {
+    int fd = shm_open(name ? name : RAVIZ_SHM_DEFAULT_NAME, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+    void *p = mmap(NULL, sizeof(RavizSpectrumShm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+
+    const RavizSpectrumShm *shm = (const RavizSpectrumShm*)p;
+    if (shm->magic != RAVIZ_SHM_MAGIC || shm->version != RAVIZ_SHM_VERSION ||
+        shm->frame_size != sizeof(RavizAnalysisFrame)) {
+        munmap(p, sizeof(RavizSpectrumShm));
+        return NULL;
+    }
+    return shm;
+}
+
+static inline void raviz_shm_close(const RavizSpectrumShm *shm) {
+    if (shm) munmap((void*)shm, sizeof(RavizSpectrumShm));
+}
+
+#endif
@@ -0,0 +1,18 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 vUV;
+
+uniform sampler2D scene;
+uniform sampler2D bloom;
+uniform vec2 uv_scale;     // Fraction of 'scene' holding valid pixels
+uniform float intensity;
+
+void main() {
+    vec4 base = texture(scene, vUV * uv_scale);
+    vec3 glow = texture(bloom, vUV).rgb * intensity;
+
+    // Glow over a transparent background must raise alpha to be visible
+    float alpha = clamp(base.a + max(glow.r, max(glow.g, glow.b)), 0.0, 1.0);
+    FragColor = vec4(base.rgb + glow, alpha);
+}
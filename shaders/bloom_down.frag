@@ -0,0 +1,39 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 vUV;
+
+uniform sampler2D source;
+uniform vec2 texel;        // 1 / source size
+uniform vec2 uv_scale;     // Fraction of 'source' holding valid pixels
+uniform int prefilter;     // First pass: keep only what exceeds the threshold
+uniform float threshold;
+uniform float knee;
+
+vec3 fetch(vec2 uv) {
+    // Never bilinear-sample outside the valid sub-rectangle
+    return texture(source, min(uv, uv_scale - 0.5 * texel)).rgb;
+}
+
+vec3 bright_pass(vec3 c) {
+    // Soft knee on the brightest channel avoids a hard cut-off edge
+    float b = max(c.r, max(c.g, c.b));
+    float soft = clamp(b - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    return c * (max(soft, b - threshold) / max(b, 1e-4));
+}
+
+// Dual-filter downsample: centre plus four diagonal taps, each a bilinear
+// fetch between source texels, so 5 fetches average 16 texels.
+void main() {
+    vec2 uv = vUV * uv_scale;
+    vec3 sum = fetch(uv) * 4.0;
+    sum += fetch(uv - texel);
+    sum += fetch(uv + texel);
+    sum += fetch(uv + vec2(texel.x, -texel.y));
+    sum += fetch(uv - vec2(texel.x, -texel.y));
+    vec3 color = sum / 8.0;
+
+    if (prefilter == 1) color = bright_pass(color);
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 vUV;
+
+uniform sampler2D source;
+uniform vec2 texel;        // 1 / source size
+
+// Dual-filter upsample: 8 taps on a diamond, added onto the next larger
+// level by the blend state.
+void main() {
+    vec2 o = texel * 0.5;
+    vec3 sum = texture(source, vUV + vec2(-2.0 * o.x, 0.0)).rgb;
+    sum += texture(source, vUV + vec2(-o.x, o.y)).rgb * 2.0;
+    sum += texture(source, vUV + vec2(0.0, 2.0 * o.y)).rgb;
+    sum += texture(source, vUV + vec2(o.x, o.y)).rgb * 2.0;
+    sum += texture(source, vUV + vec2(2.0 * o.x, 0.0)).rgb;
+    sum += texture(source, vUV + vec2(o.x, -o.y)).rgb * 2.0;
+    sum += texture(source, vUV + vec2(0.0, -2.0 * o.y)).rgb;
+    sum += texture(source, vUV + vec2(-o.x, -o.y)).rgb * 2.0;
+    FragColor = vec4(sum / 12.0, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 vCorner;
+in float vSpeed;
+in float vLife;
+
+uniform int color_mode;
+uniform float hue;            // Current pitch class, 0-1
+
+vec3 hsv2rgb(vec3 c) {
+    vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+    vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+    return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+void main() {
+    float falloff = max(1.0 - dot(vCorner, vCorner), 0.0);
+    if (falloff <= 0.0) discard;
+    
+    vec3 color = mix(vec3(0.1, 0.4, 0.8), vec3(0.5, 0.8, 1.0), clamp(vSpeed * 2.0, 0.0, 1.0));
+    if (color_mode == 1) {
+        color = mix(vec3(0.8, 0.5, 0.1), vec3(1.0, 0.8, 0.5), clamp(vSpeed * 2.0, 0.0, 1.0));
+    } else if (color_mode == 2) {
+        color = hsv2rgb(vec3(fract(hue + vSpeed), 0.8, 1.0));
+    }
+    
+    float fade = clamp(vLife, 0.0, 1.0);
+    FragColor = vec4(color * falloff * fade, falloff * fade);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec4 in_pos;
+layout (location = 1) in vec4 in_vel;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 viewport;
+uniform float point_size;
+
+out vec2 vCorner;
+out float vSpeed;
+out float vLife;
+
+void main() {
+    // Quad corner from the strip vertex index; position from the instance
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vec4 clip = projection * view * model * vec4(in_pos.xyz, 1.0);
+    clip.xy += corner * point_size / viewport * clip.w;
+    
+    vCorner = corner;
+    vSpeed = length(in_vel.xyz);
+    vLife = in_pos.w;
+    gl_Position = clip;
+}
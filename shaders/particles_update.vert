@@ -0,0 +1,52 @@
+#version 330 core
+layout (location = 0) in vec4 in_pos;
+layout (location = 1) in vec4 in_vel;
+
+uniform float fft_data[64];
+uniform float intensity;
+uniform float time;
+uniform float dt;
+
+out vec4 out_pos;
+out vec4 out_vel;
+
+float hash(float n) {
+    return fract(sin(n) * 43758.5453123);
+}
+
+vec3 random_dir(float seed) {
+    float z = hash(seed) * 2.0 - 1.0;
+    float a = hash(seed + 17.13) * 6.28318531;
+    float r = sqrt(1.0 - z * z);
+    return vec3(r * cos(a), z, r * sin(a));
+}
+
+void main() {
+    vec3 p = in_pos.xyz;
+    float life = in_pos.w - dt;
+    vec3 v = in_vel.xyz;
+    float seed = in_vel.w;
+    
+    if (life <= 0.0) {
+        // Respawn on the unit sphere with a fresh seed
+        seed = hash(seed + float(gl_VertexID) * 0.618 + fract(time)) * 1000.0;
+        vec3 dir = random_dir(seed);
+        p = dir;
+        v = dir * 0.05;
+        life = 1.5 + hash(seed + 3.7) * 2.5;
+    } else {
+        vec3 dir = normalize(p);
+        // Latitude picks the band that drives this particle
+        int bin = int(acos(clamp(dir.y, -1.0, 1.0)) / 3.14159265 * 63.0);
+        float energy = fft_data[bin];
+        
+        v += dir * energy * intensity * 3.0 * dt;
+        v += cross(vec3(0.0, 1.0, 0.0), dir) * 0.3 * dt;
+        v -= dir * (length(p) - 1.0) * 0.8 * dt;
+        v *= exp(-1.5 * dt);
+        p += v * dt;
+    }
+    
+    out_pos = vec4(p, life);
+    out_vel = vec4(v, seed);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+out vec4 FragColor;
+
+in float vLevel;
+flat in int vChannel;
+
+uniform int color_mode;
+uniform float hue;            // Current pitch class, 0-1
+
+vec3 hsv2rgb(vec3 c) {
+    vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+    vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+    return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+void main() {
+    // Phosphor green; louder parts of the trace burn brighter
+    vec3 color = vChannel == 0 ? vec3(0.3, 1.0, 0.4) : vec3(0.3, 0.8, 1.0);
+    if (color_mode == 1) {
+        color = vChannel == 0 ? vec3(1.0, 0.7, 0.3) : vec3(1.0, 0.5, 0.2);
+    } else if (color_mode == 2) {
+        color = hsv2rgb(vec3(fract(hue + vLevel * 0.5 + float(vChannel) * 0.25), 0.8, 1.0));
+    }
+    FragColor = vec4(color * (0.6 + 0.8 * clamp(vLevel, 0.0, 1.0)), 1.0);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+// Oscilloscope trace: one vertex per sample, fetched from the PCM buffer
+// texture. Waveform mode draws one instance per channel stacked
+// vertically; XY mode draws a single left-vs-right Lissajous trace.
+
+uniform isamplerBuffer samples;  // RG16I: left, right
+uniform int count;
+uniform int xy;
+uniform float aspect;            // Viewport width / height
+uniform float gain;
+
+out float vLevel;
+flat out int vChannel;
+
+void main() {
+    vec2 s = vec2(texelFetch(samples, gl_VertexID).rg) / 32768.0 * gain;
+    vec2 pos;
+    if (xy == 1) {
+        // Square plot in the middle of the viewport
+        pos = clamp(s, -1.0, 1.0) * 0.9;
+        if (aspect > 1.0) pos.x /= aspect;
+        else pos.y *= aspect;
+        vLevel = length(s);
+        vChannel = 0;
+    } else {
+        float x = -1.0 + 2.0 * float(gl_VertexID) / float(max(count - 1, 1));
+        float v = gl_InstanceID == 0 ? s.x : s.y;
+        // Two lanes: left on top, right below
+        float centre = gl_InstanceID == 0 ? 0.5 : -0.5;
+        pos = vec2(x, centre + clamp(v, -1.0, 1.0) * 0.45);
+        vLevel = abs(v);
+        vChannel = gl_InstanceID;
+    }
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
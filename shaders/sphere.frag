@@ -0,0 +1,50 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 vNormal;
+in vec3 vPos;
+in float vDisplacement;
+
+// Per-frame data, declared identically in sphere.vert
+layout (std140) uniform Frame {
+    mat4 model;
+    mat4 view;
+    mat4 projection;
+    vec4 fft[16];
+    float time;
+    float intensity;
+    int color_mode;
+    float hue;          // Current pitch class, 0-1
+    vec4 modulation[2];
+};
+
+// 0: None (Blue/Purple), 1: Static (White/Gold), 2: Reactive (Rainbow)
+
+vec3 hsv2rgb(vec3 c) {
+    vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+    vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+    return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+void main() {
+    vec3 norm = normalize(vNormal);
+    float fresnel = pow(1.0 - max(dot(norm, vec3(0.0, 0.0, 1.0)), 0.0), 3.0);
+    
+    vec3 base_color = vec3(0.1, 0.4, 0.8);
+    vec3 glow_color = vec3(0.5, 0.8, 1.0);
+    
+    if (color_mode == 1) { // Static (Golden/Warm)
+        base_color = vec3(0.8, 0.5, 0.1);
+        glow_color = vec3(1.0, 0.8, 0.5);
+    } else if (color_mode == 2) { // Reactive (Rainbow)
+        float h = fract(hue + vDisplacement);
+        base_color = hsv2rgb(vec3(h, 0.8, 0.8));
+        glow_color = hsv2rgb(vec3(h + 0.1, 0.5, 1.0));
+    }
+    
+    vec3 color = base_color;
+    color += vec3(0.8, 0.2, 0.5) * vDisplacement * 5.0;
+    color += glow_color * fresnel * 0.8;
+    
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,82 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// Per-frame data, shared with sphere.frag (layout mirrors FrameUniforms in render.c)
+layout (std140) uniform Frame {
+    mat4 model;
+    mat4 view;
+    mat4 projection;
+    vec4 fft[16];       // 64 bins, packed four per vec4
+    float time;
+    float intensity;
+    int color_mode;
+    float hue;          // Current pitch class, 0-1
+    vec4 modulation[2]; // Modulation matrix output per target (ModTarget order)
+};
+
+uniform int scene;
+uniform sampler2D history;
+uniform float history_offset;
+uniform int procedural;
+uniform ivec2 grid;
+uniform int spring;
+uniform samplerBuffer deform_state;
+
+out vec3 vNormal;
+out vec3 vPos;
+out float vDisplacement;
+
+float fft_bin(int i) {
+    return fft[i >> 2][i & 3];
+}
+
+float random(vec3 st) {
+    return fract(sin(dot(st.xyz, vec3(12.9898,78.233,45.5432))) * 43758.5453123);
+}
+
+// Attribute-less sphere: 6 vertices per lat/lon quad, same winding as generate_sphere()
+vec3 sphere_vertex(int id) {
+    const ivec2 corners[6] = ivec2[6](ivec2(0, 1), ivec2(0, 0), ivec2(1, 0),
+                                      ivec2(0, 1), ivec2(1, 0), ivec2(1, 1));
+    int quad = id / 6;
+    ivec2 c = corners[id - quad * 6];
+    float u = float(quad % grid.y + c.x) / float(grid.y);
+    float v = float(quad / grid.y + c.y) / float(grid.x);
+    float theta = u * 6.28318531;
+    float phi = v * 3.14159265;
+    return vec3(cos(theta) * sin(phi), cos(phi), sin(theta) * sin(phi));
+}
+
+float history_displacement(vec3 pos) {
+    // Latitude is age (north pole = newest hop), longitude is frequency,
+    // mirrored so both halves meet without a seam.
+    float lat = acos(clamp(pos.y, -1.0, 1.0)) / 3.14159265;
+    float lon = abs(atan(pos.z, pos.x)) / 3.14159265;
+    float rows = float(textureSize(history, 0).y);
+    float v = history_offset - lat * (rows - 1.0) / rows;
+    return textureLod(history, vec2(lon, v), 0.0).r * 0.4 * intensity;
+}
+
+// The routes to "displacement" and "noise", evaluated on the CPU
+float spectrum_displacement(vec3 pos) {
+    float noise = random(pos + time * 0.1);
+    return (modulation[0].x + noise * modulation[0].y) * intensity;
+}
+
+void main() {
+    // On the unit sphere the normal is the position itself
+    vec3 pos = (procedural == 1) ? sphere_vertex(gl_VertexID) : aPos;
+    
+    float displacement;
+    if (scene == 1) displacement = history_displacement(pos);
+    else if (spring == 1) displacement = texelFetch(deform_state, gl_VertexID).r;
+    else displacement = spectrum_displacement(pos);
+    
+    vec3 new_pos = pos + pos * displacement;
+    
+    vDisplacement = displacement;
+    vNormal = pos;
+    vPos = new_pos;
+    
+    gl_Position = projection * view * model * vec4(new_pos, 1.0);
+}
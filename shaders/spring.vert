@@ -0,0 +1,43 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aState;
+
+uniform float displacement;    // Modulated push, intensity applied
+uniform float ripple;          // Amplitude of the random ripple, likewise
+uniform float time;
+uniform float step;
+uniform ivec2 grid;
+uniform samplerBuffer prev_state;
+uniform float stiffness;
+uniform float damping;
+uniform float coupling;
+
+out vec2 out_state;
+
+float random(vec3 st) {
+    return fract(sin(dot(st.xyz, vec3(12.9898,78.233,45.5432))) * 43758.5453123);
+}
+
+float neighbour(int x, int y) {
+    x = (x + grid.y) % grid.y;
+    y = clamp(y, 0, grid.x);
+    return texelFetch(prev_state, y * (grid.y + 1) + x).r;
+}
+
+void main() {
+    // Same target as the stateless mode; the spring chases it
+    float target = displacement + random(aPos + time * 0.1) * ripple;
+    
+    // Grid neighbours; the seam column (x == lon) mirrors column 0
+    int x = gl_VertexID % (grid.y + 1);
+    int y = gl_VertexID / (grid.y + 1);
+    x = x % grid.y;
+    float d = aState.x;
+    float laplacian = neighbour(x - 1, y) + neighbour(x + 1, y)
+                    + neighbour(x, y - 1) + neighbour(x, y + 1) - 4.0 * d;
+    
+    // Semi-implicit Euler on a damped spring coupled to its neighbours
+    float accel = stiffness * (target - d) + coupling * laplacian - damping * aState.y;
+    float v = aState.y + accel * step;
+    out_state = vec2(d + v * step, v);
+}
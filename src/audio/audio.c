@@ -1,5 +1,11 @@
+#define _POSIX_C_SOURCE 200809L
 #include "audio.h"
+#include "wav.h"
+#include "../utils/arena.h"
+#include "../utils/log.h"
 #include <pulse/simple.h>
+#include <pulse/stream.h>
+#include <pulse/thread-mainloop.h>
 #include <pulse/error.h>
 #include <pulse/def.h>
 #include <pulse/introspect.h>
@@ -8,10 +14,33 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <poll.h>
 
 struct AudioContext {
     pa_simple *s;
     pa_sample_spec ss;
+
+    // Non-blocking stream (audio_open_stream): the server thread writes
+    // the ring, one reader at a time drains it
+    AudioServer *server;
+    pa_stream *stream;
+    Arena arena;
+    int16_t *ring;
+    size_t ring_frames;     // Power of two
+    size_t ring_write;      // Frame counters, wrapped by masking
+    size_t ring_read;
+    unsigned long overruns;
+    int failed;
+    void (*notify)(void *user);
+    void *notify_user;
+
+    // File source (config->input_file)
+    WavReader *wav;
+    int paced;              // Throttle file reads to real time
+    struct timespec start;
+    size_t frames_read;
+    int eof;
 };
 
 // --- Auto-detection Logic ---
@@ -103,21 +132,80 @@ char* get_default_monitor_source() {
 
 // --- Main Audio Init ---
 
+static AudioContext* audio_init_file(const RavizConfig *config) {
+    WavReader *wav = wav_open(config->input_file);
+    if (!wav) return NULL;
+
+    AudioContext *ctx = calloc(1, sizeof(AudioContext));
+    if (!ctx) {
+        wav_close(wav);
+        return NULL;
+    }
+
+    ctx->wav = wav;
+    ctx->ss.format = PA_SAMPLE_S16LE;
+    ctx->ss.rate = wav_sample_rate(wav);
+    ctx->ss.channels = audio_capture_channels(config);
+    // Headless renders pull samples as fast as frames are produced
+    ctx->paced = !config->headless;
+    clock_gettime(CLOCK_MONOTONIC, &ctx->start);
+
+    log_info("Audio", "Reading %s (%d Hz, %d ch)%s", config->input_file,
+           wav_sample_rate(wav), wav_channels(wav), ctx->paced ? "" : ", unpaced");
+    return ctx;
+}
+
+static size_t audio_read_file(AudioContext *ctx, int16_t *buffer, size_t num_frames) {
+    size_t n = ctx->ss.channels == 2 ? wav_read_stereo(ctx->wav, buffer, num_frames)
+                                     : wav_read_mono(ctx->wav, buffer, num_frames);
+    if (n < num_frames) ctx->eof = 1;
+    ctx->frames_read += n;
+
+    if (ctx->paced) {
+        // Sleep until the wall clock catches up with the samples handed out
+        long long due_ns = (long long)ctx->frames_read * 1000000000LL / ctx->ss.rate;
+        struct timespec wake = ctx->start;
+        wake.tv_sec += due_ns / 1000000000LL;
+        wake.tv_nsec += due_ns % 1000000000LL;
+        if (wake.tv_nsec >= 1000000000L) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+    }
+    return n;
+}
+
+int audio_capture_channels(const RavizConfig *config) {
+    return config_shows_scope(config) && !config->no_render ? 2 : 1;
+}
+
+int audio_block_frames(const RavizConfig *config) {
+    if (config_shows_scope(config) && !config->no_render) {
+        int block = config->audio_rate / 250;
+        return block > 0 && block < config->fft_size ? block : config->fft_size;
+    }
+    return config->fft_size;
+}
+
 AudioContext* audio_init(const RavizConfig *config) {
-    AudioContext *ctx = malloc(sizeof(AudioContext));
+    if (config->input_file) return audio_init_file(config);
+
+    AudioContext *ctx = calloc(1, sizeof(AudioContext));
     if (!ctx) return NULL;
 
     ctx->ss.format = PA_SAMPLE_S16LE;
     ctx->ss.rate = config->audio_rate;
-    ctx->ss.channels = 1; 
+    ctx->ss.channels = audio_capture_channels(config);
 
-    // Request low latency
+    // Request low latency: one fragment per read
+    size_t frame_bytes = ctx->ss.channels * sizeof(int16_t);
     pa_buffer_attr ba;
-    ba.maxlength = config->fft_size * sizeof(int16_t) * 2; 
+    ba.maxlength = config->fft_size * frame_bytes * 2;
     ba.tlength = (uint32_t)-1;
     ba.prebuf = (uint32_t)-1;
     ba.minreq = (uint32_t)-1;
-    ba.fragsize = config->fft_size * sizeof(int16_t);
+    ba.fragsize = audio_block_frames(config) * frame_bytes;
 
     int error;
     char *device_name = config->audio_device;
@@ -125,16 +213,16 @@ AudioContext* audio_init(const RavizConfig *config) {
 
     // If no device specified, try to find the monitor of the default sink
     if (!device_name) {
-        printf("[Audio] Detecting default monitor source...\n");
+        log_info("Audio", "Detecting default monitor source...");
         auto_device = get_default_monitor_source();
         if (auto_device) {
-            printf("[Audio] Found monitor: %s\n", auto_device);
+            log_info("Audio", "Found monitor: %s", auto_device);
             device_name = auto_device;
         } else {
-            printf("[Audio] Could not auto-detect monitor. Using default input (mic?).\n");
+            log_info("Audio", "Could not auto-detect monitor. Using default input (mic?).");
         }
     } else {
-        printf("[Audio] Using configured device: %s\n", device_name);
+        log_info("Audio", "Using configured device: %s", device_name);
     }
 
     ctx->s = pa_simple_new(NULL, "Raviz", PA_STREAM_RECORD, device_name, "Visualization", &ctx->ss, NULL, &ba, &error);
@@ -142,7 +230,7 @@ AudioContext* audio_init(const RavizConfig *config) {
     if (auto_device) free(auto_device);
 
     if (!ctx->s) {
-        fprintf(stderr, "Error connecting to PulseAudio: %s\n", pa_strerror(error));
+        log_error("Audio", "Error connecting to PulseAudio: %s", pa_strerror(error));
         free(ctx);
         return NULL;
     }
@@ -152,18 +240,309 @@ AudioContext* audio_init(const RavizConfig *config) {
     return ctx;
 }
 
-size_t audio_read(AudioContext *ctx, int16_t *buffer, size_t num_samples) {
+// --- Shared server and non-blocking streams ---
+
+struct AudioServer {
+    pa_threaded_mainloop *loop;     // Own event thread, or
+    pa_mainloop *polled;            // run by the caller (audio_server_iterate)
+    pa_context *context;
+
+    // Polled: the caller's extra fd and deadline for the current iteration
+    int wake_fd;
+    int timeout_ms;
+    int woke;
+};
+
+// Threaded servers need their lock around every call; a polled one only
+// ever runs on the caller's thread
+static void server_lock(AudioServer *server) {
+    if (server->loop) pa_threaded_mainloop_lock(server->loop);
+}
+
+static void server_unlock(AudioServer *server) {
+    if (server->loop) pa_threaded_mainloop_unlock(server->loop);
+}
+
+// Block until the server has done something (e.g. a state change)
+static void server_wait(AudioServer *server) {
+    if (server->loop) pa_threaded_mainloop_wait(server->loop);
+    else pa_mainloop_iterate(server->polled, 1, NULL);
+}
+
+static void server_signal(AudioServer *server) {
+    if (server->loop) pa_threaded_mainloop_signal(server->loop, 0);
+}
+
+static void server_state_cb(pa_context *c, void *userdata) {
+    server_signal((AudioServer*)userdata);
+}
+
+// Polled server: PulseAudio's own poll() also watches the caller's fd, so
+// one call sleeps until either side has work
+static int server_poll(struct pollfd *ufds, unsigned long nfds, int timeout, void *userdata) {
+    AudioServer *server = (AudioServer*)userdata;
+    if (server->timeout_ms >= 0 && (timeout < 0 || server->timeout_ms < timeout)) timeout = server->timeout_ms;
+    if (server->wake_fd < 0) return poll(ufds, nfds, timeout);
+
+    struct pollfd fds[nfds + 1];
+    memcpy(fds, ufds, nfds * sizeof(struct pollfd));
+    fds[nfds].fd = server->wake_fd;
+    fds[nfds].events = POLLIN;
+    fds[nfds].revents = 0;
+    int n = poll(fds, nfds + 1, timeout);
+    if (n < 0) return n;
+    memcpy(ufds, fds, nfds * sizeof(struct pollfd));
+    server->woke = fds[nfds].revents != 0;
+    return n - server->woke;
+}
+
+static int server_connect(AudioServer *server, pa_mainloop_api *api) {
+    server_lock(server);
+    server->context = pa_context_new(api, "Raviz");
+    pa_context_state_t state = PA_CONTEXT_FAILED;
+    if (server->context) {
+        pa_context_set_state_callback(server->context, server_state_cb, server);
+        if (pa_context_connect(server->context, NULL, PA_CONTEXT_NOFLAGS, NULL) >= 0) {
+            for (;;) {
+                state = pa_context_get_state(server->context);
+                if (state == PA_CONTEXT_READY || state == PA_CONTEXT_FAILED || state == PA_CONTEXT_TERMINATED) break;
+                server_wait(server);
+            }
+        }
+    }
+    server_unlock(server);
+
+    if (state != PA_CONTEXT_READY) {
+        log_error("Audio", "Error connecting to PulseAudio: %s",
+                pa_strerror(server->context ? pa_context_errno(server->context) : 0));
+        audio_server_cleanup(server);
+        return 0;
+    }
+    return 1;
+}
+
+AudioServer* audio_server_init(void) {
+    AudioServer *server = calloc(1, sizeof(AudioServer));
+    if (!server) return NULL;
+    server->loop = pa_threaded_mainloop_new();
+    if (!server->loop || pa_threaded_mainloop_start(server->loop) < 0) {
+        log_error("Audio", "Could not start the PulseAudio thread");
+        if (server->loop) pa_threaded_mainloop_free(server->loop);
+        free(server);
+        return NULL;
+    }
+    return server_connect(server, pa_threaded_mainloop_get_api(server->loop)) ? server : NULL;
+}
+
+AudioServer* audio_server_init_polled(void) {
+    AudioServer *server = calloc(1, sizeof(AudioServer));
+    if (!server) return NULL;
+    server->polled = pa_mainloop_new();
+    if (!server->polled) {
+        free(server);
+        return NULL;
+    }
+    server->wake_fd = -1;
+    server->timeout_ms = -1;
+    pa_mainloop_set_poll_func(server->polled, server_poll, server);
+    return server_connect(server, pa_mainloop_get_api(server->polled)) ? server : NULL;
+}
+
+int audio_server_iterate(AudioServer *server, int wake_fd, int timeout_ms) {
+    server->wake_fd = wake_fd;
+    server->timeout_ms = timeout_ms;
+    server->woke = 0;
+    pa_mainloop_iterate(server->polled, 1, NULL);
+    server->wake_fd = -1;
+    server->timeout_ms = -1;
+    return server->woke;
+}
+
+void audio_server_cleanup(AudioServer *server) {
+    if (!server) return;
+    // Stop the thread first: no callback may run while the context goes
+    if (server->loop) pa_threaded_mainloop_stop(server->loop);
+    if (server->context) {
+        pa_context_disconnect(server->context);
+        pa_context_unref(server->context);
+    }
+    if (server->loop) pa_threaded_mainloop_free(server->loop);
+    if (server->polled) pa_mainloop_free(server->polled);
+    free(server);
+}
+
+static void stream_state_cb(pa_stream *s, void *userdata) {
+    AudioContext *ctx = (AudioContext*)userdata;
+    pa_stream_state_t state = pa_stream_get_state(s);
+    if (state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) {
+        __atomic_store_n(&ctx->failed, 1, __ATOMIC_RELEASE);
+        // Let the reader see the end instead of waiting for frames forever
+        if (ctx->notify) ctx->notify(ctx->notify_user);
+    }
+    server_signal(ctx->server);
+}
+
+// Server thread: queue what arrived. A full ring drops the newest frames
+// (the reader has fallen behind; better a gap than unbounded latency).
+static void stream_read_cb(pa_stream *s, size_t nbytes, void *userdata) {
+    AudioContext *ctx = (AudioContext*)userdata;
+    size_t frame_bytes = ctx->ss.channels * sizeof(int16_t);
+    const void *data;
+    size_t bytes;
+    while (pa_stream_peek(s, &data, &bytes) == 0 && bytes > 0) {
+        if (data) {
+            size_t w = ctx->ring_write;
+            size_t room = ctx->ring_frames - (w - __atomic_load_n(&ctx->ring_read, __ATOMIC_ACQUIRE));
+            size_t frames = bytes / frame_bytes;
+            if (frames > room) {
+                ctx->overruns++;
+                frames = room;
+            }
+            const int16_t *in = data;
+            for (size_t done = 0; done < frames;) {
+                size_t at = (w + done) & (ctx->ring_frames - 1);
+                size_t run = ctx->ring_frames - at;
+                if (run > frames - done) run = frames - done;
+                memcpy(ctx->ring + at * ctx->ss.channels, in + done * ctx->ss.channels, run * frame_bytes);
+                done += run;
+            }
+            __atomic_store_n(&ctx->ring_write, w + frames, __ATOMIC_RELEASE);
+        }
+        // data == NULL is a hole in the stream: nothing to copy, just skip it
+        pa_stream_drop(s);
+    }
+    if (ctx->notify) ctx->notify(ctx->notify_user);
+}
+
+AudioContext* audio_open_stream(AudioServer *server, const RavizConfig *config, const char *device,
+                                void (*notify)(void *user), void *user) {
+    if (!server) return NULL;
+    AudioContext *ctx = calloc(1, sizeof(AudioContext));
+    if (!ctx) return NULL;
+
+    ctx->server = server;
+    ctx->notify = notify;
+    ctx->notify_user = user;
+    ctx->ss.format = PA_SAMPLE_S16LE;
+    ctx->ss.rate = config->audio_rate;
+    ctx->ss.channels = audio_capture_channels(config);
+
+    // Room for a few analysis windows: the reader only has to keep up on average
+    ctx->ring_frames = 1024;
+    while (ctx->ring_frames < 4 * (size_t)config->fft_size) ctx->ring_frames *= 2;
+    size_t frame_bytes = ctx->ss.channels * sizeof(int16_t);
+    arena_reserve(&ctx->arena, ctx->ring_frames * frame_bytes);
+    if (!arena_init(&ctx->arena)) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->ring = arena_alloc(&ctx->arena, ctx->ring_frames * frame_bytes);
+
+    char *auto_device = NULL;
+    if (!device) {
+        log_info("Audio", "Detecting default monitor source...");
+        auto_device = get_default_monitor_source();
+        if (auto_device) {
+            log_info("Audio", "Found monitor: %s", auto_device);
+            device = auto_device;
+        } else {
+            log_info("Audio", "Could not auto-detect monitor. Using default input (mic?).");
+        }
+    } else {
+        log_info("Audio", "Using configured device: %s", device);
+    }
+
+    // One block per fragment, as for the blocking stream
+    pa_buffer_attr ba;
+    ba.maxlength = config->fft_size * frame_bytes * 2;
+    ba.tlength = (uint32_t)-1;
+    ba.prebuf = (uint32_t)-1;
+    ba.minreq = (uint32_t)-1;
+    ba.fragsize = audio_block_frames(config) * frame_bytes;
+
+    server_lock(server);
+    ctx->stream = pa_stream_new(server->context, "Visualization", &ctx->ss, NULL);
+    pa_stream_state_t state = PA_STREAM_FAILED;
+    if (ctx->stream) {
+        pa_stream_set_state_callback(ctx->stream, stream_state_cb, ctx);
+        pa_stream_set_read_callback(ctx->stream, stream_read_cb, ctx);
+        if (pa_stream_connect_record(ctx->stream, device, &ba, PA_STREAM_ADJUST_LATENCY) >= 0) {
+            for (;;) {
+                state = pa_stream_get_state(ctx->stream);
+                if (state == PA_STREAM_READY || state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) break;
+                server_wait(server);
+            }
+        }
+    }
+    server_unlock(server);
+
+    if (state != PA_STREAM_READY) {
+        log_error("Audio", "Cannot record %s: %s", device ? device : "the default input",
+                pa_strerror(pa_context_errno(server->context)));
+        free(auto_device);
+        audio_cleanup(ctx);
+        return NULL;
+    }
+    free(auto_device);
+    return ctx;
+}
+
+long audio_ready_at(const AudioContext *ctx, size_t num_frames) {
+    if (!ctx) return 0;
+    if (ctx->stream) {
+        size_t queued = __atomic_load_n(&ctx->ring_write, __ATOMIC_ACQUIRE) - ctx->ring_read;
+        return queued >= num_frames || __atomic_load_n(&ctx->failed, __ATOMIC_ACQUIRE) ? 0 : -1;
+    }
+    if (!ctx->wav || !ctx->paced || ctx->eof) return 0;
+
+    long due = ctx->start.tv_sec * 1000000000L + ctx->start.tv_nsec +
+               (long)((long long)(ctx->frames_read + num_frames) * 1000000000LL / ctx->ss.rate);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return due <= now.tv_sec * 1000000000L + now.tv_nsec ? 0 : due;
+}
+
+static size_t audio_read_stream(AudioContext *ctx, int16_t *buffer, size_t num_frames) {
+    size_t r = ctx->ring_read;
+    if (__atomic_load_n(&ctx->ring_write, __ATOMIC_ACQUIRE) - r < num_frames) return 0;
+    int ch = ctx->ss.channels;
+    for (size_t done = 0; done < num_frames;) {
+        size_t at = (r + done) & (ctx->ring_frames - 1);
+        size_t run = ctx->ring_frames - at;
+        if (run > num_frames - done) run = num_frames - done;
+        memcpy(buffer + done * ch, ctx->ring + at * ch, run * ch * sizeof(int16_t));
+        done += run;
+    }
+    __atomic_store_n(&ctx->ring_read, r + num_frames, __ATOMIC_RELEASE);
+    return num_frames;
+}
+
+size_t audio_read(AudioContext *ctx, int16_t *buffer, size_t num_frames) {
+    if (ctx && ctx->wav) return audio_read_file(ctx, buffer, num_frames);
+    if (ctx && ctx->stream) return audio_read_stream(ctx, buffer, num_frames);
     if (!ctx || !ctx->s) return 0;
 
     int error;
-    size_t bytes_to_read = num_samples * sizeof(int16_t);
-    
+    size_t bytes_to_read = num_frames * ctx->ss.channels * sizeof(int16_t);
+
     if (pa_simple_read(ctx->s, buffer, bytes_to_read, &error) < 0) {
-        fprintf(stderr, "pa_simple_read() failed: %s\n", pa_strerror(error));
+        log_warn("Audio", "pa_simple_read() failed: %s", pa_strerror(error));
         return 0;
     }
 
-    return num_samples;
+    return num_frames;
+}
+
+int audio_channels(const AudioContext *ctx) {
+    return ctx ? ctx->ss.channels : 1;
+}
+
+int audio_sample_rate(const AudioContext *ctx) {
+    return ctx ? (int)ctx->ss.rate : 0;
+}
+
+int audio_eof(const AudioContext *ctx) {
+    return ctx ? ctx->eof || __atomic_load_n(&ctx->failed, __ATOMIC_ACQUIRE) : 1;
 }
 
 void audio_cleanup(AudioContext *ctx) {
@@ -171,6 +550,19 @@ void audio_cleanup(AudioContext *ctx) {
         if (ctx->s) {
             pa_simple_free(ctx->s);
         }
+        if (ctx->stream) {
+            server_lock(ctx->server);
+            // TERMINATED arrives after the disconnect, on the server thread
+            // or in a later audio_server_iterate: by then ctx is gone
+            pa_stream_set_state_callback(ctx->stream, NULL, NULL);
+            pa_stream_set_read_callback(ctx->stream, NULL, NULL);
+            pa_stream_disconnect(ctx->stream);
+            pa_stream_unref(ctx->stream);
+            server_unlock(ctx->server);
+            if (ctx->overruns) log_warn("Audio", "Stream fell behind %lu time(s), frames dropped", ctx->overruns);
+        }
+        arena_release(&ctx->arena);
+        wav_close(ctx->wav);
         free(ctx);
     }
 }
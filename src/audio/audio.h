@@ -6,13 +6,63 @@
 #include <stddef.h>
 
 typedef struct AudioContext AudioContext;
+typedef struct AudioServer AudioServer;
 
-// Initialize audio subsystem
+// Initialize audio subsystem. Captures from PulseAudio, or reads
+// config->input_file (16-bit PCM WAV) when set.
 AudioContext* audio_init(const RavizConfig *config);
 
-// Read raw samples into buffer. Returns number of samples read.
-// 'buffer' must be large enough to hold 'num_samples' * sizeof(int16_t).
-size_t audio_read(AudioContext *ctx, int16_t *buffer, size_t num_samples);
+// One PulseAudio connection with its own event thread, shared by every
+// stream opened with audio_open_stream. NULL if the server is unreachable.
+AudioServer* audio_server_init(void);
+
+// The same connection without a thread (--single-thread): nothing is
+// received and no callback runs except inside audio_server_iterate.
+AudioServer* audio_server_init_polled(void);
+
+// Polled server: sleep until PulseAudio has work, 'wake_fd' (-1: none) is
+// readable or 'timeout_ms' (-1: none) passes, then run the stream
+// callbacks on this thread. Returns 1 if 'wake_fd' became readable.
+int audio_server_iterate(AudioServer *server, int wake_fd, int timeout_ms);
+
+void audio_server_cleanup(AudioServer *server);
+
+// Record 'device' (NULL: the default sink's monitor) on 'server' without
+// blocking: the server (its thread, or audio_server_iterate) queues
+// arriving frames and calls 'notify(user)', and audio_read returns them
+// once enough have arrived.
+// Rate, channels and block size follow 'config' as for audio_init.
+AudioContext* audio_open_stream(AudioServer *server, const RavizConfig *config, const char *device,
+                                void (*notify)(void *user), void *user);
+
+// When 'num_frames' frames can be read without waiting: 0 if they can be
+// now, the CLOCK_MONOTONIC time (ns) a paced file catches up with them,
+// or -1 for a stream that has not received them yet (its notify callback
+// fires as frames arrive).
+long audio_ready_at(const AudioContext *ctx, size_t num_frames);
+
+// Channels captured for 'config': stereo when a window shows the oscilloscope
+// (which draws both), mono otherwise.
+int audio_capture_channels(const RavizConfig *config);
+
+// Frames per capture read: fft_size, or ~4 ms blocks for the oscilloscope
+// so the window it shows is never more than a few ms old.
+int audio_block_frames(const RavizConfig *config);
+
+// Read raw frames into buffer, interleaved when audio_channels() > 1.
+// Returns number of frames read; a stream from audio_open_stream returns
+// 0 instead of waiting while fewer than 'num_frames' have arrived. 'buffer' must hold
+// 'num_frames' * audio_channels() samples.
+size_t audio_read(AudioContext *ctx, int16_t *buffer, size_t num_frames);
+
+// Channels per frame returned by audio_read
+int audio_channels(const AudioContext *ctx);
+
+// Actual sample rate (a WAV file may differ from config->audio_rate)
+int audio_sample_rate(const AudioContext *ctx);
+
+// Non-zero once a file source has been fully consumed or a stream failed
+int audio_eof(const AudioContext *ctx);
 
 // Cleanup
 void audio_cleanup(AudioContext *ctx);
@@ -0,0 +1,469 @@
+#define _POSIX_C_SOURCE 200809L
+#include "capture.h"
+#include "../utils/arena.h"
+#include "../utils/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <limits.h>
+
+#define MAX_WORKERS 8
+#define IDLE_NS 100000000L     // Longest a worker sleeps without a wakeup (100 ms)
+#define BLOCKS_PER_TURN 8      // Reads before a worker moves on, so an unpaced file can't hog it
+#define MAILBOX_FRESH 4        // In 'shared': the slot there has not been read yet
+#define CLICK_THRESHOLD 8192   // --latency-test: peak that counts as a click
+
+typedef struct {
+    CapturePool *pool;
+    int index;
+    RavizConfig config;     // This source's capture settings
+    AudioContext *audio;
+    FFTContext *fft;
+    ScopeTap *tap;
+    int block;              // Frames per read
+    int fill;               // Samples of the next analysis window so far
+
+    // Worker side: the latest hop, copied into a slot on every publish
+    Arena arena;
+    int16_t *samples;
+    float *bins;
+    ChromaFrame chroma;
+    unsigned long hop_seq;
+    long hop_time_ns;
+    unsigned long scope_seq;
+    int stopped;
+    unsigned long onset_seq;    // --latency-test
+    long onset_arrived_ns;
+    long onset_analysed_ns;
+    int click_held;             // The previous window was loud too
+
+    // Triple-buffered mailbox: the worker fills slots[back] and swaps it
+    // into 'shared'; the reader swaps 'shared' for slots[front] when it
+    // holds a fresh one. Neither side ever waits for the other.
+    CaptureFrame slots[3];
+    float *slot_bins[3];
+    int16_t *slot_scope[3];
+    int back;
+    int shared;
+    int front;
+
+    // Scheduling, under pool->mutex
+    int busy;               // A worker is servicing it
+    int pending;            // Frames arrived since it was last serviced
+    int ended;
+    long ready_at;          // See audio_ready_at
+} Source;
+
+struct CapturePool {
+    Source sources[MAX_AUDIO_SOURCES];
+    int count;
+    AudioServer *server;    // Shared by the device sources, if any
+    int inline_mode;        // config->single_thread: no workers, capture_run does their job
+    pthread_t workers[MAX_WORKERS];
+    int num_workers;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work;    // Workers: a source may be ready
+    pthread_cond_t updated; // capture_wait: a source published or ended
+    unsigned long updates;
+    int ended;
+    int next;               // Round-robin start of the next search
+    int stop;
+    int trigger;
+    float trigger_level;
+};
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void wait_until(pthread_cond_t *cond, pthread_mutex_t *mutex, long deadline_ns) {
+    struct timespec ts = {deadline_ns / 1000000000L, deadline_ns % 1000000000L};
+    pthread_cond_timedwait(cond, mutex, &ts);
+}
+
+size_t capture_read_block(AudioContext *audio, ScopeTap *tap, int16_t *mono, int frames) {
+    if (!tap) return audio_read(audio, mono, frames);
+    int16_t *stereo = scope_tap_reserve(tap);
+    size_t n = audio_read(audio, stereo, frames);
+    for (size_t i = 0; i < n; ++i) mono[i] = (int16_t)((stereo[2 * i] + stereo[2 * i + 1]) / 2);
+    scope_tap_commit(tap, (int)n);
+    return n;
+}
+
+int capture_scope_tap(const AudioContext *audio, const RavizConfig *cfg, int block, ScopeTap **tap) {
+    *tap = NULL;
+    if (audio_channels(audio) != 2) return 1;
+    *tap = scope_tap_init(cfg->scope_samples, block);
+    return *tap != NULL;
+}
+
+// Server thread: frames arrived for this source
+static void source_notify(void *user) {
+    Source *s = (Source*)user;
+    CapturePool *pool = s->pool;
+    pthread_mutex_lock(&pool->mutex);
+    s->pending = 1;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static int source_open(CapturePool *pool, Source *s, const RavizConfig *config, const AudioSource *src) {
+    s->pool = pool;
+    s->config = *config;
+    // Only the first source feeds the oscilloscope: the rest capture mono
+    // in whole analysis windows
+    if (s->index > 0) {
+        s->config.scene = SCENE_SPHERE;
+        s->config.num_windows = 0;
+    }
+
+    const char *name = src->name;
+    int legacy_file = config->num_sources == 0 && config->input_file;
+    if (legacy_file || (name && strncmp(name, "file:", 5) == 0)) {
+        s->config.input_file = (char*)(legacy_file ? name : name + 5);
+        s->audio = audio_init(&s->config);
+    } else {
+        if (!pool->server) pool->server = pool->inline_mode ? audio_server_init_polled() : audio_server_init();
+        s->audio = audio_open_stream(pool->server, &s->config, name, source_notify, s);
+    }
+    if (!s->audio) return 0;
+
+    // Bin mapping and chroma kernels follow the real input rate
+    s->config.audio_rate = audio_sample_rate(s->audio);
+    s->fft = fft_init(&s->config);
+    s->block = audio_block_frames(&s->config);
+    if (!s->fft || !capture_scope_tap(s->audio, &s->config, s->block, &s->tap)) return 0;
+
+    int bins = s->config.fft_bins;
+    size_t scope_bytes = s->tap ? (size_t)scope_tap_frames(s->tap) * 2 * sizeof(int16_t) : 0;
+    arena_reserve(&s->arena, s->config.fft_size * sizeof(int16_t));
+    arena_reserve(&s->arena, bins * sizeof(float));
+    for (int i = 0; i < 3; ++i) {
+        arena_reserve(&s->arena, bins * sizeof(float));
+        if (scope_bytes) arena_reserve(&s->arena, scope_bytes);
+    }
+    if (!arena_init(&s->arena)) return 0;
+    s->samples = arena_alloc(&s->arena, s->config.fft_size * sizeof(int16_t));
+    s->bins = arena_alloc(&s->arena, bins * sizeof(float));
+    s->chroma.key = -1;
+    for (int i = 0; i < 3; ++i) {
+        s->slot_bins[i] = arena_alloc(&s->arena, bins * sizeof(float));
+        s->slot_scope[i] = scope_bytes ? arena_alloc(&s->arena, scope_bytes) : NULL;
+        s->slots[i].bins = s->slot_bins[i];
+        s->slots[i].chroma.key = -1;
+    }
+    s->back = 0;
+    s->shared = 1;
+    s->front = 2;
+    return 1;
+}
+
+// Hand the latest hop (and a new oscilloscope window, if any) to the reader
+static void source_publish(Source *s, const int16_t *window) {
+    CaptureFrame *f = &s->slots[s->back];
+    memcpy(s->slot_bins[s->back], s->bins, s->config.fft_bins * sizeof(float));
+    f->chroma = s->chroma;
+    f->hop_seq = s->hop_seq;
+    f->hop_time_ns = s->hop_time_ns;
+    f->ended = s->stopped;
+    f->onset_seq = s->onset_seq;
+    f->onset_arrived_ns = s->onset_arrived_ns;
+    f->onset_analysed_ns = s->onset_analysed_ns;
+    if (window) {
+        // Slots without a new window keep an older one with a lower seq
+        f->scope_frames = scope_tap_frames(s->tap);
+        memcpy(s->slot_scope[s->back], window, (size_t)f->scope_frames * 2 * sizeof(int16_t));
+        f->scope = s->slot_scope[s->back];
+        f->scope_seq = ++s->scope_seq;
+    }
+    s->back = __atomic_exchange_n(&s->shared, s->back | MAILBOX_FRESH, __ATOMIC_ACQ_REL) & 3;
+}
+
+// --latency-test: the null sink carries nothing but clicks, so a window
+// whose peak crosses the threshold after a quiet one holds a new click
+static void detect_click(Source *s, long arrived) {
+    int loud = 0;
+    for (int i = 0; i < s->config.fft_size && !loud; ++i) {
+        loud = s->samples[i] >= CLICK_THRESHOLD || s->samples[i] <= -CLICK_THRESHOLD;
+    }
+    if (loud && !s->click_held) {
+        s->onset_seq++;
+        s->onset_arrived_ns = arrived;
+        s->onset_analysed_ns = now_ns();
+    }
+    s->click_held = loud;
+}
+
+// Read and analyse whatever is ready. Returns the number of frames
+// published; '*ready_at' says when to come back (see audio_ready_at) and
+// '*ended' is set once the source has nothing more to give.
+static int source_service(Source *s, int trigger, float level, long *ready_at, int *ended) {
+    int published = 0;
+    for (int turn = 0; turn < BLOCKS_PER_TURN; ++turn) {
+        // Small blocks while a tap wants fresh oscilloscope windows; the
+        // FFT still runs once per fft_size samples
+        int want = s->config.fft_size - s->fill;
+        if (want > s->block) want = s->block;
+        long at = audio_ready_at(s->audio, want);
+        if (at != 0) {
+            *ready_at = at;
+            return published;
+        }
+        size_t read = capture_read_block(s->audio, s->tap, s->samples + s->fill, want);
+        if (read < (size_t)want) {
+            if (!audio_eof(s->audio)) continue;
+            // Silence from here on, so a finished source drops out of the mix
+            memset(s->bins, 0, s->config.fft_bins * sizeof(float));
+            s->hop_seq++;
+            s->hop_time_ns = now_ns();
+            s->stopped = 1;
+            source_publish(s, NULL);
+            *ended = 1;
+            return published + 1;
+        }
+        long arrived = now_ns();
+
+        const int16_t *window = scope_tap_window(s->tap, trigger, level);
+        fft_push_samples(s->fft, s->samples + s->fill, (int)read);
+        s->fill += (int)read;
+        int hop = s->fill == s->config.fft_size;
+        if (hop) {
+            s->fill = 0;
+            fft_process(s->fft, s->samples, s->bins);
+            s->chroma = *fft_chroma(s->fft);
+            if (s->config.latency_test) detect_click(s, arrived);
+            s->hop_seq++;
+            s->hop_time_ns = arrived;
+        }
+        if (hop || window) {
+            source_publish(s, window);
+            published++;
+        }
+    }
+    *ready_at = 0;
+    return published;
+}
+
+// A source due for service, round-robin from pool->next, or NULL. '*wake'
+// is lowered to the earliest time a paced file becomes due. Under the
+// pool mutex.
+static Source* pick_ready(CapturePool *pool, long now, long *wake) {
+    for (int k = 0; k < pool->count; ++k) {
+        Source *s = &pool->sources[(pool->next + k) % pool->count];
+        if (s->busy || s->ended) continue;
+        if (s->pending || (s->ready_at >= 0 && s->ready_at <= now)) {
+            pool->next = (s->index + 1) % pool->count;
+            return s;
+        }
+        if (s->ready_at > 0 && s->ready_at < *wake) *wake = s->ready_at;
+    }
+    return NULL;
+}
+
+// Under the pool mutex, after source_service
+static void service_done(CapturePool *pool, Source *s, long ready_at, int ended, int published) {
+    s->busy = 0;
+    s->ready_at = ready_at;
+    if (ended) {
+        s->ended = 1;
+        pool->ended++;
+    }
+    if (published || ended) {
+        pool->updates++;
+        pthread_cond_broadcast(&pool->updated);
+    }
+}
+
+static void* worker_func(void *arg) {
+    CapturePool *pool = (CapturePool*)arg;
+    log_thread_name("capture");
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->stop) {
+        long wake = now_ns() + IDLE_NS;
+        Source *pick = pick_ready(pool, now_ns(), &wake);
+        if (!pick) {
+            wait_until(&pool->work, &pool->mutex, wake);
+            continue;
+        }
+
+        pick->busy = 1;
+        pick->pending = 0;
+        int trigger = pool->trigger;
+        float level = pool->trigger_level;
+        pthread_mutex_unlock(&pool->mutex);
+
+        long ready_at = 0;
+        int ended = 0;
+        int published = source_service(pick, trigger, level, &ready_at, &ended);
+
+        pthread_mutex_lock(&pool->mutex);
+        service_done(pool, pick, ready_at, ended, published);
+        // Still ready: hand it to an idle worker rather than only this one
+        if (ready_at == 0 && !ended) pthread_cond_signal(&pool->work);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+CapturePool* capture_init(const RavizConfig *config) {
+    CapturePool *pool = calloc(1, sizeof(CapturePool));
+    if (!pool) return NULL;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work, &attr);
+    pthread_cond_init(&pool->updated, &attr);
+    pthread_condattr_destroy(&attr);
+    pool->trigger = !config->scope_xy;
+    pool->trigger_level = config->scope_trigger;
+    pool->inline_mode = config->single_thread;
+
+    AudioSource sources[MAX_AUDIO_SOURCES];
+    int count = config_audio_sources(config, sources);
+    for (int i = 0; i < count; ++i) {
+        Source *s = &pool->sources[i];
+        s->index = i;
+        pool->count = i + 1;
+        if (!source_open(pool, s, config, &sources[i])) {
+            log_error("Capture", "Cannot open source %d (%s)", i + 1, sources[i].name ? sources[i].name : "default");
+            capture_cleanup(pool);
+            return NULL;
+        }
+    }
+
+    if (pool->inline_mode) return pool;
+
+    int workers = config->audio_workers;
+    if (workers <= 0) workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > count) workers = count;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+    if (workers < 1) workers = 1;
+    for (int i = 0; i < workers; ++i) {
+        if (pthread_create(&pool->workers[i], NULL, worker_func, pool) != 0) break;
+        pool->num_workers++;
+    }
+    if (pool->num_workers == 0) {
+        log_error("Capture", "Cannot start analysis workers");
+        capture_cleanup(pool);
+        return NULL;
+    }
+    if (count > 1) log_info("Capture", "%d sources on %d worker(s)", count, pool->num_workers);
+    return pool;
+}
+
+int capture_run(CapturePool *pool, int wake_fd, int timeout_ms) {
+    // Sleep only if nothing is ready, and no longer than the next paced file
+    long now = now_ns();
+    long wake = LONG_MAX;
+    pthread_mutex_lock(&pool->mutex);
+    if (pick_ready(pool, now, &wake)) timeout_ms = 0;
+    pthread_mutex_unlock(&pool->mutex);
+    if (wake != LONG_MAX) {
+        int due_ms = (int)((wake - now + 999999) / 1000000);
+        if (timeout_ms < 0 || due_ms < timeout_ms) timeout_ms = due_ms;
+    }
+
+    int woke;
+    if (pool->server) {
+        woke = audio_server_iterate(pool->server, wake_fd, timeout_ms);
+    } else {
+        struct pollfd fd = {wake_fd, POLLIN, 0};
+        woke = poll(&fd, wake_fd >= 0 ? 1 : 0, timeout_ms) > 0;
+    }
+
+    // Each ready source once per call, so the caller's fd is never kept waiting
+    now = now_ns();
+    pthread_mutex_lock(&pool->mutex);
+    for (int k = 0; k < pool->count; ++k) {
+        Source *pick = pick_ready(pool, now, &wake);
+        if (!pick) break;
+        pick->pending = 0;
+        pthread_mutex_unlock(&pool->mutex);
+
+        long ready_at = 0;
+        int ended = 0;
+        int published = source_service(pick, pool->trigger, pool->trigger_level, &ready_at, &ended);
+
+        pthread_mutex_lock(&pool->mutex);
+        service_done(pool, pick, ready_at, ended, published);
+        pick->busy = 1;     // Done for this call
+    }
+    for (int i = 0; i < pool->count; ++i) pool->sources[i].busy = 0;
+    pthread_mutex_unlock(&pool->mutex);
+    return woke;
+}
+
+int capture_count(const CapturePool *pool) {
+    return pool ? pool->count : 0;
+}
+
+int capture_sample_rate(const CapturePool *pool) {
+    return pool && pool->count > 0 ? audio_sample_rate(pool->sources[0].audio) : 0;
+}
+
+unsigned long capture_wait(CapturePool *pool, unsigned long seen, long timeout_ns) {
+    long deadline = now_ns() + timeout_ns;
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->updates == seen && pool->ended < pool->count && now_ns() < deadline) {
+        wait_until(&pool->updated, &pool->mutex, deadline);
+    }
+    unsigned long updates = pool->updates;
+    pthread_mutex_unlock(&pool->mutex);
+    return updates;
+}
+
+const CaptureFrame* capture_latest(CapturePool *pool, int i) {
+    Source *s = &pool->sources[i];
+    if (__atomic_load_n(&s->shared, __ATOMIC_ACQUIRE) & MAILBOX_FRESH) {
+        s->front = __atomic_exchange_n(&s->shared, s->front, __ATOMIC_ACQ_REL) & 3;
+    }
+    return &s->slots[s->front];
+}
+
+int capture_finished(CapturePool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    int finished = pool->ended == pool->count;
+    pthread_mutex_unlock(&pool->mutex);
+    return finished;
+}
+
+void capture_set_trigger(CapturePool *pool, int trigger, float level) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->trigger = trigger;
+    pool->trigger_level = level;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void capture_cleanup(CapturePool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->num_workers; ++i) pthread_join(pool->workers[i], NULL);
+
+    // Streams before the server: closing one still needs its thread
+    for (int i = 0; i < pool->count; ++i) {
+        Source *s = &pool->sources[i];
+        audio_cleanup(s->audio);
+        scope_tap_cleanup(s->tap);
+        if (s->fft) fft_cleanup(s->fft);
+        arena_release(&s->arena);
+    }
+    audio_server_cleanup(pool->server);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->updated);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
@@ -0,0 +1,81 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "audio.h"
+#include "scope_tap.h"
+#include "../fft/fft.h"
+#include "../utils/config.h"
+
+typedef struct CapturePool CapturePool;
+
+// Capture and analysis of every configured source (config_audio_sources).
+// Each source has its own stream, FFT and window; a fixed pool of worker
+// threads (config->audio_workers) services whichever sources have a block
+// ready, so eight sources cost eight streams, not eight threads. Device
+// sources share one PulseAudio connection; "file:<path>" sources are
+// paced WAV files. Only the first source captures stereo for the
+// oscilloscope.
+//
+// Results come out through capture_latest, one lock-free mailbox per
+// source: a worker never waits for the reader and the reader never waits
+// for a worker.
+//
+// With config->single_thread there are no workers and the server has no
+// thread either: the caller's loop runs capture_run, which sleeps in
+// PulseAudio's poll and analyses what arrived on the calling thread.
+
+// Latest analysis of one source. Pointers stay valid until the next
+// capture_latest call for the same source.
+typedef struct {
+    const float *bins;      // config->fft_bins values
+    ChromaFrame chroma;
+    unsigned long hop_seq;  // Hops analysed so far
+    long hop_time_ns;       // CLOCK_MONOTONIC arrival of the latest hop's samples
+    const int16_t *scope;   // Oscilloscope window (first source only), or NULL
+    int scope_frames;
+    unsigned long scope_seq;
+    int ended;              // Final frame (silence): the source has stopped
+    unsigned long onset_seq; // --latency-test: clicks detected so far
+    long onset_arrived_ns;  // The latest one's window: arrival of its samples
+    long onset_analysed_ns; // ... and when its analysis finished
+} CaptureFrame;
+
+// Opens every source and starts the workers. NULL if any source fails.
+CapturePool* capture_init(const RavizConfig *config);
+
+// Single-thread pool: sleep until a stream has frames, a paced file is
+// due, 'wake_fd' (-1: none) is readable or 'timeout_ms' (-1: none)
+// passes, then service every ready source once. Returns 1 if 'wake_fd'
+// is readable.
+int capture_run(CapturePool *pool, int wake_fd, int timeout_ms);
+
+int capture_count(const CapturePool *pool);
+
+// Sample rate of the first source
+int capture_sample_rate(const CapturePool *pool);
+
+// Block until some source has published since update 'seen' (or
+// 'timeout_ns' passes) and return the current update count.
+unsigned long capture_wait(CapturePool *pool, unsigned long seen, long timeout_ns);
+
+// The newest frame of source 'i'. Call from one thread only.
+const CaptureFrame* capture_latest(CapturePool *pool, int i);
+
+// Non-zero once every source has ended (files consumed, streams failed)
+int capture_finished(CapturePool *pool);
+
+// Oscilloscope trigger for the first source, applied from its next block
+void capture_set_trigger(CapturePool *pool, int trigger, float level);
+
+void capture_cleanup(CapturePool *pool);
+
+// Capture 'frames' into 'mono'. Stereo captures (oscilloscope scene) go
+// into the tap's history and are downmixed into 'mono' for analysis.
+size_t capture_read_block(AudioContext *audio, ScopeTap *tap, int16_t *mono, int frames);
+
+// The oscilloscope's trigger history, for a stereo capture only, taking
+// reads of up to 'block' frames. Returns 0 if one is needed but cannot
+// be allocated.
+int capture_scope_tap(const AudioContext *audio, const RavizConfig *cfg, int block, ScopeTap **tap);
+
+#endif
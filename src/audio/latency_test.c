@@ -0,0 +1,356 @@
+#define _POSIX_C_SOURCE 200809L
+#include "latency_test.h"
+#include "../utils/arena.h"
+#include "../utils/log.h"
+#include <pulse/stream.h>
+#include <pulse/thread-mainloop.h>
+#include <pulse/error.h>
+#include <pulse/def.h>
+#include <pulse/introspect.h>
+#include <pulse/context.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SINK_NAME "raviz_latency"
+#define CLICK_INTERVAL_MS 500   // Far above any sane latency, so each onset has one candidate click
+#define FIRST_CLICK_MS 1000     // Streams connect and the first frames settle
+#define SETTLE_MS 1000          // Time the last click gets to come through
+#define GIVE_UP_MS 5000         // Past the schedule: the clicks are not playing
+#define CLICK_MS 1
+#define CLICK_LEVEL 24000
+#define WRITE_CHUNK 1024        // Frames per pa_stream_write
+
+enum {
+    STAGE_CAPTURE,
+    STAGE_ANALYSIS,
+    STAGE_MIX,
+    STAGE_FRAME,
+    STAGE_SUBMIT,
+    STAGE_SHOWN,
+    STAGE_TOTAL,
+    STAGE_COUNT
+};
+
+struct LatencyTest {
+    pa_threaded_mainloop *loop;
+    pa_context *context;
+    pa_stream *stream;
+    uint32_t module;        // Null sink loaded by us, or PA_INVALID_INDEX
+    int found;              // Sink lookup saw it
+    uint32_t loaded;        // load_module's answer
+
+    int rate;
+    int clicks;
+    long interval_frames;
+    long first_frame;
+    long click_frames;
+    long written;           // Frames written so far (server thread)
+    int16_t *chunk;
+
+    long *played;           // When each click reaches the sink; written by the server thread
+    int scheduled;          // Clicks with a 'played' time (release-stored)
+    long give_up_ns;
+
+    LatencyMark *marks;     // Measured clicks (render thread)
+    int measured;
+    int last_click;         // Click of the latest mark, so an echo is not counted twice
+    double *scratch;        // Report: one stage's values, sorted
+
+    // For the report header
+    int fft_size;
+    int fps;
+    int frames_ahead;
+    int headless;
+
+    Arena arena;
+};
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void signal_cb(pa_context *c, void *userdata) {
+    pa_threaded_mainloop_signal(((LatencyTest*)userdata)->loop, 0);
+}
+
+static void stream_state_cb(pa_stream *s, void *userdata) {
+    pa_threaded_mainloop_signal(((LatencyTest*)userdata)->loop, 0);
+}
+
+static void sink_info_cb(pa_context *c, const pa_sink_info *i, int eol, void *userdata) {
+    LatencyTest *t = (LatencyTest*)userdata;
+    if (i) t->found = 1;
+    pa_threaded_mainloop_signal(t->loop, 0);
+}
+
+static void module_cb(pa_context *c, uint32_t index, void *userdata) {
+    LatencyTest *t = (LatencyTest*)userdata;
+    t->loaded = index;
+    pa_threaded_mainloop_signal(t->loop, 0);
+}
+
+static void unload_cb(pa_context *c, int success, void *userdata) {
+    pa_threaded_mainloop_signal(((LatencyTest*)userdata)->loop, 0);
+}
+
+// Under the loop lock
+static void wait_op(LatencyTest *t, pa_operation *op) {
+    if (!op) return;
+    while (pa_operation_get_state(op) == PA_OPERATION_RUNNING) pa_threaded_mainloop_wait(t->loop);
+    pa_operation_unref(op);
+}
+
+// Server thread: silence with a click every interval. A click's play time
+// comes from the stream latency right after the write, which covers the
+// last frame written; earlier frames play that much sooner.
+static void write_cb(pa_stream *s, size_t nbytes, void *userdata) {
+    LatencyTest *t = (LatencyTest*)userdata;
+    size_t frames = nbytes / sizeof(int16_t);
+    while (frames > 0) {
+        long n = frames < WRITE_CHUNK ? (long)frames : WRITE_CHUNK;
+        long start = t->written;
+        long click_start = -1;
+        for (long i = 0; i < n; ++i) {
+            long rel = start + i - t->first_frame;
+            int on = rel >= 0 && rel < t->clicks * t->interval_frames && rel % t->interval_frames < t->click_frames;
+            t->chunk[i] = on ? CLICK_LEVEL : 0;
+            if (on && rel % t->interval_frames == 0) click_start = start + i;
+        }
+        pa_stream_write(s, t->chunk, n * sizeof(int16_t), NULL, 0, PA_SEEK_RELATIVE);
+        t->written += n;
+        frames -= n;
+
+        if (click_start >= 0) {
+            long now = now_ns();
+            long ahead = -(t->written - click_start) * 1000000000L / t->rate;
+            pa_usec_t latency;
+            int negative = 0;
+            if (pa_stream_get_latency(s, &latency, &negative) == 0 && !negative) ahead += (long)latency * 1000L;
+            int k = (int)((click_start - t->first_frame) / t->interval_frames);
+            t->played[k] = now + ahead;
+            __atomic_store_n(&t->scheduled, k + 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+// Under the loop lock. Returns 0 if there is no sink to play into.
+static int open_sink(LatencyTest *t) {
+    wait_op(t, pa_context_get_sink_info_by_name(t->context, SINK_NAME, sink_info_cb, t));
+    if (t->found) {
+        log_info("Latency", "Using the existing sink %s", SINK_NAME);
+        return 1;
+    }
+    char args[128];
+    snprintf(args, sizeof(args), "sink_name=%s rate=%d channels=1 sink_properties=device.description=Raviz-latency-test",
+             SINK_NAME, t->rate);
+    t->loaded = PA_INVALID_INDEX;
+    wait_op(t, pa_context_load_module(t->context, "module-null-sink", args, module_cb, t));
+    if (t->loaded == PA_INVALID_INDEX) {
+        log_error("Latency", "Cannot load module-null-sink: %s", pa_strerror(pa_context_errno(t->context)));
+        return 0;
+    }
+    t->module = t->loaded;
+    return 1;
+}
+
+// Under the loop lock
+static int start_clicks(LatencyTest *t) {
+    pa_sample_spec ss;
+    ss.format = PA_SAMPLE_S16LE;
+    ss.rate = t->rate;
+    ss.channels = 1;
+    // A short target buffer: the play time is computed either way, but a
+    // long one would delay the first click
+    pa_buffer_attr ba;
+    ba.maxlength = (uint32_t)-1;
+    ba.tlength = t->rate / 50 * sizeof(int16_t);
+    ba.prebuf = (uint32_t)-1;
+    ba.minreq = (uint32_t)-1;
+    ba.fragsize = (uint32_t)-1;
+
+    t->stream = pa_stream_new(t->context, "Latency clicks", &ss, NULL);
+    if (!t->stream) return 0;
+    pa_stream_set_state_callback(t->stream, stream_state_cb, t);
+    pa_stream_set_write_callback(t->stream, write_cb, t);
+    pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_ADJUST_LATENCY;
+    if (pa_stream_connect_playback(t->stream, SINK_NAME, &ba, flags, NULL, NULL) < 0) return 0;
+    for (;;) {
+        pa_stream_state_t state = pa_stream_get_state(t->stream);
+        if (state == PA_STREAM_READY) return 1;
+        if (state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) return 0;
+        pa_threaded_mainloop_wait(t->loop);
+    }
+}
+
+LatencyTest* latency_test_init(const RavizConfig *config) {
+    LatencyTest *t = calloc(1, sizeof(LatencyTest));
+    if (!t) return NULL;
+    t->module = PA_INVALID_INDEX;
+    t->rate = config->audio_rate;
+    t->clicks = config->latency_clicks > 0 ? config->latency_clicks : 1;
+    t->interval_frames = (long)t->rate * CLICK_INTERVAL_MS / 1000;
+    t->first_frame = (long)t->rate * FIRST_CLICK_MS / 1000;
+    t->click_frames = (long)t->rate * CLICK_MS / 1000;
+    if (t->click_frames < 1) t->click_frames = 1;
+    t->last_click = -1;
+    t->fft_size = config->fft_size;
+    t->fps = config->fps;
+    t->frames_ahead = config->max_frames_ahead;
+    t->headless = config->headless;
+
+    arena_reserve(&t->arena, WRITE_CHUNK * sizeof(int16_t));
+    arena_reserve(&t->arena, t->clicks * sizeof(long));
+    arena_reserve(&t->arena, t->clicks * sizeof(LatencyMark));
+    arena_reserve(&t->arena, t->clicks * sizeof(double));
+    if (!arena_init(&t->arena)) {
+        free(t);
+        return NULL;
+    }
+    t->chunk = arena_alloc(&t->arena, WRITE_CHUNK * sizeof(int16_t));
+    t->played = arena_alloc(&t->arena, t->clicks * sizeof(long));
+    t->marks = arena_alloc(&t->arena, t->clicks * sizeof(LatencyMark));
+    t->scratch = arena_alloc(&t->arena, t->clicks * sizeof(double));
+
+    t->loop = pa_threaded_mainloop_new();
+    if (!t->loop || pa_threaded_mainloop_start(t->loop) < 0) {
+        log_error("Latency", "Could not start the PulseAudio thread");
+        if (t->loop) pa_threaded_mainloop_free(t->loop);
+        t->loop = NULL;
+        latency_test_cleanup(t);
+        return NULL;
+    }
+
+    pa_threaded_mainloop_lock(t->loop);
+    int ok = 0;
+    t->context = pa_context_new(pa_threaded_mainloop_get_api(t->loop), "Raviz latency test");
+    if (t->context) {
+        pa_context_set_state_callback(t->context, signal_cb, t);
+        if (pa_context_connect(t->context, NULL, PA_CONTEXT_NOFLAGS, NULL) >= 0) {
+            for (;;) {
+                pa_context_state_t state = pa_context_get_state(t->context);
+                if (state == PA_CONTEXT_READY) {
+                    ok = 1;
+                    break;
+                }
+                if (state == PA_CONTEXT_FAILED || state == PA_CONTEXT_TERMINATED) break;
+                pa_threaded_mainloop_wait(t->loop);
+            }
+        }
+    }
+    if (!ok) {
+        log_error("Latency", "Error connecting to PulseAudio: %s",
+                pa_strerror(t->context ? pa_context_errno(t->context) : 0));
+    } else if (!open_sink(t)) {
+        ok = 0;
+    } else if (!start_clicks(t)) {
+        log_error("Latency", "Cannot play into %s: %s", SINK_NAME, pa_strerror(pa_context_errno(t->context)));
+        ok = 0;
+    }
+    pa_threaded_mainloop_unlock(t->loop);
+    if (!ok) {
+        latency_test_cleanup(t);
+        return NULL;
+    }
+
+    t->give_up_ns = now_ns() + (FIRST_CLICK_MS + (long)t->clicks * CLICK_INTERVAL_MS + GIVE_UP_MS) * 1000000L;
+    log_info("Latency", "Playing %d click(s) into %s, %d ms apart", t->clicks, SINK_NAME, CLICK_INTERVAL_MS);
+    return t;
+}
+
+const char* latency_test_monitor(const LatencyTest *t) {
+    return SINK_NAME ".monitor";
+}
+
+void latency_test_record(LatencyTest *t, const LatencyMark *mark) {
+    if (!t || t->measured == t->clicks) return;
+    // The latest click played before its window was captured
+    int scheduled = __atomic_load_n(&t->scheduled, __ATOMIC_ACQUIRE);
+    int k = scheduled - 1;
+    while (k >= 0 && t->played[k] > mark->arrived) k--;
+    if (k < 0 || k == t->last_click || mark->arrived - t->played[k] >= CLICK_INTERVAL_MS * 1000000L) {
+        log_debug("Latency", "Onset %lu matches no click", mark->seq);
+        return;
+    }
+    LatencyMark *m = &t->marks[t->measured++];
+    *m = *mark;
+    m->played = t->played[k];
+    t->last_click = k;
+    log_debug("Latency", "Click %d: %.1f ms", k + 1, (m->shown - m->played) / 1.0e6);
+}
+
+int latency_test_done(const LatencyTest *t) {
+    if (!t) return 0;
+    long now = now_ns();
+    if (now >= t->give_up_ns) return 1;
+    if (__atomic_load_n(&t->scheduled, __ATOMIC_ACQUIRE) < t->clicks) return 0;
+    return t->measured == t->clicks || now >= t->played[t->clicks - 1] + SETTLE_MS * 1000000L;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Milliseconds spent in 'stage' by mark 'm'
+static double stage_ms(const LatencyMark *m, int stage) {
+    long t[STAGE_TOTAL + 1] = {m->played, m->arrived, m->analysed, m->mixed, m->frame, m->submitted, m->shown};
+    if (stage == STAGE_TOTAL) return (m->shown - m->played) / 1.0e6;
+    return (t[stage + 1] - t[stage]) / 1.0e6;
+}
+
+int latency_test_report(const LatencyTest *t) {
+    if (!t) return 0;
+    static const char *names[STAGE_COUNT] = {
+        "sink -> capture", "analysis", "mix", "wait for frame", "draw + submit", NULL, "total"
+    };
+    log_info("Latency", "%d of %d click(s) measured (FFT %d @ %d Hz, %d fps, %d frame(s) ahead%s)",
+             t->measured, t->clicks, t->fft_size, t->rate, t->fps, t->frames_ahead, t->headless ? ", headless" : "");
+    if (t->measured > 0) {
+        log_info("Latency", "%-16s %8s %8s %8s %8s %8s", "stage (ms)", "min", "median", "p95", "max", "mean");
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            double sum = 0.0;
+            for (int i = 0; i < t->measured; ++i) {
+                t->scratch[i] = stage_ms(&t->marks[i], s);
+                sum += t->scratch[i];
+            }
+            qsort(t->scratch, t->measured, sizeof(double), compare_double);
+            int n = t->measured;
+            int p95 = (95 * n + 99) / 100 - 1;    // Nearest rank
+            const char *name = names[s] ? names[s] : t->headless ? "readback" : "GPU done";
+            log_info("Latency", "%-16s %8.1f %8.1f %8.1f %8.1f %8.1f", name, t->scratch[0],
+                     t->scratch[(n - 1) / 2], t->scratch[p95], t->scratch[n - 1], sum / n);
+        }
+    }
+    if (2 * t->measured < t->clicks) {
+        log_error("Latency", "Too few clicks came through: is the sink monitor being captured?");
+        return 0;
+    }
+    return 1;
+}
+
+void latency_test_cleanup(LatencyTest *t) {
+    if (!t) return;
+    if (t->loop) {
+        pa_threaded_mainloop_lock(t->loop);
+        if (t->stream) {
+            pa_stream_disconnect(t->stream);
+            pa_stream_unref(t->stream);
+        }
+        if (t->module != PA_INVALID_INDEX) {
+            wait_op(t, pa_context_unload_module(t->context, t->module, unload_cb, t));
+        }
+        if (t->context) {
+            pa_context_disconnect(t->context);
+            pa_context_unref(t->context);
+        }
+        pa_threaded_mainloop_unlock(t->loop);
+        pa_threaded_mainloop_stop(t->loop);
+        pa_threaded_mainloop_free(t->loop);
+    }
+    arena_release(&t->arena);
+    free(t);
+}
@@ -0,0 +1,45 @@
+#ifndef LATENCY_TEST_H
+#define LATENCY_TEST_H
+
+#include "../utils/config.h"
+
+typedef struct LatencyTest LatencyTest;
+
+// One click's way through the pipeline: when it passed each stage,
+// CLOCK_MONOTONIC ns. Filled in by the stage that reaches it.
+typedef struct {
+    unsigned long seq;  // Onsets detected so far, this one included
+    long played;        // Its first sample reached the sink
+    long arrived;       // Capture read the end of the window holding it
+    long analysed;      // That window's FFT ran and the onset was detected
+    long mixed;         // The mixer handed the hop to the render side
+    long frame;         // A frame sampled it
+    long submitted;     // That frame was swapped (or queued for readback)
+    long shown;         // It finished on the GPU (or was written out)
+} LatencyMark;
+
+// --latency-test: plays config->latency_clicks clicks, 500 ms apart, into
+// a PulseAudio null sink, creating the sink unless one by that name
+// exists. Capture its monitor (latency_test_monitor) and every click
+// comes back as an onset; the stages after it fill in a LatencyMark each.
+// NULL if the server or the sink is unavailable.
+LatencyTest* latency_test_init(const RavizConfig *config);
+
+// Source to capture: the null sink's monitor
+const char* latency_test_monitor(const LatencyTest *t);
+
+// A click made it to the screen. Matches it to the click that caused it
+// and keeps it for the report; an onset no click explains is ignored.
+void latency_test_record(LatencyTest *t, const LatencyMark *mark);
+
+// Non-zero once every click has played and had time to come through
+int latency_test_done(const LatencyTest *t);
+
+// Log the latency distribution of each stage. Returns 0 if fewer than
+// half the clicks were measured.
+int latency_test_report(const LatencyTest *t);
+
+// Stops the clicks and removes the sink if latency_test_init created it
+void latency_test_cleanup(LatencyTest *t);
+
+#endif
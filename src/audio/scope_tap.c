@@ -0,0 +1,92 @@
+#include "scope_tap.h"
+#include "../utils/config.h"
+#include "../utils/arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_WINDOW 256
+// Hysteresis below the trigger level (of 32768): noise riding on a slow
+// edge must not re-arm the trigger on every wiggle
+#define HYSTERESIS 512
+
+struct ScopeTap {
+    Arena arena;
+    int16_t *frames;    // Interleaved stereo, oldest first
+    int capacity;       // Frames
+    int used;
+    int window;
+    int max_block;
+};
+
+ScopeTap* scope_tap_init(int window, int max_block) {
+    if (window < MIN_WINDOW) window = MIN_WINDOW;
+    if (window > SCOPE_MAX_FRAMES) window = SCOPE_MAX_FRAMES;
+    if (max_block < 1) return NULL;
+
+    ScopeTap *tap = calloc(1, sizeof(ScopeTap));
+    if (!tap) return NULL;
+    tap->window = window;
+    tap->max_block = max_block;
+    // Two windows are searched for an edge; the rest is headroom so the
+    // history is only shifted back every couple of windows
+    tap->capacity = 4 * window + max_block;
+    arena_reserve(&tap->arena, (size_t)tap->capacity * 2 * sizeof(int16_t));
+    if (!arena_init(&tap->arena)) {
+        free(tap);
+        return NULL;
+    }
+    tap->frames = arena_alloc(&tap->arena, (size_t)tap->capacity * 2 * sizeof(int16_t));
+    return tap;
+}
+
+int scope_tap_frames(const ScopeTap *tap) {
+    return tap ? tap->window : 0;
+}
+
+int16_t* scope_tap_reserve(ScopeTap *tap) {
+    if (tap->used + tap->max_block > tap->capacity) {
+        int keep = 2 * tap->window;
+        if (keep > tap->used) keep = tap->used;
+        memmove(tap->frames, tap->frames + 2 * (tap->used - keep), (size_t)keep * 2 * sizeof(int16_t));
+        tap->used = keep;
+    }
+    return tap->frames + 2 * tap->used;
+}
+
+void scope_tap_commit(ScopeTap *tap, int frames) {
+    if (frames > tap->max_block) frames = tap->max_block;
+    if (frames > 0) tap->used += frames;
+}
+
+const int16_t* scope_tap_window(const ScopeTap *tap, int trigger, float level) {
+    if (!tap || tap->used < tap->window) return NULL;
+
+    int last = tap->used - tap->window;   // Latest start with a full window
+    int start = last;
+    if (trigger) {
+        int first = last - tap->window;
+        if (first < 0) first = 0;
+        int threshold = (int)(level * 32767.0f);
+        int armed = 0;
+        int found = -1;
+        for (int i = first; i <= last; ++i) {
+            const int16_t *f = tap->frames + 2 * i;
+            int mid = (f[0] + f[1]) / 2;
+            if (mid < threshold - HYSTERESIS) {
+                armed = 1;
+            } else if (armed && mid >= threshold) {
+                found = i;
+                armed = 0;
+            }
+        }
+        if (found >= 0) start = found;
+    }
+    return tap->frames + 2 * start;
+}
+
+void scope_tap_cleanup(ScopeTap *tap) {
+    if (tap) {
+        arena_release(&tap->arena);
+        free(tap);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef SCOPE_TAP_H
+#define SCOPE_TAP_H
+
+#include <stdint.h>
+
+typedef struct ScopeTap ScopeTap;
+
+// Trigger stabilisation for the oscilloscope scene. Captured stereo
+// blocks go straight into the tap's history; scope_tap_window then picks
+// the window that starts at the latest rising edge, so a periodic signal
+// stands still on screen instead of drifting with the block boundaries.
+//
+// 'window' is clamped to 256..SCOPE_MAX_FRAMES; 'max_block' is the largest
+// block ever captured in one read.
+ScopeTap* scope_tap_init(int window, int max_block);
+
+// Frames per window after clamping.
+int scope_tap_frames(const ScopeTap *tap);
+
+// Where to capture the next block of up to 'max_block' interleaved stereo
+// frames. Call scope_tap_commit with the number actually written.
+int16_t* scope_tap_reserve(ScopeTap *tap);
+void scope_tap_commit(ScopeTap *tap, int frames);
+
+// The current window (interleaved stereo, scope_tap_frames() long), valid
+// until the next scope_tap_reserve. With 'trigger' set it starts at the
+// latest rising crossing of 'level' (-1..1, mid channel) that still has a
+// full window after it, or free-runs from the newest samples if there is
+// none. NULL until a full window has been captured.
+const int16_t* scope_tap_window(const ScopeTap *tap, int trigger, float level);
+
+void scope_tap_cleanup(ScopeTap *tap);
+
+#endif
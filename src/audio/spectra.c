@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+#include "spectra.h"
+#include "../utils/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RECORD_PREFIX 16   // int64 t_ns + uint64 seq
+// Index entries reserved up front: 4096 x 64 records is over an hour of
+// live capture before recording has to grow the index
+#define INDEX_RESERVE 4096
+
+typedef struct {
+    int64_t t_ns;
+    uint64_t record;
+} IndexEntry;
+
+struct SpectraWriter {
+    FILE *f;
+    SpectraHeader header;
+    int64_t first_ns;
+    int ok;
+
+    IndexEntry *index;
+    uint64_t index_cap;
+};
+
+struct SpectraReader {
+    const unsigned char *map;
+    size_t size;
+    const SpectraHeader *header;
+    long count;
+    const unsigned char *index;   // May be unaligned: read with memcpy
+    long index_count;
+};
+
+SpectraWriter* spectra_create(const char *path, int num_bins, int sample_rate, int fft_size) {
+    if (num_bins <= 0) return NULL;
+    if (num_bins > SPECTRA_MAX_BINS) {
+        log_error("Spectra", "Cannot record %d bins (at most %d)", num_bins, SPECTRA_MAX_BINS);
+        return NULL;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        log_error("Spectra", "Cannot create %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    SpectraWriter *w = calloc(1, sizeof(SpectraWriter));
+    if (!w) {
+        fclose(f);
+        return NULL;
+    }
+    w->f = f;
+    w->ok = 1;
+    w->index = malloc(INDEX_RESERVE * sizeof(IndexEntry));
+    w->index_cap = w->index ? INDEX_RESERVE : 0;
+    // Hops are small; let stdio batch them into page-sized writes
+    setvbuf(f, NULL, _IOFBF, 1 << 16);
+
+    memcpy(w->header.magic, SPECTRA_MAGIC, 8);
+    w->header.version = SPECTRA_VERSION;
+    w->header.header_size = sizeof(SpectraHeader);
+    w->header.num_bins = (uint32_t)num_bins;
+    w->header.record_size = RECORD_PREFIX + 4 * (uint32_t)num_bins;
+    w->header.sample_rate = (uint32_t)sample_rate;
+    w->header.fft_size = (uint32_t)fft_size;
+    if (fwrite(&w->header, sizeof(w->header), 1, f) != 1) w->ok = 0;
+
+    log_info("Spectra", "Recording %d-bin frames to %s", num_bins, path);
+    return w;
+}
+
+int spectra_append(SpectraWriter *w, uint64_t seq, long time_ns, const float *bins) {
+    if (!w || !w->ok) return 0;
+
+    uint64_t n = w->header.record_count;
+    if (n == 0) {
+        w->first_ns = time_ns;
+        w->header.start_ns = time_ns;
+    }
+    int64_t t = (int64_t)time_ns - w->first_ns;
+
+    if (n % SPECTRA_INDEX_STRIDE == 0) {
+        uint64_t slot = n / SPECTRA_INDEX_STRIDE;
+        if (slot >= w->index_cap) {
+            uint64_t cap = w->index_cap ? w->index_cap * 2 : INDEX_RESERVE;
+            IndexEntry *grown = realloc(w->index, cap * sizeof(IndexEntry));
+            if (!grown) {
+                w->ok = 0;
+                return 0;
+            }
+            w->index = grown;
+            w->index_cap = cap;
+        }
+        w->index[slot].t_ns = t;
+        w->index[slot].record = n;
+    }
+
+    int ok = fwrite(&t, sizeof(t), 1, w->f) == 1 &&
+             fwrite(&seq, sizeof(seq), 1, w->f) == 1 &&
+             fwrite(bins, sizeof(float), w->header.num_bins, w->f) == w->header.num_bins;
+    if (!ok) {
+        log_error("Spectra", "Write failed, recording stopped: %s", strerror(errno));
+        w->ok = 0;
+        return 0;
+    }
+    w->header.record_count = n + 1;
+    return 1;
+}
+
+void spectra_close(SpectraWriter *w) {
+    if (!w) return;
+
+    if (w->ok) {
+        uint64_t records = w->header.record_count;
+        w->header.index_count = (records + SPECTRA_INDEX_STRIDE - 1) / SPECTRA_INDEX_STRIDE;
+        w->header.index_offset = w->header.header_size + records * w->header.record_size;
+        int ok = fwrite(w->index, sizeof(IndexEntry), w->header.index_count, w->f) == w->header.index_count &&
+                 fseek(w->f, 0, SEEK_SET) == 0 &&
+                 fwrite(&w->header, sizeof(w->header), 1, w->f) == 1;
+        if (!ok) log_warn("Spectra", "Could not finalise recording (still readable without index)");
+        log_info("Spectra", "Recorded %llu frames", (unsigned long long)records);
+    }
+    fclose(w->f);
+    free(w->index);
+    free(w);
+}
+
+SpectraReader* spectra_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_error("Spectra", "Cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SpectraHeader)) {
+        log_error("Spectra", "%s is not a spectra recording", path);
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_error("Spectra", "mmap %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    const SpectraHeader *h = map;
+    size_t size = st.st_size;
+    int valid = memcmp(h->magic, SPECTRA_MAGIC, 8) == 0 && h->version == SPECTRA_VERSION &&
+                h->header_size >= sizeof(SpectraHeader) && h->header_size <= size &&
+                h->num_bins > 0 && h->num_bins <= SPECTRA_MAX_BINS &&
+                (uint64_t)h->record_size == RECORD_PREFIX + 4 * (uint64_t)h->num_bins;
+    if (!valid) {
+        log_error("Spectra", "%s is not a spectra recording", path);
+        munmap(map, size);
+        return NULL;
+    }
+
+    SpectraReader *r = calloc(1, sizeof(SpectraReader));
+    if (!r) {
+        munmap(map, size);
+        return NULL;
+    }
+    r->map = map;
+    r->size = size;
+    r->header = h;
+
+    // Only trust an index that fits the file
+    size_t records_end = size;
+    if (h->index_count > 0 && h->index_offset >= h->header_size && h->index_offset <= size &&
+        h->index_count <= (size - h->index_offset) / sizeof(IndexEntry)) {
+        r->index = r->map + h->index_offset;
+        r->index_count = (long)h->index_count;
+        records_end = h->index_offset;
+    }
+    // The index follows the records: never replay it as frames
+    long available = (long)((records_end - h->header_size) / h->record_size);
+    r->count = (h->record_count > 0 && h->record_count <= (uint64_t)available) ? (long)h->record_count : available;
+
+    log_info("Spectra", "Replaying %s: %ld frames, %u bins%s", path, r->count, h->num_bins,
+           r->index ? "" : " (no index)");
+    return r;
+}
+
+const SpectraHeader* spectra_header(const SpectraReader *r) {
+    return r ? r->header : NULL;
+}
+
+long spectra_count(const SpectraReader *r) {
+    return r ? r->count : 0;
+}
+
+const float* spectra_record(const SpectraReader *r, long i, int64_t *t_ns) {
+    const unsigned char *rec = r->map + r->header->header_size + (size_t)i * r->header->record_size;
+    if (t_ns) memcpy(t_ns, rec, sizeof(int64_t));
+    return (const float*)(rec + RECORD_PREFIX);
+}
+
+static int64_t record_time(const SpectraReader *r, long i) {
+    int64_t t;
+    spectra_record(r, i, &t);
+    return t;
+}
+
+static IndexEntry index_entry(const SpectraReader *r, long i) {
+    IndexEntry e;
+    memcpy(&e, r->index + (size_t)i * sizeof(IndexEntry), sizeof(e));
+    return e;
+}
+
+long spectra_find(const SpectraReader *r, int64_t t_ns) {
+    if (!r || r->count == 0 || t_ns < record_time(r, 0)) return -1;
+
+    // Narrow to one index stride, then search the records inside it
+    long lo = 0, hi = r->count - 1;
+    if (r->index) {
+        long a = 0, b = r->index_count - 1;
+        while (a < b) {
+            long mid = (a + b + 1) / 2;
+            if (index_entry(r, mid).t_ns <= t_ns) a = mid;
+            else b = mid - 1;
+        }
+        lo = (long)index_entry(r, a).record;
+        if (lo >= r->count) lo = r->count - 1;
+        if (hi > lo + SPECTRA_INDEX_STRIDE - 1) hi = lo + SPECTRA_INDEX_STRIDE - 1;
+    }
+    while (lo < hi) {
+        long mid = (lo + hi + 1) / 2;
+        if (record_time(r, mid) <= t_ns) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+void spectra_release(SpectraReader *r) {
+    if (r) {
+        munmap((void*)r->map, r->size);
+        free(r);
+    }
+}
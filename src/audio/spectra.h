@@ -0,0 +1,64 @@
+#ifndef SPECTRA_H
+#define SPECTRA_H
+
+#include <stdint.h>
+
+// Recorded analysis frames (--record-spectra / --replay-spectra).
+//
+// File layout, little endian:
+//   SpectraHeader (64 bytes)
+//   records: 'record_count' x { int64 t_ns; uint64 seq; float bins[num_bins] }
+//   index:   'index_count' x { int64 t_ns; uint64 record }, one entry per
+//            SPECTRA_INDEX_STRIDE records
+// Records are appended as they arrive; the index is written and the
+// header's counts patched on close. A file whose writer died has counts of
+// zero and is still readable: the record count follows from the file size
+// and lookups fall back to searching the records themselves.
+
+#define SPECTRA_MAGIC "RVZSPEC1"
+#define SPECTRA_VERSION 1
+#define SPECTRA_INDEX_STRIDE 64
+#define SPECTRA_MAX_BINS 16384  // Widest frame written or accepted (a 32768-point FFT)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;   // Offset of the first record
+    uint32_t num_bins;
+    uint32_t record_size;   // 16 + 4 * num_bins
+    uint32_t sample_rate;
+    uint32_t fft_size;
+    int64_t start_ns;       // CLOCK_MONOTONIC of the first record (informational)
+    uint64_t record_count;  // 0 until closed cleanly
+    uint64_t index_offset;
+    uint64_t index_count;
+} SpectraHeader;
+
+typedef struct SpectraWriter SpectraWriter;
+typedef struct SpectraReader SpectraReader;
+
+// Create 'path' for 'num_bins'-wide frames. Returns NULL (and logs) on failure.
+SpectraWriter* spectra_create(const char *path, int num_bins, int sample_rate, int fft_size);
+
+// Append one frame. 'time_ns' is any monotonic clock; it is stored
+// relative to the first frame. Returns 0 once writing has failed.
+int spectra_append(SpectraWriter *w, uint64_t seq, long time_ns, const float *bins);
+
+// Write the index, patch the header and close.
+void spectra_close(SpectraWriter *w);
+
+// Map a recording read-only. Returns NULL (and logs) on failure.
+SpectraReader* spectra_open(const char *path);
+
+const SpectraHeader* spectra_header(const SpectraReader *r);
+long spectra_count(const SpectraReader *r);
+
+// Bins of record 'i' (pointing into the mapping); its time in '*t_ns'.
+const float* spectra_record(const SpectraReader *r, long i, int64_t *t_ns);
+
+// Last record at or before 't_ns', or -1 if 't_ns' precedes the first.
+long spectra_find(const SpectraReader *r, int64_t t_ns);
+
+void spectra_release(SpectraReader *r);
+
+#endif
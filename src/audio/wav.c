@@ -0,0 +1,135 @@
+#include "wav.h"
+#include "../utils/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WAV_FORMAT_PCM        1
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+#define WAV_MAX_CHANNELS      8
+
+struct WavReader {
+    FILE *f;
+    int rate;
+    int channels;
+    size_t frames_left;
+};
+
+static uint32_t read_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+WavReader* wav_open(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        log_error("Audio", "Cannot open %s", path);
+        return NULL;
+    }
+
+    uint8_t riff[12];
+    if (fread(riff, 1, 12, f) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        log_error("Audio", "%s is not a RIFF/WAVE file", path);
+        fclose(f);
+        return NULL;
+    }
+
+    int rate = 0, channels = 0, bits = 0, format = 0;
+    for (;;) {
+        uint8_t hdr[8];
+        if (fread(hdr, 1, 8, f) != 8) {
+            log_error("Audio", "%s has no data chunk", path);
+            fclose(f);
+            return NULL;
+        }
+        uint32_t size = read_u32(hdr + 4);
+
+        if (memcmp(hdr, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, f) != 16) break;
+            format = read_u16(fmt);
+            channels = read_u16(fmt + 2);
+            rate = (int)read_u32(fmt + 4);
+            bits = read_u16(fmt + 14);
+            fseek(f, (long)(size - 16 + (size & 1)), SEEK_CUR);
+        } else if (memcmp(hdr, "data", 4) == 0) {
+            if ((format != WAV_FORMAT_PCM && format != WAV_FORMAT_EXTENSIBLE) || bits != 16 ||
+                channels < 1 || channels > WAV_MAX_CHANNELS || rate <= 0) {
+                log_error("Audio", "%s: only 16-bit PCM WAV is supported", path);
+                break;
+            }
+            WavReader *wav = malloc(sizeof(WavReader));
+            if (!wav) break;
+            wav->f = f;
+            wav->rate = rate;
+            wav->channels = channels;
+            wav->frames_left = size / (2 * channels);
+            return wav;
+        } else {
+            // Chunks are word aligned
+            fseek(f, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    fclose(f);
+    return NULL;
+}
+
+size_t wav_read_mono(WavReader *wav, int16_t *buffer, size_t num_frames) {
+    if (num_frames > wav->frames_left) num_frames = wav->frames_left;
+
+    if (wav->channels == 1) {
+        size_t n = fread(buffer, sizeof(int16_t), num_frames, wav->f);
+        wav->frames_left -= n;
+        return n;
+    }
+
+    int16_t frame[WAV_MAX_CHANNELS];
+    size_t n = 0;
+    for (; n < num_frames; ++n) {
+        if (fread(frame, sizeof(int16_t), wav->channels, wav->f) != (size_t)wav->channels) break;
+        int sum = 0;
+        for (int c = 0; c < wav->channels; ++c) sum += frame[c];
+        buffer[n] = (int16_t)(sum / wav->channels);
+    }
+    wav->frames_left -= n;
+    return n;
+}
+
+size_t wav_read_stereo(WavReader *wav, int16_t *buffer, size_t num_frames) {
+    if (num_frames > wav->frames_left) num_frames = wav->frames_left;
+
+    if (wav->channels == 2) {
+        size_t n = fread(buffer, 2 * sizeof(int16_t), num_frames, wav->f);
+        wav->frames_left -= n;
+        return n;
+    }
+
+    int16_t frame[WAV_MAX_CHANNELS];
+    size_t n = 0;
+    for (; n < num_frames; ++n) {
+        if (fread(frame, sizeof(int16_t), wav->channels, wav->f) != (size_t)wav->channels) break;
+        buffer[2 * n] = frame[0];
+        buffer[2 * n + 1] = wav->channels > 1 ? frame[1] : frame[0];
+    }
+    wav->frames_left -= n;
+    return n;
+}
+
+int wav_sample_rate(const WavReader *wav) {
+    return wav->rate;
+}
+
+int wav_channels(const WavReader *wav) {
+    return wav->channels;
+}
+
+void wav_close(WavReader *wav) {
+    if (wav) {
+        fclose(wav->f);
+        free(wav);
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct WavReader WavReader;
+
+// Open a 16-bit PCM WAV file. Returns NULL (and logs) on failure.
+WavReader* wav_open(const char *path);
+
+// Read up to 'num_frames' frames, downmixed to mono. Returns frames read;
+// less than requested only at end of file.
+size_t wav_read_mono(WavReader *wav, int16_t *buffer, size_t num_frames);
+
+// Read up to 'num_frames' interleaved stereo frames: mono files are
+// duplicated into both channels, wider files keep their first two.
+size_t wav_read_stereo(WavReader *wav, int16_t *buffer, size_t num_frames);
+
+int wav_sample_rate(const WavReader *wav);
+int wav_channels(const WavReader *wav);
+
+void wav_close(WavReader *wav);
+
+#endif
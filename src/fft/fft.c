@@ -1,9 +1,39 @@
 #include "fft.h"
+#include "../utils/arena.h"
 #include <fftw3.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
 
+// Chroma covers C3-C7. It needs bins narrower than a semitone at the
+// bottom of that range, far finer than fft_size gives, so it runs its own
+// longer FFT over the most recent samples. Nothing above C7 is needed, so
+// those samples are low-passed and decimated first: the same resolution
+// then takes a quarter to an eighth of the FFT size.
+#define CHROMA_MIN_HZ 130.81
+#define CHROMA_MAX_HZ 2093.0
+#define CHROMA_MAX_SIZE 8192
+#define DECIMATE_TAPS 64        // Power of two: the FIR input is a masked ring
+#define CHROMA_SMOOTHING 0.7f   // Per hop: follows chord changes, not single notes
+#define KEY_DECAY 0.995f        // Per hop: the key looks back several seconds
+
+// The per-hop loops over the FFT input and output. With RAVIZ_TARGET_CLONES
+// they are compiled once per instruction set and the loader picks the best
+// one for the CPU at startup (x86-64, GCC or Clang).
+#if defined(RAVIZ_TARGET_CLONES) && defined(__x86_64__) && defined(__GNUC__)
+#define HOT_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define HOT_KERNEL
+#endif
+
+// Krumhansl-Kessler key profiles, tonic first
+static const float major_profile[CHROMA_CLASSES] = {
+    6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f
+};
+static const float minor_profile[CHROMA_CLASSES] = {
+    6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f
+};
+
 struct FFTContext {
     int size;
     int num_bins;
@@ -13,11 +43,101 @@ struct FFTContext {
     float *prev_bins; 
     float smoothing_factor;
     float *window;    
+    float *temp_bins; // Unsmoothed magnitudes of the current hop
     float max_peak;   // Auto-gain control
+
+    // Chroma analysis: its own FFT over the last chroma_size decimated samples
+    int chroma_size;
+    int decimation;
+    int decimate_phase;
+    int fir_pos;
+    float fir_in[DECIMATE_TAPS];     // Ring of the latest input samples
+    float fir[DECIMATE_TAPS];        // Windowed-sinc low-pass
+    float *history;        // Ring of decimated samples, oldest at history_pos
+    int history_pos;
+    float *chroma_window;
+    double *chroma_in;
+    fftw_complex *chroma_out;
+    fftw_plan chroma_plan;
+
+    // Sparse chroma kernels: the spectrum bins feeding pitch class k are
+    // chroma_bin[chroma_start[k] .. chroma_start[k + 1]), each weighted by
+    // how close the bin is to the centre of a semitone of that class
+    int chroma_start[CHROMA_CLASSES + 1];
+    int *chroma_bin;
+    float *chroma_weight;
+    float key_profiles[2 * CHROMA_CLASSES][CHROMA_CLASSES]; // Zero mean, unit norm
+    float key_chroma[CHROMA_CLASSES];   // Long-term chroma the key is read from
+    ChromaFrame chroma;
+
+    Arena arena;      // Backs every array above
 };
 
+// Fractional MIDI note of spectrum bin 'j', or -1 if the bin is outside
+// the chroma range or too coarse to tell neighbouring semitones apart
+static double bin_pitch(int j, int size, int rate) {
+    double df = (double)rate / size;
+    double f = j * df;
+    if (f < CHROMA_MIN_HZ || f > CHROMA_MAX_HZ) return -1.0;
+    if (f * (pow(2.0, 1.0 / 12.0) - 1.0) < df) return -1.0;
+    return 69.0 + 12.0 * log2(f / 440.0);
+}
+
+// Largest power of two keeping the decimated rate above 4x CHROMA_MAX_HZ,
+// which leaves the low-pass a comfortable transition band
+static int chroma_decimation(int rate) {
+    int d = 1;
+    while (d < 16 && rate / (2 * d) >= 4 * CHROMA_MAX_HZ) d *= 2;
+    return d;
+}
+
+static void build_decimator(FFTContext *ctx, int rate) {
+    double cutoff = 1.25 * CHROMA_MAX_HZ / rate;   // Cycles per input sample
+    double sum = 0.0;
+    for (int i = 0; i < DECIMATE_TAPS; ++i) {
+        double t = i - (DECIMATE_TAPS - 1) / 2.0;
+        double sinc = 2.0 * cutoff * (t == 0.0 ? 1.0 : sin(2.0 * M_PI * cutoff * t) / (2.0 * M_PI * cutoff * t));
+        double blackman = 0.42 - 0.5 * cos(2.0 * M_PI * i / (DECIMATE_TAPS - 1)) +
+                          0.08 * cos(4.0 * M_PI * i / (DECIMATE_TAPS - 1));
+        ctx->fir[i] = (float)(sinc * blackman);
+        sum += ctx->fir[i];
+    }
+    for (int i = 0; i < DECIMATE_TAPS; ++i) ctx->fir[i] /= (float)sum;
+}
+
+// Smallest power of two whose bins are a semitone wide at CHROMA_MIN_HZ
+static int chroma_fft_size(int rate) {
+    int size = 1024;
+    while (size < CHROMA_MAX_SIZE && CHROMA_MIN_HZ * (pow(2.0, 1.0 / 12.0) - 1.0) < (double)rate / size) size *= 2;
+    return size;
+}
+
+static int pitch_class(double pitch) {
+    return ((int)lround(pitch) % 12 + 12) % 12;
+}
+
+static void build_key_profiles(FFTContext *ctx) {
+    for (int k = 0; k < 2 * CHROMA_CLASSES; ++k) {
+        const float *profile = k < CHROMA_CLASSES ? major_profile : minor_profile;
+        int tonic = k % CHROMA_CLASSES;
+        float *p = ctx->key_profiles[k];
+        float mean = 0.0f, norm = 0.0f;
+        for (int i = 0; i < CHROMA_CLASSES; ++i) {
+            p[(tonic + i) % CHROMA_CLASSES] = profile[i];
+            mean += profile[i];
+        }
+        mean /= CHROMA_CLASSES;
+        for (int i = 0; i < CHROMA_CLASSES; ++i) {
+            p[i] -= mean;
+            norm += p[i] * p[i];
+        }
+        norm = sqrtf(norm);
+        for (int i = 0; i < CHROMA_CLASSES; ++i) p[i] /= norm;
+    }
+}
+
 FFTContext* fft_init(const RavizConfig *config) {
-    FFTContext *ctx = malloc(sizeof(FFTContext));
+    FFTContext *ctx = calloc(1, sizeof(FFTContext));
     if (!ctx) return NULL;
 
     ctx->size = config->fft_size;
@@ -25,27 +145,204 @@ FFTContext* fft_init(const RavizConfig *config) {
     ctx->smoothing_factor = config->smoothing;
     ctx->max_peak = 1.0f; // Initial guess
 
-    ctx->in = (double*)fftw_malloc(sizeof(double) * ctx->size);
-    ctx->out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * (ctx->size / 2 + 1));
-    ctx->prev_bins = calloc(ctx->num_bins, sizeof(float));
-    ctx->window = malloc(sizeof(float) * ctx->size);
+    size_t in_size = sizeof(double) * ctx->size;
+    size_t out_size = sizeof(fftw_complex) * (ctx->size / 2 + 1);
+    size_t bins_size = sizeof(float) * ctx->num_bins;
+    size_t window_size = sizeof(float) * ctx->size;
+
+    ctx->decimation = chroma_decimation(config->audio_rate);
+    int rate = config->audio_rate / ctx->decimation;   // Of the chroma history
+    ctx->chroma_size = chroma_fft_size(rate);
+    size_t history_size = sizeof(float) * ctx->chroma_size;
+    size_t chroma_in_size = sizeof(double) * ctx->chroma_size;
+    size_t chroma_out_size = sizeof(fftw_complex) * (ctx->chroma_size / 2 + 1);
+    int chroma_spectrum = ctx->chroma_size / 2 + 1;
+    for (int j = 1; j < chroma_spectrum; ++j) {
+        double pitch = bin_pitch(j, ctx->chroma_size, rate);
+        if (pitch >= 0.0) ctx->chroma_start[pitch_class(pitch) + 1]++;
+    }
+    for (int k = 0; k < CHROMA_CLASSES; ++k) ctx->chroma_start[k + 1] += ctx->chroma_start[k];
+    int kernel_count = ctx->chroma_start[CHROMA_CLASSES];
+
+    arena_reserve(&ctx->arena, in_size);
+    arena_reserve(&ctx->arena, out_size);
+    arena_reserve(&ctx->arena, bins_size);
+    arena_reserve(&ctx->arena, bins_size);
+    arena_reserve(&ctx->arena, window_size);
+    arena_reserve(&ctx->arena, history_size);
+    arena_reserve(&ctx->arena, history_size);
+    arena_reserve(&ctx->arena, chroma_in_size);
+    arena_reserve(&ctx->arena, chroma_out_size);
+    arena_reserve(&ctx->arena, sizeof(int) * kernel_count);
+    arena_reserve(&ctx->arena, sizeof(float) * kernel_count);
+    if (!arena_init(&ctx->arena)) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->in = arena_alloc(&ctx->arena, in_size);
+    ctx->out = arena_alloc(&ctx->arena, out_size);
+    ctx->prev_bins = arena_alloc(&ctx->arena, bins_size);
+    ctx->temp_bins = arena_alloc(&ctx->arena, bins_size);
+    ctx->window = arena_alloc(&ctx->arena, window_size);
+    ctx->history = arena_alloc(&ctx->arena, history_size);
+    ctx->chroma_window = arena_alloc(&ctx->arena, history_size);
+    ctx->chroma_in = arena_alloc(&ctx->arena, chroma_in_size);
+    ctx->chroma_out = arena_alloc(&ctx->arena, chroma_out_size);
+    ctx->chroma_bin = arena_alloc(&ctx->arena, sizeof(int) * kernel_count);
+    ctx->chroma_weight = arena_alloc(&ctx->arena, sizeof(float) * kernel_count);
 
     ctx->plan = fftw_plan_dft_r2c_1d(ctx->size, ctx->in, ctx->out, FFTW_ESTIMATE);
+    ctx->chroma_plan = fftw_plan_dft_r2c_1d(ctx->chroma_size, ctx->chroma_in, ctx->chroma_out, FFTW_ESTIMATE);
 
     for (int i = 0; i < ctx->size; ++i) {
         ctx->window[i] = 0.5 * (1 - cos(2 * M_PI * i / (ctx->size - 1)));
     }
 
+    for (int i = 0; i < ctx->chroma_size; ++i) {
+        ctx->chroma_window[i] = 0.5 * (1 - cos(2 * M_PI * i / (ctx->chroma_size - 1)));
+    }
+
+    int fill[CHROMA_CLASSES];
+    memcpy(fill, ctx->chroma_start, sizeof(fill));
+    for (int j = 1; j < chroma_spectrum; ++j) {
+        double pitch = bin_pitch(j, ctx->chroma_size, rate);
+        if (pitch < 0.0) continue;
+        // Full weight on a semitone centre, none halfway to the next
+        double offset = pitch - lround(pitch);
+        int e = fill[pitch_class(pitch)]++;
+        ctx->chroma_bin[e] = j;
+        ctx->chroma_weight[e] = (float)(cos(M_PI * offset) * cos(M_PI * offset));
+    }
+    build_decimator(ctx, config->audio_rate);
+    build_key_profiles(ctx);
+    ctx->chroma.key = -1;
+
     return ctx;
 }
 
-void fft_process(FFTContext *ctx, const int16_t *input_buffer, float *output_bins) {
+void fft_push_samples(FFTContext *ctx, const int16_t *samples, int count) {
+    // The filter only runs for the samples that are kept
+    for (int i = 0; i < count; ++i) {
+        ctx->fir_in[ctx->fir_pos] = samples[i] / 32768.0f;
+        ctx->fir_pos = (ctx->fir_pos + 1) & (DECIMATE_TAPS - 1);
+        if (++ctx->decimate_phase < ctx->decimation) continue;
+        ctx->decimate_phase = 0;
+
+        float y = 0.0f;
+        for (int k = 0; k < DECIMATE_TAPS; ++k) {
+            y += ctx->fir[k] * ctx->fir_in[(ctx->fir_pos + k) & (DECIMATE_TAPS - 1)];
+        }
+        ctx->history[ctx->history_pos] = y;
+        if (++ctx->history_pos == ctx->chroma_size) ctx->history_pos = 0;
+    }
+}
+
+// One chroma_size FFT, one pass over the sparse kernels (at most one entry
+// per bin) and a 24 x 12 correlation: bounded per hop whatever the signal
+static void update_chroma(FFTContext *ctx) {
+    int n = ctx->chroma_size;
+    for (int i = 0; i < n; ++i) {
+        int h = ctx->history_pos + i;
+        if (h >= n) h -= n;
+        ctx->chroma_in[i] = ctx->history[h] * ctx->chroma_window[i];
+    }
+    fftw_execute(ctx->chroma_plan);
+
+    ChromaFrame *c = &ctx->chroma;
+    float raw[CHROMA_CLASSES];
+    float peak = 0.0f;
+    for (int k = 0; k < CHROMA_CLASSES; ++k) {
+        double energy = 0.0;
+        for (int e = ctx->chroma_start[k]; e < ctx->chroma_start[k + 1]; ++e) {
+            const double *x = ctx->chroma_out[ctx->chroma_bin[e]];
+            energy += ctx->chroma_weight[e] * (x[0] * x[0] + x[1] * x[1]);
+        }
+        raw[k] = (float)sqrt(energy);
+        if (raw[k] > peak) peak = raw[k];
+    }
+    if (peak <= 0.0f) return;
+
+    // Hue: chroma-weighted mean angle, pitch classes ordered by fifths so
+    // related harmonies get neighbouring colours
+    float hx = 0.0f, hy = 0.0f;
+    for (int k = 0; k < CHROMA_CLASSES; ++k) {
+        c->chroma[k] = c->chroma[k] * CHROMA_SMOOTHING + raw[k] / peak * (1.0f - CHROMA_SMOOTHING);
+        ctx->key_chroma[k] = ctx->key_chroma[k] * KEY_DECAY + c->chroma[k] * (1.0f - KEY_DECAY);
+        float angle = 2.0f * (float)M_PI * ((7 * k) % CHROMA_CLASSES) / CHROMA_CLASSES;
+        hx += c->chroma[k] * cosf(angle);
+        hy += c->chroma[k] * sinf(angle);
+    }
+    // A flat chroma (noise, drums) has no direction: keep the last hue
+    if (hx * hx + hy * hy > 1e-4f) {
+        float hue = atan2f(hy, hx) / (2.0f * (float)M_PI);
+        c->hue = hue < 0.0f ? hue + 1.0f : hue;
+    }
+
+    // Key: Pearson correlation against the 24 rotated profiles
+    float mean = 0.0f, norm = 0.0f;
+    float centred[CHROMA_CLASSES];
+    for (int k = 0; k < CHROMA_CLASSES; ++k) mean += ctx->key_chroma[k];
+    mean /= CHROMA_CLASSES;
+    for (int k = 0; k < CHROMA_CLASSES; ++k) {
+        centred[k] = ctx->key_chroma[k] - mean;
+        norm += centred[k] * centred[k];
+    }
+    if (norm <= 1e-12f) return;
+    norm = sqrtf(norm);
+    int best = -1;
+    float best_r = -2.0f;
+    for (int key = 0; key < 2 * CHROMA_CLASSES; ++key) {
+        float r = 0.0f;
+        for (int k = 0; k < CHROMA_CLASSES; ++k) r += centred[k] * ctx->key_profiles[key][k];
+        if (r > best_r) {
+            best_r = r;
+            best = key;
+        }
+    }
+    c->key = best;
+    c->key_strength = best_r / norm;
+}
+
+// Scale 'n' samples to -1..1 and window them into 'out'. Returns the sum
+// of squares of the unwindowed samples.
+static HOT_KERNEL double window_input(double *out, const int16_t *in, const float *window, int n) {
     double sum_sq = 0.0;
-    for (int i = 0; i < ctx->size; ++i) {
-        double val = (double)input_buffer[i] / 32768.0;
+    for (int i = 0; i < n; ++i) {
+        double val = (double)in[i] / 32768.0;
         sum_sq += val * val;
-        ctx->in[i] = val * ctx->window[i];
+        out[i] = val * window[i];
+    }
+    return sum_sq;
+}
+
+// Mean magnitude of each of 'num_bins' runs of 'chunk_size' spectrum
+// bins, skipping DC. Returns the largest (at least 0.0001).
+static HOT_KERNEL float bin_magnitudes(const fftw_complex *spectrum, int spectrum_size, int chunk_size,
+                                       int num_bins, float *bins) {
+    float frame_peak = 0.0001f;
+    for (int i = 0; i < num_bins; ++i) {
+        double mag_sum = 0;
+        int start = 1 + i * chunk_size; 
+        int end = start + chunk_size;
+        if (end > spectrum_size) end = spectrum_size;
+        int count = 0;
+
+        for (int j = start; j < end; ++j) {
+            double re = spectrum[j][0];
+            double im = spectrum[j][1];
+            mag_sum += sqrt(re * re + im * im);
+            count++;
+        }
+        
+        float val = (count > 0) ? (float)(mag_sum / count) : 0.0f;
+        bins[i] = val;
+        if (val > frame_peak) frame_peak = val;
     }
+    return frame_peak;
+}
+
+void fft_process(FFTContext *ctx, const int16_t *input_buffer, float *output_bins) {
+    double sum_sq = window_input(ctx->in, input_buffer, ctx->window, ctx->size);
     double rms = sqrt(sum_sq / ctx->size);
 
     // STRICT SILENCE GATE
@@ -56,6 +353,7 @@ void fft_process(FFTContext *ctx, const int16_t *input_buffer, float *output_bin
     }
 
     fftw_execute(ctx->plan);
+    update_chroma(ctx);
 
     int spectrum_size = ctx->size / 2 + 1;
     
@@ -65,27 +363,8 @@ void fft_process(FFTContext *ctx, const int16_t *input_buffer, float *output_bin
     int chunk_size = (spectrum_size - 1) / ctx->num_bins;
     if (chunk_size < 1) chunk_size = 1;
 
-    float frame_peak = 0.0001f; 
-    float temp_bins[ctx->num_bins];
-
-    for (int i = 0; i < ctx->num_bins; ++i) {
-        double mag_sum = 0;
-        int start = 1 + i * chunk_size; 
-        int end = start + chunk_size;
-        if (end > spectrum_size) end = spectrum_size;
-        int count = 0;
-
-        for (int j = start; j < end; ++j) {
-            double re = ctx->out[j][0];
-            double im = ctx->out[j][1];
-            mag_sum += sqrt(re * re + im * im);
-            count++;
-        }
-        
-        float val = (count > 0) ? (float)(mag_sum / count) : 0.0f;
-        temp_bins[i] = val;
-        if (val > frame_peak) frame_peak = val;
-    }
+    float *temp_bins = ctx->temp_bins;
+    float frame_peak = bin_magnitudes(ctx->out, spectrum_size, chunk_size, ctx->num_bins, temp_bins);
 
     // Auto-Gain Control (AGC) Update
     if (frame_peak > ctx->max_peak) {
@@ -109,13 +388,69 @@ void fft_process(FFTContext *ctx, const int16_t *input_buffer, float *output_bin
     }
 }
 
+const ChromaFrame* fft_chroma(const FFTContext *ctx) {
+    return &ctx->chroma;
+}
+
+const char* fft_key_name(int key) {
+    static const char *names[2 * CHROMA_CLASSES] = {
+        "C major", "C# major", "D major", "Eb major", "E major", "F major",
+        "F# major", "G major", "Ab major", "A major", "Bb major", "B major",
+        "C minor", "C# minor", "D minor", "Eb minor", "E minor", "F minor",
+        "F# minor", "G minor", "G# minor", "A minor", "Bb minor", "B minor"
+    };
+    return key >= 0 && key < 2 * CHROMA_CLASSES ? names[key] : "unknown";
+}
+
+void fft_bands(const float *bins, int num_bins, int sample_rate, int fft_size, float *bands) {
+    static const float edges[FFT_BANDS - 1] = { 300.0f, 4000.0f };
+    int counts[FFT_BANDS] = {0};
+    for (int b = 0; b < FFT_BANDS; ++b) bands[b] = 0.0f;
+    if (num_bins <= 0) return;
+
+    int chunk = (fft_size / 2) / num_bins;
+    if (chunk < 1) chunk = 1;
+    float hz_per_bin = (float)sample_rate / (float)fft_size;
+
+    for (int i = 0; i < num_bins; ++i) {
+        float centre = (1.0f + i * chunk + 0.5f * (chunk - 1)) * hz_per_bin;
+        int b = 0;
+        while (b < FFT_BANDS - 1 && centre >= edges[b]) b++;
+        bands[b] += bins[i];
+        counts[b]++;
+    }
+    for (int b = 0; b < FFT_BANDS; ++b) {
+        if (counts[b] > 0) bands[b] /= counts[b];
+    }
+}
+
+// An onset is a hop whose low band rises clearly above its recent average
+#define BEAT_RATIO       1.35f
+#define BEAT_FLOOR       0.1f
+#define BEAT_AVG_SECONDS 0.5f
+#define BEAT_HOLDOFF_NS  120000000L
+
+int fft_beat(BeatTracker *beat, float low, long now_ns) {
+    float dt = beat->last_ns ? (float)(now_ns - beat->last_ns) / 1.0e9f : 0.0f;
+    beat->last_ns = now_ns;
+    if (dt < 0.0f || dt > 1.0f) dt = 0.0f;
+
+    int onset = low > beat->low_avg * BEAT_RATIO && low > BEAT_FLOOR && low > beat->low_prev &&
+                now_ns - beat->last_beat_ns > BEAT_HOLDOFF_NS;
+    if (onset) beat->last_beat_ns = now_ns;
+
+    float k = dt / BEAT_AVG_SECONDS;
+    if (k > 1.0f) k = 1.0f;
+    beat->low_avg += (low - beat->low_avg) * k;
+    beat->low_prev = low;
+    return onset;
+}
+
 void fft_cleanup(FFTContext *ctx) {
     if (ctx) {
         if (ctx->plan) fftw_destroy_plan(ctx->plan);
-        if (ctx->in) fftw_free(ctx->in);
-        if (ctx->out) fftw_free(ctx->out);
-        free(ctx->prev_bins);
-        free(ctx->window);
+        if (ctx->chroma_plan) fftw_destroy_plan(ctx->chroma_plan);
+        arena_release(&ctx->arena);
         free(ctx);
     }
 }
@@ -6,6 +6,17 @@
 
 typedef struct FFTContext FFTContext;
 
+#define CHROMA_CLASSES 12
+
+// Harmony of the latest hops, from the chroma stage's own FFT over the
+// decimated sample history (see fft_push_samples), not the bins' FFT
+typedef struct {
+    float chroma[CHROMA_CLASSES]; // Smoothed pitch-class energy, C first, loudest = 1
+    float hue;          // Chroma-weighted pitch class on the circle of fifths, 0-1, C = 0
+    int key;            // 0-11: C..B major, 12-23: C..B minor, -1 until known
+    float key_strength; // Correlation with the best key profile, -1 to 1
+} ChromaFrame;
+
 // Initialize FFT subsystem
 FFTContext* fft_init(const RavizConfig *config);
 
@@ -14,6 +25,38 @@ FFTContext* fft_init(const RavizConfig *config);
 // 'output_bins' must be size 'config->fft_bins'.
 void fft_process(FFTContext *ctx, const int16_t *input_buffer, float *output_bins);
 
+// Append newly captured samples (each sample once, unlike the possibly
+// overlapping fft_process windows) to the history the chroma stage reads.
+// The chroma analysis needs far more frequency resolution than fft_size
+// gives, so it runs its own FFT over the newest ~0.2 s of this history.
+void fft_push_samples(FFTContext *ctx, const int16_t *samples, int count);
+
+// Chroma and key estimate as of the last fft_process. Silent hops leave
+// it unchanged.
+const ChromaFrame* fft_chroma(const FFTContext *ctx);
+
+// Bands fft_bands splits the bins into
+enum { FFT_BAND_LOW, FFT_BAND_MID, FFT_BAND_HIGH, FFT_BANDS };  // < 300 Hz, 300 Hz - 4 kHz, above
+
+// Mean magnitude per band of 'num_bins' fft_process bins. Bin i covers
+// FFT bins [1 + i*chunk, 1 + (i+1)*chunk), chunk = (fft_size/2) / num_bins.
+void fft_bands(const float *bins, int num_bins, int sample_rate, int fft_size, float *bands);
+
+// Onset detection on the low band (see fft_beat); zero-initialise
+typedef struct {
+    float low_avg;
+    float low_prev;
+    long last_ns;
+    long last_beat_ns;
+} BeatTracker;
+
+// 1 when 'low' (the FFT_BAND_LOW level at CLOCK_MONOTONIC 'now_ns') is an
+// onset: it rises clearly above its recent average, at most one per 120 ms.
+int fft_beat(BeatTracker *beat, float low, long now_ns);
+
+// "A minor" etc., or "unknown" for key -1
+const char* fft_key_name(int key);
+
 void fft_cleanup(FFTContext *ctx);
 
 #endif
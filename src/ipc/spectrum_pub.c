@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 200809L
+#include "spectrum_pub.h"
+#include "../fft/fft.h"
+#include "../utils/log.h"
+#include "raviz/spectrum_shm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+struct SpectrumPublisher {
+    char name[256];
+    RavizSpectrumShm *shm;
+    uint64_t seq;
+
+    BeatTracker beat;
+};
+
+SpectrumPublisher* publisher_init(const char *name) {
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        log_error("Publish", "shm_open(%s): %s", name, strerror(errno));
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(RavizSpectrumShm)) != 0) {
+        log_error("Publish", "ftruncate(%s): %s", name, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, sizeof(RavizSpectrumShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        log_error("Publish", "mmap(%s): %s", name, strerror(errno));
+        return NULL;
+    }
+
+    SpectrumPublisher *pub = calloc(1, sizeof(SpectrumPublisher));
+    if (!pub) {
+        munmap(p, sizeof(RavizSpectrumShm));
+        return NULL;
+    }
+    snprintf(pub->name, sizeof(pub->name), "%s", name);
+    pub->shm = p;
+
+    // A leftover object from a crashed run may be mid-write: start clean.
+    // Readers see sequence 0 ("nothing yet") until the first frame.
+    __atomic_store_n(&pub->shm->sequence, 0, __ATOMIC_RELEASE);
+    memset(&pub->shm->frame, 0, sizeof(pub->shm->frame));
+    pub->shm->version = RAVIZ_SHM_VERSION;
+    pub->shm->frame_size = sizeof(RavizAnalysisFrame);
+    __atomic_store_n(&pub->shm->magic, RAVIZ_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    log_info("Publish", "Spectrum feed at /dev/shm%s", name);
+    return pub;
+}
+
+void publisher_write(SpectrumPublisher *pub, const float *bins, int num_bins,
+                     int sample_rate, int fft_size, long timestamp_ns) {
+    if (!pub || num_bins <= 0) return;
+    if (num_bins > RAVIZ_SHM_MAX_BINS) num_bins = RAVIZ_SHM_MAX_BINS;
+
+    // Everything is prepared locally so the seqlock is held for one copy
+    RavizAnalysisFrame frame;
+    frame.seq = ++pub->seq;
+    frame.timestamp_ns = timestamp_ns;
+    frame.sample_rate = (uint32_t)sample_rate;
+    frame.fft_size = (uint32_t)fft_size;
+    frame.num_bins = (uint32_t)num_bins;
+    // RAVIZ_BAND_* match the FFT_BAND_* order
+    fft_bands(bins, num_bins, sample_rate, fft_size, frame.bands);
+    frame.flags = fft_beat(&pub->beat, frame.bands[RAVIZ_BAND_LOW], timestamp_ns) ? RAVIZ_FRAME_BEAT : 0;
+    memcpy(frame.bins, bins, num_bins * sizeof(float));
+    memset(frame.bins + num_bins, 0, (RAVIZ_SHM_MAX_BINS - num_bins) * sizeof(float));
+
+    RavizSpectrumShm *shm = pub->shm;
+    uint32_t s = __atomic_load_n(&shm->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&shm->sequence, s + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    shm->frame = frame;
+    __atomic_store_n(&shm->sequence, s + 2, __ATOMIC_RELEASE);
+}
+
+void publisher_cleanup(SpectrumPublisher *pub) {
+    if (pub) {
+        munmap(pub->shm, sizeof(RavizSpectrumShm));
+        shm_unlink(pub->name);
+        free(pub);
+    }
+}
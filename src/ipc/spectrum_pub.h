@@ -0,0 +1,20 @@
+#ifndef SPECTRUM_PUB_H
+#define SPECTRUM_PUB_H
+
+typedef struct SpectrumPublisher SpectrumPublisher;
+
+// Create (or take over) the shared-memory object 'name' (e.g.
+// "/raviz-spectrum") laid out as in include/raviz/spectrum_shm.h.
+// Returns NULL (and logs) on failure.
+SpectrumPublisher* publisher_init(const char *name);
+
+// Publish one analysis hop: 'bins' as produced by fft_process, plus band
+// energies and a beat flag derived here. 'timestamp_ns' is the
+// CLOCK_MONOTONIC arrival time of the hop's samples. Never blocks.
+void publisher_write(SpectrumPublisher *pub, const float *bins, int num_bins,
+                     int sample_rate, int fft_size, long timestamp_ns);
+
+// Unmaps and unlinks the object.
+void publisher_cleanup(SpectrumPublisher *pub);
+
+#endif
@@ -1,8 +1,17 @@
 #define _POSIX_C_SOURCE 199309L
 #include "utils/config.h"
 #include "audio/audio.h"
+#include "audio/spectra.h"
+#include "audio/capture.h"
+#include "audio/latency_test.h"
 #include "fft/fft.h"
 #include "render/render.h"
+#include "utils/watch.h"
+#include "utils/perf.h"
+#include "utils/arena.h"
+#include "utils/alloc_audit.h"
+#include "ipc/spectrum_pub.h"
+#include "utils/log.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,18 +20,66 @@
 #include <time.h>
 #include <pthread.h>
 #include <string.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 // Shared state between Audio Thread and Render Thread (Main)
 typedef struct {
     float *fft_output;
     int fft_bins;
+    unsigned long hop_seq; // Incremented once per analysed hop
+    long hop_time_ns;      // When the latest hop's samples arrived
+    ChromaFrame chroma;    // Harmony of the hue source's latest hop
+    float glow;            // Level of the glow-routed sources
+    int has_glow;
+    LatencyMark onset;     // --latency-test: the latest click, as mixed
     pthread_mutex_t mutex;
     volatile int running;
+    volatile int finished; // Stopped because every source ended (input files)
+
+    // Oscilloscope scene: the latest triggered stereo window
+    int16_t scope[2 * SCOPE_MAX_FRAMES];
+    int scope_frames;
+    unsigned long scope_seq;
     
     // Audio/FFT contexts managed by the thread
     RavizConfig config;
+
+    // Reloaded config for the audio thread to pick up (under mutex)
+    RavizConfig pending;
+    int reload_pending;
 } AudioThreadState;
 
+// Capture sources being opened off to the side while the audio thread
+// keeps mixing the current ones
+typedef struct {
+    pthread_t thread;
+    RavizConfig config;
+    CapturePool *pool;
+    volatile int done;
+} AudioConnect;
+
+// Per-source hops and oscilloscope windows already handed on
+typedef struct {
+    unsigned long hop_seq[MAX_AUDIO_SOURCES];
+    unsigned long scope_seq;
+    unsigned long onset_seq;
+} MixCursor;
+
+// Per-run sample and spectrum buffers of one analysis/render loop, in a
+// single arena. Rebuilt only when a reload changes their sizes.
+typedef struct {
+    Arena arena;
+    int16_t *samples;
+    float *bins;
+} HopBuffers;
+
+// --alloc-audit: frames (or daemon ticks) before allocations count as
+// steady state. Covers FFT planning, shader builds and the driver's
+// first-use allocations.
+#define ALLOC_AUDIT_WARMUP 120
+
 static volatile int keep_running = 1;
 
 void handle_signal(int sig) {
@@ -37,45 +94,913 @@ long get_time_ns() {
     return ts.tv_sec * 1000000000L + ts.tv_nsec;
 }
 
-void* audio_thread_func(void *arg) {
-    AudioThreadState *state = (AudioThreadState*)arg;
-    
-    AudioContext *audio = audio_init(&state->config);
-    if (!audio) {
-        fprintf(stderr, "[Audio] Failed to init audio. Thread exiting.\n");
+static void* connect_thread_func(void *arg) {
+    AudioConnect *c = (AudioConnect*)arg;
+    c->pool = capture_init(&c->config);
+    c->done = 1;
+    return NULL;
+}
+
+static AudioConnect* start_connect(const RavizConfig *config) {
+    AudioConnect *c = calloc(1, sizeof(AudioConnect));
+    if (!c) return NULL;
+    c->config = *config;
+    if (pthread_create(&c->thread, NULL, connect_thread_func, c) != 0) {
+        free(c);
         return NULL;
     }
-    
-    FFTContext *fft = fft_init(&state->config);
-    if (!fft) {
-        fprintf(stderr, "[Audio] Failed to init FFT. Thread exiting.\n");
-        audio_cleanup(audio);
+    return c;
+}
+
+static int hop_buffers_init(HopBuffers *b, int samples, int bins) {
+    memset(b, 0, sizeof(*b));
+    arena_reserve(&b->arena, samples * sizeof(int16_t));
+    arena_reserve(&b->arena, bins * sizeof(float));
+    if (!arena_init(&b->arena)) return 0;
+    b->samples = arena_alloc(&b->arena, samples * sizeof(int16_t));
+    b->bins = arena_alloc(&b->arena, bins * sizeof(float));
+    return 1;
+}
+
+// Settings the capture pool is built from: changing any reopens it
+static int capture_changed(const RavizConfig *a, const RavizConfig *b) {
+    if (config_str_changed(a->audio_device, b->audio_device) || a->audio_rate != b->audio_rate ||
+        a->fft_size != b->fft_size || a->fft_bins != b->fft_bins || a->smoothing != b->smoothing ||
+        audio_capture_channels(a) != audio_capture_channels(b) || a->scope_samples != b->scope_samples ||
+        a->num_sources != b->num_sources || a->audio_workers != b->audio_workers) {
+        return 1;
+    }
+    for (int i = 0; i < a->num_sources; ++i) {
+        if (config_str_changed(a->sources[i].name, b->sources[i].name)) return 1;
+    }
+    return 0;
+}
+
+// Fold every source's latest frame into 'out' by its route: mix sources
+// are summed at their gain, the hue source (else the first mix source)
+// lends its chroma, glow sources add their mean level. The first running
+// mix source is the clock: returns 1 when it has a new hop, so the mix
+// keeps one source's hop rate however many are captured.
+static int mix_sources(const CaptureFrame **frames, int count, const RavizConfig *cfg, MixCursor *cursor,
+                       float *out, ChromaFrame *chroma, float *glow, int *has_glow, long *arrived) {
+    AudioSource src[MAX_AUDIO_SOURCES];
+    config_audio_sources(cfg, src);
+    int bins = cfg->fft_bins;
+    int clock = -1;
+    const ChromaFrame *hue = NULL, *first_mix = NULL;
+    memset(out, 0, bins * sizeof(float));
+    *glow = 0.0f;
+    *has_glow = 0;
+
+    for (int i = 0; i < count; ++i) {
+        const CaptureFrame *f = frames[i];
+        float gain = src[i].gain;
+        switch (src[i].route) {
+            case ROUTE_HUE:
+                if (!hue) hue = &f->chroma;
+                break;
+            case ROUTE_GLOW: {
+                float sum = 0.0f;
+                for (int k = 0; k < bins; ++k) sum += f->bins[k];
+                *glow += gain * (bins > 0 ? sum / bins : 0.0f);
+                *has_glow = 1;
+                break;
+            }
+            default:
+                for (int k = 0; k < bins; ++k) out[k] += gain * f->bins[k];
+                if (!first_mix) first_mix = &f->chroma;
+                if (clock < 0 && !f->ended) clock = i;
+                break;
+        }
+    }
+    if (hue) *chroma = *hue;
+    else if (first_mix) *chroma = *first_mix;
+
+    // Nothing left to mix: any running source keeps hue and glow going
+    for (int i = 0; i < count && clock < 0; ++i) {
+        if (!frames[i]->ended) clock = i;
+    }
+    int fresh = clock >= 0 && frames[clock]->hop_seq != cursor->hop_seq[clock];
+    if (fresh) *arrived = frames[clock]->hop_time_ns;
+    for (int i = 0; i < count; ++i) cursor->hop_seq[i] = frames[i]->hop_seq;
+    return fresh;
+}
+
+// The audio side: the capture pool plus everything that consumes its
+// frames. Driven by the audio thread, or inline by --single-thread.
+typedef struct {
+    RavizConfig cfg;
+    CapturePool *pool;
+    HopBuffers buf;
+    AudioConnect *connecting;
+    SpectrumPublisher *publisher;
+    SpectraWriter *recorder;
+    unsigned long hops;
+    unsigned long updates;  // Pool updates already mixed
+    MixCursor cursor;
+} Mixer;
+
+static int mixer_init(Mixer *m, const RavizConfig *config) {
+    memset(m, 0, sizeof(*m));
+    m->cfg = *config;
+    m->pool = capture_init(&m->cfg);
+    if (!m->pool) {
+        log_error("Audio", "Failed to init audio.");
+        return 0;
+    }
+    if (!hop_buffers_init(&m->buf, 0, m->cfg.fft_bins)) {
+        log_error("Audio", "Out of memory.");
+        capture_cleanup(m->pool);
+        return 0;
+    }
+    m->publisher = m->cfg.publish ? publisher_init(m->cfg.publish_name) : NULL;
+    m->recorder = m->cfg.record_spectra ?
+        spectra_create(m->cfg.record_spectra, m->cfg.fft_bins, capture_sample_rate(m->pool), m->cfg.fft_size) : NULL;
+    return 1;
+}
+
+// Config reload. Routing applies at once; new sources or analysis
+// settings mean a new pool, built before the old one is replaced, so
+// mixing never pauses.
+static void mixer_reload(Mixer *m, AudioThreadState *state) {
+    RavizConfig next;
+    int reload = 0;
+    pthread_mutex_lock(&state->mutex);
+    if (state->reload_pending && !m->connecting) {
+        next = state->pending;
+        state->reload_pending = 0;
+        reload = 1;
+    }
+    pthread_mutex_unlock(&state->mutex);
+
+    if (reload) {
+        m->cfg.scope_xy = next.scope_xy;
+        m->cfg.scope_trigger = next.scope_trigger;
+        capture_set_trigger(m->pool, !m->cfg.scope_xy, m->cfg.scope_trigger);
+        for (int i = 0; i < m->cfg.num_sources && i < next.num_sources; ++i) {
+            m->cfg.sources[i].gain = next.sources[i].gain;
+            m->cfg.sources[i].route = next.sources[i].route;
+        }
+        if (capture_changed(&m->cfg, &next)) {
+            // Opening streams can take a while (server round trips,
+            // monitor lookup): do it on a helper thread
+            m->connecting = start_connect(&next);
+        }
+    }
+
+    AudioConnect *connecting = m->connecting;
+    if (!connecting || !connecting->done) return;
+    pthread_join(connecting->thread, NULL);
+    const RavizConfig *with = &connecting->config;
+    HopBuffers new_buf;
+    int buf_ok = connecting->pool && hop_buffers_init(&new_buf, 0, with->fft_bins);
+    float *shared = buf_ok && with->fft_bins != m->cfg.fft_bins ? calloc(with->fft_bins, sizeof(float)) : NULL;
+    if (buf_ok && (shared || with->fft_bins == m->cfg.fft_bins)) {
+        if (m->recorder && with->fft_bins != m->cfg.fft_bins) {
+            // Records are fixed-size: a new width ends the recording
+            log_warn("Spectra", "fft_bins changed, recording stopped.");
+            spectra_close(m->recorder);
+            m->recorder = NULL;
+        }
+        capture_cleanup(m->pool);
+        arena_release(&m->buf.arena);
+        m->pool = connecting->pool;
+        m->buf = new_buf;
+        if (shared) {
+            pthread_mutex_lock(&state->mutex);
+            float *old = state->fft_output;
+            state->fft_output = shared;
+            state->fft_bins = with->fft_bins;
+            pthread_mutex_unlock(&state->mutex);
+            free(old);
+        }
+        m->cfg = *with;
+        m->updates = 0;
+        memset(&m->cursor, 0, sizeof(m->cursor));
+        log_info("Audio", "Capture reopened: %d source(s), FFT size %d, %d bins",
+               capture_count(m->pool), m->cfg.fft_size, m->cfg.fft_bins);
+    } else {
+        log_warn("Audio", "Reconnect failed, keeping the current sources.");
+        if (buf_ok) arena_release(&new_buf.arena);
+        capture_cleanup(connecting->pool);
+    }
+    free(connecting);
+    m->connecting = NULL;
+}
+
+// Mix what the pool published up to update 'updates' and hand it to the
+// render side. Returns 0 once every source has ended.
+static int mixer_step(Mixer *m, AudioThreadState *state, unsigned long updates) {
+    m->updates = updates;
+    if (capture_finished(m->pool)) return 0;
+
+    const CaptureFrame *frames[MAX_AUDIO_SOURCES];
+    int count = capture_count(m->pool);
+    for (int i = 0; i < count; ++i) frames[i] = capture_latest(m->pool, i);
+    ChromaFrame chroma = frames[0]->chroma;
+    float glow;
+    int has_glow;
+    long arrived;
+    int fresh = mix_sources(frames, count, &m->cfg, &m->cursor, m->buf.bins, &chroma, &glow, &has_glow, &arrived);
+    const CaptureFrame *scope = frames[0];
+    int new_scope = scope->scope && scope->scope_seq > m->cursor.scope_seq;
+    int new_onset = frames[0]->onset_seq != m->cursor.onset_seq;
+    if (!fresh && !new_scope && !new_onset) return 1;
+
+    if (fresh) {
+        publisher_write(m->publisher, m->buf.bins, m->cfg.fft_bins, capture_sample_rate(m->pool), m->cfg.fft_size, arrived);
+        spectra_append(m->recorder, ++m->hops, arrived, m->buf.bins);
+    }
+
+    pthread_mutex_lock(&state->mutex);
+    if (new_scope) {
+        memcpy(state->scope, scope->scope, (size_t)scope->scope_frames * 2 * sizeof(int16_t));
+        state->scope_frames = scope->scope_frames;
+        state->scope_seq++;
+        m->cursor.scope_seq = scope->scope_seq;
+    }
+    if (fresh) {
+        memcpy(state->fft_output, m->buf.bins, m->cfg.fft_bins * sizeof(float));
+        state->chroma = chroma;
+        state->glow = glow;
+        state->has_glow = has_glow;
+        state->hop_seq++;
+        state->hop_time_ns = arrived;
+    }
+    if (new_onset) {
+        memset(&state->onset, 0, sizeof(state->onset));
+        state->onset.seq = frames[0]->onset_seq;
+        state->onset.arrived = frames[0]->onset_arrived_ns;
+        state->onset.analysed = frames[0]->onset_analysed_ns;
+        state->onset.mixed = get_time_ns();
+        m->cursor.onset_seq = frames[0]->onset_seq;
+    }
+    pthread_mutex_unlock(&state->mutex);
+    return 1;
+}
+
+static void mixer_cleanup(Mixer *m) {
+    if (m->connecting) {
+        pthread_join(m->connecting->thread, NULL);
+        capture_cleanup(m->connecting->pool);
+        free(m->connecting);
+    }
+    publisher_cleanup(m->publisher);
+    spectra_close(m->recorder);
+    arena_release(&m->buf.arena);
+    capture_cleanup(m->pool);
+}
+
+// Capture and analysis run on the pool's workers; this thread mixes their
+// results and is the only writer of the shared state, so the render
+// thread's once-a-frame lock never competes with more than one thread
+// however many sources there are.
+void* audio_thread_func(void *arg) {
+    AudioThreadState *state = (AudioThreadState*)arg;
+    log_thread_name("audio");
+
+    Mixer m;
+    if (!mixer_init(&m, &state->config)) {
+        state->running = 0;
         return NULL;
     }
-    
-    int16_t *audio_buffer = malloc(state->config.fft_size * sizeof(int16_t));
-    float *local_fft_output = malloc(state->config.fft_bins * sizeof(float));
-    
+
     while (state->running) {
-        size_t read = audio_read(audio, audio_buffer, state->config.fft_size);
-        if (read < state->config.fft_size) {
-            struct timespec req = {0, 1000000}; // 1ms
-            nanosleep(&req, NULL);
-            continue;
+        mixer_reload(&m, state);
+        // Wakes whenever a source publishes; the timeout keeps reloads
+        // and shutdown responsive while every source is quiet
+        unsigned long updates = capture_wait(m.pool, m.updates, 100000000L);
+        if (!mixer_step(&m, state, updates)) {
+            // Every input file consumed: nothing more will arrive
+            state->finished = 1;
+            state->running = 0;
+            break;
         }
-        
-        fft_process(fft, audio_buffer, local_fft_output);
-        
+    }
+    mixer_cleanup(&m);
+    return NULL;
+}
+
+static void audio_state_init(AudioThreadState *state, const RavizConfig *config) {
+    state->config = *config;
+    state->fft_bins = config->fft_bins;
+    state->fft_output = calloc(config->fft_bins, sizeof(float));
+    state->hop_seq = 0;
+    state->hop_time_ns = 0;
+    memset(&state->chroma, 0, sizeof(state->chroma));
+    state->chroma.key = -1;
+    state->glow = 0.0f;
+    state->has_glow = 0;
+    memset(&state->onset, 0, sizeof(state->onset));
+    state->scope_frames = 0;
+    state->scope_seq = 0;
+    state->running = 1;
+    state->finished = 0;
+    state->reload_pending = 0;
+    pthread_mutex_init(&state->mutex, NULL);
+}
+
+// Hand a reloaded config to the audio thread if it changes anything there
+static void request_audio_reload(AudioThreadState *state, const RavizConfig *loaded, const RavizConfig *fresh) {
+    int routing = 0;
+    for (int i = 0; i < fresh->num_sources && i < loaded->num_sources; ++i) {
+        routing |= fresh->sources[i].gain != loaded->sources[i].gain || fresh->sources[i].route != loaded->sources[i].route;
+    }
+    if (routing || capture_changed(loaded, fresh) ||
+        fresh->scope_xy != loaded->scope_xy || fresh->scope_trigger != loaded->scope_trigger) {
         pthread_mutex_lock(&state->mutex);
-        memcpy(state->fft_output, local_fft_output, state->config.fft_bins * sizeof(float));
+        state->pending = *fresh;
+        state->reload_pending = 1;
         pthread_mutex_unlock(&state->mutex);
     }
-    
-    free(audio_buffer);
-    free(local_fft_output);
+}
+
+// Live config reload: editors save by rename, so watch the directory
+static FileWatch* watch_config(void) {
+    char dir[480];
+    if (!config_dir(dir, sizeof(dir))) return NULL;
+    FileWatch *w = watch_init();
+    if (!watch_add(w, dir)) {
+        watch_cleanup(w);
+        return NULL;
+    }
+    return w;
+}
+
+// What the render side last took from the audio state
+typedef struct {
+    HopBuffers buf;     // Samples hold the oscilloscope window
+    int bins;
+    unsigned long hop_seq;
+    unsigned long scope_seq;
+    long last_time;
+
+    // --latency-test: the click being followed to the screen
+    LatencyTest *latency;
+    unsigned long onset_seq;
+    LatencyMark mark;
+    int timing;
+} FrameFeed;
+
+static int frame_feed_init(FrameFeed *feed, int bins, LatencyTest *latency) {
+    memset(feed, 0, sizeof(*feed));
+    feed->bins = bins;
+    feed->latency = latency;
+    feed->last_time = get_time_ns();
+    return hop_buffers_init(&feed->buf, 2 * SCOPE_MAX_FRAMES, bins);
+}
+
+// --latency-test: finish the mark of the click being followed once its
+// frame is out, and end the run when the test is over
+static void track_latency(RenderContext *render, FrameFeed *feed) {
+    if (feed->timing && render_marked_frame(render, &feed->mark.submitted, &feed->mark.shown)) {
+        feed->timing = 0;
+        latency_test_record(feed->latency, &feed->mark);
+    }
+    if (latency_test_done(feed->latency)) keep_running = 0;
+}
+
+// Throttle, sample the audio state and draw one frame. Every wait happens
+// before the spectrum is read so it is as fresh as possible when drawn.
+// Returns the time the frame started.
+static long draw_frame(RenderContext *render, AudioThreadState *state, FrameFeed *feed) {
+    render_begin_frame(render);
+
+    long current_time = get_time_ns();
+    float dt = (float)(current_time - feed->last_time) / 1000000000.0f;
+    feed->last_time = current_time;
+
+    HopBuffers resized, retired;
+    int spare = 0, retire = 0;
+    pthread_mutex_lock(&state->mutex);
+    if (state->fft_bins != feed->bins) {
+        // Allocate with the audio thread free to publish, then look again
+        int want = state->fft_bins;
+        pthread_mutex_unlock(&state->mutex);
+        spare = hop_buffers_init(&resized, 2 * SCOPE_MAX_FRAMES, want);
+        pthread_mutex_lock(&state->mutex);
+        if (spare && state->fft_bins == want) {
+            retired = feed->buf;
+            retire = 1;
+            feed->buf = resized;
+            feed->bins = want;
+            spare = 0;
+        }
+    }
+    // Until a resize succeeds the sizes can differ: pad with silence
+    int bins = feed->bins;
+    int copy = bins < state->fft_bins ? bins : state->fft_bins;
+    memcpy(feed->buf.bins, state->fft_output, copy * sizeof(float));
+    memset(feed->buf.bins + copy, 0, (bins - copy) * sizeof(float));
+    unsigned long hop_seq = state->hop_seq;
+    long hop_time = state->hop_time_ns;
+    ChromaFrame chroma = state->chroma;
+    float glow = state->glow;
+    int has_glow = state->has_glow;
+    int scope_frames = 0;
+    if (state->scope_seq != feed->scope_seq) {
+        scope_frames = state->scope_frames;
+        memcpy(feed->buf.samples, state->scope, (size_t)scope_frames * 2 * sizeof(int16_t));
+        feed->scope_seq = state->scope_seq;
+    }
+    int new_onset = state->onset.seq != feed->onset_seq;
+    if (new_onset) {
+        feed->mark = state->onset;
+        feed->onset_seq = state->onset.seq;
+    }
+    pthread_mutex_unlock(&state->mutex);
+    if (retire) arena_release(&retired.arena);
+    if (spare) arena_release(&resized.arena);   // fft_bins moved on meanwhile
+    render_set_bins(render, bins);
+    render_set_pitch(render, chroma.hue, chroma.key, chroma.key_strength);
+    render_set_glow(render, has_glow ? glow : -1.0f);
+    if (scope_frames > 0) render_set_scope(render, feed->buf.samples, scope_frames);
+
+    if (hop_seq != feed->hop_seq) {
+        render_push_history(render, feed->buf.bins);
+        feed->hop_seq = hop_seq;
+    }
+
+    if (new_onset && feed->latency) {
+        feed->mark.frame = current_time;
+        feed->timing = 1;
+        render_mark_frame(render);
+    }
+
+    render_set_input_time(render, hop_time);
+    render_update(render, feed->buf.bins, dt);
+    render_draw(render);
+    if (feed->latency) track_latency(render, feed);
+    return current_time;
+}
+
+// One window, drawn on its own schedule from its own feed. Extra windows
+// are opened on the main one's GL objects (render_init_shared), so one
+// capture and analysis serves them all and each adds only its draw.
+typedef struct {
+    RenderContext *render;
+    int spec;           // Index into config->windows, -1 for the main window
+    FrameFeed feed;
+    long frame_duration_ns;
+    long next_frame;
+} View;
+
+typedef struct {
+    View views[1 + MAX_EXTRA_WINDOWS];  // [0] is the main window
+    int count;
+} ViewSet;
+
+static void view_release(View *v) {
+    if (v->spec >= 0) render_cleanup(v->render);
+    arena_release(&v->feed.buf.arena);
+}
+
+// The main window plus config->windows. An extra window that cannot be
+// opened is left out. Returns 0 if not even the main window's feed fits.
+static int views_init(ViewSet *vs, RenderContext *render, const RavizConfig *config, LatencyTest *latency) {
+    memset(vs, 0, sizeof(*vs));
+    long now = get_time_ns();
+    View *v = &vs->views[0];
+    v->render = render;
+    v->spec = -1;
+    v->frame_duration_ns = 1000000000L / config->fps;
+    v->next_frame = now;
+    if (!frame_feed_init(&v->feed, config->fft_bins, latency)) return 0;
+    vs->count = 1;
+
+    for (int i = 0; i < config->num_windows; ++i) {
+        RavizConfig wc;
+        config_window(config, i, &wc);
+        v = &vs->views[vs->count];
+        v->render = render_init_shared(render, &wc);
+        v->spec = i;
+        v->frame_duration_ns = 1000000000L / wc.fps;
+        v->next_frame = now;
+        if (!v->render || !frame_feed_init(&v->feed, config->fft_bins, NULL)) {
+            log_warn("Render", "Could not open window %d.", i + 2);
+            if (v->render) view_release(v);
+            continue;
+        }
+        vs->count++;
+    }
+    if (vs->count > 1) log_info("Render", "%d windows on one analysis.", vs->count);
+    return 1;
+}
+
+// Closes the extra windows and frees every feed. The main window's
+// context stays the caller's.
+static void views_cleanup(ViewSet *vs) {
+    for (int i = vs->count - 1; i >= 0; --i) view_release(&vs->views[i]);
+    vs->count = 0;
+}
+
+// The window whose next frame is due first
+static View* views_next(ViewSet *vs) {
+    View *next = &vs->views[0];
+    for (int i = 1; i < vs->count; ++i) {
+        if (vs->views[i].next_frame < next->next_frame) next = &vs->views[i];
+    }
+    return next;
+}
+
+// Closing an extra window closes only that one; the main window, which
+// owns what they share, ends the run
+static void views_reap(ViewSet *vs) {
+    for (int i = vs->count - 1; i > 0; --i) {
+        if (!render_should_close(vs->views[i].render)) continue;
+        view_release(&vs->views[i]);
+        memmove(&vs->views[i], &vs->views[i + 1], (size_t)(vs->count - i - 1) * sizeof(View));
+        vs->count--;
+    }
+}
+
+static void views_apply_config(ViewSet *vs, const RavizConfig *old, const RavizConfig *fresh) {
+    for (int i = 0; i < vs->count; ++i) {
+        View *v = &vs->views[i];
+        RavizConfig wo = *old, wf = *fresh;
+        if (v->spec >= 0) {
+            if (v->spec >= fresh->num_windows) continue;
+            config_window(old, v->spec, &wo);
+            config_window(fresh, v->spec, &wf);
+        }
+        render_apply_config(v->render, &wo, &wf);
+        if (wf.fps > 0) v->frame_duration_ns = 1000000000L / wf.fps;
+    }
+    // Scenes and rates apply above; windows are only placed when opened
+    int changed = old->num_windows != fresh->num_windows || old->monitor != fresh->monitor;
+    for (int i = 0; i < old->num_windows && !changed; ++i) {
+        changed = old->windows[i].monitor != fresh->windows[i].monitor;
+    }
+    if (changed) {
+        log_info("Config", "Window layout changes take effect after a restart");
+    }
+}
+
+// The config file changed: re-read it and hand each part its changes.
+// 'views' may be NULL (daemon). Returns 0 if the file does not parse.
+static int reload_config(ViewSet *views, AudioThreadState *state, RavizConfig *loaded, int argc, char **argv) {
+    RavizConfig fresh;
+    if (!config_reload(&fresh, argc, argv)) return 0;
+    if (views) views_apply_config(views, loaded, &fresh);
+    request_audio_reload(state, loaded, &fresh);
+    *loaded = fresh;
+    log_init(fresh.log_level, fresh.log_json, 0);
+    log_info("Config", "Reloaded");
+    return 1;
+}
+
+// Draw one window's frame and schedule its next
+static void view_draw(View *v, AudioThreadState *state) {
+    v->next_frame += v->frame_duration_ns;
+    long now = draw_frame(v->render, state, &v->feed);
+    // After a stall, resume pacing from now instead of bursting
+    if (v->next_frame < now) v->next_frame = now;
+}
+
+static void epoll_watch(int epfd, int fd, uint32_t events) {
+    if (fd < 0) return;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void arm_frame_timer(int fd, long at_ns) {
+    struct itimerspec it;
+    memset(&it, 0, sizeof(it));
+    it.it_value.tv_sec = at_ns / 1000000000L;
+    it.it_value.tv_nsec = at_ns % 1000000000L;
+    timerfd_settime(fd, TFD_TIMER_ABSTIME, &it, NULL);
+}
+
+// --single-thread: capture, analysis, mixing and drawing all on this
+// thread. It sleeps in one poll, PulseAudio's (inside capture_run), which
+// also watches an epoll set holding the frame timer, the display
+// connection and the config watch. Samples are analysed as they arrive
+// and a frame is drawn when the timer fires, with no handoff between
+// threads; one timer serves every window, armed for whichever is due
+// first. 'views' is NULL for the daemon, 'latency' NULL unless
+// --latency-test. Returns non-zero on failure.
+static int run_event_loop(ViewSet *views, RavizConfig *config, LatencyTest *latency, int argc, char **argv) {
+    RenderContext *render = views ? views->views[0].render : NULL;
+    AudioThreadState state;
+    audio_state_init(&state, config);
+    Mixer mixer;
+    int capturing = mixer_init(&mixer, config);
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    int timer = render ? timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC) : -1;
+    int ok = epfd >= 0 && (!render || timer >= 0);
+    if (!ok) log_error(NULL, "Cannot set up the event loop.");
+    if (!ok || (!render && !capturing)) {
+        if (capturing) mixer_cleanup(&mixer);
+        if (epfd >= 0) close(epfd);
+        if (timer >= 0) close(timer);
+        free(state.fft_output);
+        pthread_mutex_destroy(&state.mutex);
+        return 1;
+    }
+
+    // A reload would move capture off the test sink
+    FileWatch *config_watch = latency ? NULL : watch_config();
+    int display = render_event_fd(render);
+    epoll_watch(epfd, timer, EPOLLIN);
+    epoll_watch(epfd, watch_fd(config_watch), EPOLLIN);
+    // Edge-triggered: GLFW reads the connection itself and may leave
+    // bytes it does not need yet
+    epoll_watch(epfd, display, EPOLLIN | EPOLLET);
+
+    RavizConfig loaded = *config;
+    long warmup_end = get_time_ns() + 2000000000L; // Daemon: 2 s of warm-up
+    long frames = 0;
+    if (render) arm_frame_timer(timer, views_next(views)->next_frame);
+
+    while (keep_running && (!render || !render_should_close(render))) {
+        if (render && config->max_frames > 0 && frames >= config->max_frames) break;
+
+        // Only the daemon's warm-up and a pool being reopened need a
+        // timeout: everything else arrives as an fd event
+        int timeout_ms = -1;
+        if (!render && frames == 0) timeout_ms = (int)((warmup_end - get_time_ns()) / 1000000L) + 1;
+        if (capturing && mixer.connecting) timeout_ms = 100;
+        if (timeout_ms < -1) timeout_ms = 0;
+
+        int woke;
+        if (capturing) {
+            woke = capture_run(mixer.pool, epfd, timeout_ms);
+        } else {
+            struct pollfd fd = {epfd, POLLIN, 0};
+            woke = poll(&fd, 1, timeout_ms) > 0;
+        }
+
+        if (capturing) {
+            mixer_reload(&mixer, &state);
+            unsigned long updates = capture_wait(mixer.pool, mixer.updates, 0);
+            if (updates != mixer.updates && !mixer_step(&mixer, &state, updates)) {
+                // Every input file consumed: nothing more will arrive
+                state.finished = 1;
+                mixer_cleanup(&mixer);
+                capturing = 0;
+                if (!render) break;
+            }
+        }
+        if (!render && frames == 0 && get_time_ns() >= warmup_end) {
+            alloc_audit_arm();
+            frames = 1;
+        }
+        if (!woke) continue;
+
+        struct epoll_event events[4];
+        int n = epoll_wait(epfd, events, 4, 0);
+        int frame_due = 0;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == timer) {
+                uint64_t expirations;
+                if (read(timer, &expirations, sizeof(expirations)) > 0) frame_due = 1;
+            } else if (fd == display) {
+                render_poll_events(render);
+            } else if (watch_poll(config_watch)) {
+                reload_config(views, &state, &loaded, argc, argv);
+            }
+        }
+
+        if (frame_due) {
+            // Every window whose frame is due, each on its own schedule
+            long now = get_time_ns();
+            for (int i = 0; i < views->count; ++i) {
+                if (views->views[i].next_frame > now) continue;
+                if (i == 0 && frames++ == ALLOC_AUDIT_WARMUP) alloc_audit_arm();
+                view_draw(&views->views[i], &state);
+            }
+            views_reap(views);
+            arm_frame_timer(timer, views_next(views)->next_frame);
+        }
+    }
+
+    alloc_audit_report();
+    if (capturing) mixer_cleanup(&mixer);
+    watch_cleanup(config_watch);
+    if (timer >= 0) close(timer);
+    close(epfd);
+    free(state.fft_output);
+    pthread_mutex_destroy(&state.mutex);
+    return 0;
+}
+
+// --no-render: capture, analyse and publish, nothing else. The audio
+// thread blocks in the capture read between hops and this thread only
+// wakes to check for signals and config edits, so an idle daemon costs
+// next to nothing.
+static int run_daemon(RavizConfig *config, int argc, char **argv) {
+    config->publish = true;
+    if (config->single_thread) {
+        log_info(NULL, "Raviz analysing without rendering on one thread. Press Ctrl+C to exit.");
+        int failed = run_event_loop(NULL, config, NULL, argc, argv);
+        log_info(NULL, "Raviz stopped.");
+        return failed;
+    }
+
+    AudioThreadState state;
+    audio_state_init(&state, config);
+    pthread_t audio_thread;
+    if (pthread_create(&audio_thread, NULL, audio_thread_func, &state) != 0) {
+        log_error(NULL, "Failed to create audio thread.");
+        return 1;
+    }
+    log_info(NULL, "Raviz analysing without rendering. Press Ctrl+C to exit.");
+
+    RavizConfig loaded = *config;
+    FileWatch *config_watch = watch_config();
+    struct timespec tick = {0, 100000000}; // 100 ms
+
+    long ticks = 0;
+
+    while (keep_running && state.running) {
+        if (++ticks == 20) alloc_audit_arm(); // 2 s of warm-up
+        if (watch_poll(config_watch)) reload_config(NULL, &state, &loaded, argc, argv);
+        nanosleep(&tick, NULL);
+    }
+
+    alloc_audit_report();
+    int failed = !state.running && keep_running && !state.finished;
+    state.running = 0;
+    pthread_join(audio_thread, NULL);
+    pthread_mutex_destroy(&state.mutex);
+    watch_cleanup(config_watch);
+    free(state.fft_output);
+    log_info(NULL, "Raviz stopped.");
+    return failed;
+}
+
+// --perf-report: CPU stages from 'perf' plus the renderer's GPU time
+static int write_perf_report(RenderContext *render, const PerfStats *perf, const char *path) {
+    double gpu_ms;
+    long gpu_frames = render_gpu_time(render, &gpu_ms);
+    return perf_write_report(perf, path, gpu_ms, gpu_frames);
+}
+
+// Headless render of a file: no audio thread and no pacing. Each frame
+// consumes exactly one frame's worth of samples and advances time by 1/fps,
+// so the output is deterministic and runs as fast as the GPU allows.
+static int run_offline(RenderContext *render, RavizConfig *config) {
+    AudioContext *audio = audio_init(config);
+    if (!audio) return 1;
+
+    // Bin mapping must follow the file's rate, not the capture default
+    config->audio_rate = audio_sample_rate(audio);
+    FFTContext *fft = fft_init(config);
+    if (!fft) {
+        audio_cleanup(audio);
+        return 1;
+    }
+
+    int hop = config->audio_rate / config->fps;
+    if (hop < 1) hop = 1;
+    int window = config->fft_size;
+    HopBuffers buf;
+    if (!hop_buffers_init(&buf, window > hop ? window : hop, config->fft_bins)) {
+        fft_cleanup(fft);
+        audio_cleanup(audio);
+        return 1;
+    }
+    int16_t *samples = buf.samples;
+    float *bins = buf.bins;
+    ScopeTap *tap;
+    if (!capture_scope_tap(audio, config, hop, &tap)) {
+        arena_release(&buf.arena);
+        fft_cleanup(fft);
+        audio_cleanup(audio);
+        return 1;
+    }
+    float dt = 1.0f / config->fps;
+    long frames = 0;
+    SpectraWriter *recorder = config->record_spectra ?
+        spectra_create(config->record_spectra, config->fft_bins, config->audio_rate, config->fft_size) : NULL;
+    PerfStats perf;
+    perf_start(&perf);
+
+    while (keep_running && !render_should_close(render) && !audio_eof(audio)) {
+        if (config->max_frames > 0 && frames >= config->max_frames) break;
+        if (frames == ALLOC_AUDIT_WARMUP) alloc_audit_arm();
+
+        // Slide the analysis window forward by one hop
+        if (hop < window) {
+            memmove(samples, samples + hop, (window - hop) * sizeof(int16_t));
+            size_t n = capture_read_block(audio, tap, samples + window - hop, hop);
+            fft_push_samples(fft, samples + window - hop, (int)n);
+            memset(samples + window - hop + n, 0, (hop - n) * sizeof(int16_t));
+        } else {
+            size_t n = capture_read_block(audio, tap, samples, hop);
+            fft_push_samples(fft, samples, (int)n);
+            memset(samples + n, 0, (hop - n) * sizeof(int16_t));
+            if (n > (size_t)window) memmove(samples, samples + n - window, window * sizeof(int16_t));
+        }
+
+        fft_process(fft, samples, bins);
+        // File time rather than wall time, so the recording is reproducible
+        spectra_append(recorder, frames + 1, (long)(frames * (long long)hop * 1000000000LL / config->audio_rate), bins);
+        const ChromaFrame *chroma = fft_chroma(fft);
+        render_set_pitch(render, chroma->hue, chroma->key, chroma->key_strength);
+        const int16_t *scope = scope_tap_window(tap, !config->scope_xy, config->scope_trigger);
+        if (scope) render_set_scope(render, scope, scope_tap_frames(tap));
+        perf_mark(&perf, PERF_ANALYSIS);
+        render_push_history(render, bins);
+        render_update(render, bins, dt);
+        perf_mark(&perf, PERF_UPDATE);
+        render_draw(render);
+        perf_mark(&perf, PERF_DRAW);
+        frames++;
+    }
+
+    alloc_audit_report();
+    int failed = render_should_close(render);
+    perf.frames = frames;
+    if (config->perf_report && !write_perf_report(render, &perf, config->perf_report)) failed = 1;
+    spectra_close(recorder);
+    scope_tap_cleanup(tap);
+    arena_release(&buf.arena);
     fft_cleanup(fft);
     audio_cleanup(audio);
-    return NULL;
+    return failed;
+}
+
+// Render a --record-spectra file: no audio and no FFT. Frame k shows the
+// last record at or before k/fps into the recording and advances time by
+// exactly 1/fps, so the output only depends on the file. Real-time replay
+// sleeps to keep that schedule; fast replay renders back to back.
+static int run_replay(RenderContext *render, RavizConfig *config) {
+    SpectraReader *replay = spectra_open(config->replay_spectra);
+    if (!replay) return 1;
+
+    const SpectraHeader *header = spectra_header(replay);
+    long count = spectra_count(replay);
+    int64_t end_ns = 0;
+    if (count > 0) spectra_record(replay, count - 1, &end_ns);
+    render_set_bins(render, (int)header->num_bins);
+
+    int fast = config->replay_fast || config->headless;
+    float dt = 1.0f / config->fps;
+    HopBuffers buf;
+    if (!hop_buffers_init(&buf, 0, (int)header->num_bins)) {
+        spectra_release(replay);
+        return 1;
+    }
+    const float *silence = buf.bins;
+    const float *bins = silence;
+    long shown = -1;
+    long frames = 0;
+    long start = get_time_ns();
+    PerfStats perf;
+    perf_start(&perf);
+
+    while (keep_running && !render_should_close(render)) {
+        if (config->max_frames > 0 && frames >= config->max_frames) break;
+        if (frames == ALLOC_AUDIT_WARMUP) alloc_audit_arm();
+        int64_t t = (int64_t)frames * 1000000000LL / config->fps;
+        if (t > end_ns) break;
+
+        if (!fast) {
+            long sleep_ns = start + (long)t - get_time_ns();
+            if (sleep_ns > 0) {
+                struct timespec req = {sleep_ns / 1000000000L, sleep_ns % 1000000000L};
+                nanosleep(&req, NULL);
+            }
+        }
+        render_begin_frame(render);
+        perf_skip(&perf);
+
+        long i = spectra_find(replay, t);
+        int new_row = i >= 0 && i != shown;
+        if (new_row) {
+            // Straight from the mapping; one history row per new hop, as live
+            bins = spectra_record(replay, i, NULL);
+            shown = i;
+        }
+        perf_mark(&perf, PERF_ANALYSIS);
+        if (new_row) render_push_history(render, bins);
+        render_update(render, bins, dt);
+        perf_mark(&perf, PERF_UPDATE);
+        render_draw(render);
+        perf_mark(&perf, PERF_DRAW);
+        frames++;
+    }
+
+    alloc_audit_report();
+    double seconds = (get_time_ns() - start) / 1e9;
+    log_info("Replay", "%ld frames in %.2f s (%.1f fps)", frames, seconds, seconds > 0 ? frames / seconds : 0.0);
+    int failed = render_should_close(render);
+    perf.frames = frames;
+    if (config->perf_report && !write_perf_report(render, &perf, config->perf_report)) failed = 1;
+    arena_release(&buf.arena);
+    spectra_release(replay);
+    return failed;
+}
+
+// Raw frames go to stdout, so log lines must stay off it
+static int frames_on_stdout(const RavizConfig *config) {
+    return config->headless && !config->no_render && config->output_path &&
+           strcmp(config->output_path, "-") == 0;
 }
 
 int main(int argc, char **argv) {
@@ -85,6 +1010,8 @@ int main(int argc, char **argv) {
     if (config_parse_args(&config, argc, argv)) {
         return 0; 
     }
+    log_thread_name("main");
+    log_init(config.log_level, config.log_json, frames_on_stdout(&config));
 
     struct sigaction sa;
     sa.sa_handler = handle_signal;
@@ -92,69 +1019,127 @@ int main(int argc, char **argv) {
     sa.sa_flags = 0;
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+    if (config.alloc_audit) alloc_audit_enable();
+    if (config.headless) {
+        // A closed pipe (e.g. ffmpeg exiting) should end the render, not kill us
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    LatencyTest *latency = NULL;
+    if (config.latency_test) {
+        if (config.no_render || config.replay_spectra) {
+            log_error("Latency", "--latency-test times live capture up to a drawn frame: drop --no-render and --replay-spectra.");
+            return 1;
+        }
+        latency = latency_test_init(&config);
+        if (!latency) return 1;
+        // Capture exactly what the clicks are played into
+        config.audio_device = (char*)latency_test_monitor(latency);
+        config.num_sources = 0;
+        config.input_file = NULL;
+    }
+
+    if (config.no_render) {
+        return run_daemon(&config, argc, argv);
+    }
 
     RenderContext *render = render_init(&config);
     if (!render) {
-        fprintf(stderr, "Failed to initialize Renderer.\n");
+        log_error(NULL, "Failed to initialize Renderer.");
+        latency_test_cleanup(latency);
         return 1;
     }
 
+    if (config.num_windows > 0 && (config.headless || config.replay_spectra)) {
+        log_warn("Render", "Extra windows only open for live windowed runs, ignoring them.");
+    }
+
+    if (config.replay_spectra) {
+        int status = run_replay(render, &config);
+        render_cleanup(render);
+        return status;
+    }
+
+    if (config.headless && config.input_file) {
+        int status = run_offline(render, &config);
+        render_cleanup(render);
+        return status;
+    }
+
+    log_info(NULL, "Raviz started. Press Ctrl+C or close window to exit.");
+    if (config.num_sources > 1) {
+        log_info(NULL, "Listening on %d sources.", config.num_sources);
+    } else if (config.audio_device) {
+        log_info(NULL, "Listening on device: %s", config.audio_device);
+    } else {
+        log_info(NULL, "Listening on default audio device.");
+    }
+
+    ViewSet views;
+    if (!views_init(&views, render, &config, latency)) {
+        log_error(NULL, "Out of memory.");
+        render_cleanup(render);
+        latency_test_cleanup(latency);
+        return 1;
+    }
+
+    if (config.single_thread) {
+        int status = run_event_loop(&views, &config, latency, argc, argv);
+        views_cleanup(&views);
+        render_cleanup(render);
+        if (latency && !status) status = !latency_test_report(latency);
+        latency_test_cleanup(latency);
+        log_info(NULL, "Raviz stopped.");
+        return status;
+    }
+
     AudioThreadState audio_state;
-    audio_state.config = config;
-    audio_state.fft_bins = config.fft_bins;
-    audio_state.fft_output = calloc(config.fft_bins, sizeof(float));
-    audio_state.running = 1;
-    pthread_mutex_init(&audio_state.mutex, NULL);
+    audio_state_init(&audio_state, &config);
 
     pthread_t audio_thread;
     if (pthread_create(&audio_thread, NULL, audio_thread_func, &audio_state) != 0) {
-        fprintf(stderr, "Failed to create audio thread.\n");
+        log_error(NULL, "Failed to create audio thread.");
+        views_cleanup(&views);
         render_cleanup(render);
+        latency_test_cleanup(latency);
         return 1;
     }
 
-    printf("Raviz started. Press Ctrl+C or close window to exit.\n");
-    if (config.audio_device) {
-        printf("Listening on device: %s\n", config.audio_device);
-    } else {
-        printf("Listening on default audio device.\n");
-    }
+    long frames = 0;
 
-    long frame_duration_ns = 1000000000L / config.fps;
-    long last_time = get_time_ns();
-    
-    float *render_fft_buffer = malloc(config.fft_bins * sizeof(float));
+    RavizConfig loaded = config;
+    // A reload would move capture off the test sink
+    FileWatch *config_watch = latency ? NULL : watch_config();
 
     while (keep_running && !render_should_close(render)) {
-        long current_time = get_time_ns();
-        long elapsed = current_time - last_time;
-        float dt = (float)elapsed / 1000000000.0f;
-        last_time = current_time;
-
-        pthread_mutex_lock(&audio_state.mutex);
-        memcpy(render_fft_buffer, audio_state.fft_output, config.fft_bins * sizeof(float));
-        pthread_mutex_unlock(&audio_state.mutex);
+        if (config.max_frames > 0 && frames >= config.max_frames) break;
+        if (watch_poll(config_watch)) reload_config(&views, &audio_state, &loaded, argc, argv);
 
-        render_update(render, render_fft_buffer, dt);
-        render_draw(render);
-
-        long work_time = get_time_ns() - current_time;
-        long sleep_ns = frame_duration_ns - work_time;
+        // Pace the window due first, then throttle and sample
+        View *view = views_next(&views);
+        long sleep_ns = view->next_frame - get_time_ns();
         if (sleep_ns > 0) {
-            struct timespec req = {0, sleep_ns};
+            struct timespec req = {sleep_ns / 1000000000L, sleep_ns % 1000000000L};
             nanosleep(&req, NULL);
         }
+        if (view == &views.views[0] && frames++ == ALLOC_AUDIT_WARMUP) alloc_audit_arm();
+        view_draw(view, &audio_state);
+        views_reap(&views);
     }
 
+    alloc_audit_report();
     audio_state.running = 0;
     pthread_join(audio_thread, NULL);
     pthread_mutex_destroy(&audio_state.mutex);
 
-    free(render_fft_buffer);
+    watch_cleanup(config_watch);
+    views_cleanup(&views);
     free(audio_state.fft_output);
     render_cleanup(render);
+    int status = latency && !latency_test_report(latency);
+    latency_test_cleanup(latency);
     
-    printf("Raviz stopped.\n");
+    log_info(NULL, "Raviz stopped.");
 
-    return 0;
+    return status;
 }
@@ -0,0 +1,188 @@
+#include "bloom.h"
+#include "shader.h"
+#include "target.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BLOOM_MAX_LEVELS 8
+
+struct Bloom {
+    int max_levels;
+    int num_levels;
+    int dst_width;      // Output size the chain was built for
+    int dst_height;
+    RenderTarget level[BLOOM_MAX_LEVELS];
+
+    GLuint vao;
+    GLuint down_program;
+    GLuint up_program;
+    GLuint composite_program;
+
+    GLint u_down_source;
+    GLint u_down_texel;
+    GLint u_down_uv_scale;
+    GLint u_down_prefilter;
+    GLint u_down_threshold;
+    GLint u_down_knee;
+
+    GLint u_up_source;
+    GLint u_up_texel;
+
+    GLint u_comp_scene;
+    GLint u_comp_bloom;
+    GLint u_comp_uv_scale;
+    GLint u_comp_intensity;
+};
+
+int bloom_reload_shaders(Bloom *b) {
+    ProgramBuilder build = b->composite_program ? build_program_files : build_program_initial;
+    GLuint down = build("bloom.vert", "bloom_down.frag", NULL, 0);
+    GLuint up = build("bloom.vert", "bloom_up.frag", NULL, 0);
+    GLuint composite = build("bloom.vert", "bloom_composite.frag", NULL, 0);
+    if (!down || !up || !composite) {
+        if (down) glDeleteProgram(down);
+        if (up) glDeleteProgram(up);
+        if (composite) glDeleteProgram(composite);
+        return 0;
+    }
+
+    if (b->down_program) glDeleteProgram(b->down_program);
+    if (b->up_program) glDeleteProgram(b->up_program);
+    if (b->composite_program) glDeleteProgram(b->composite_program);
+    b->down_program = down;
+    b->up_program = up;
+    b->composite_program = composite;
+
+    b->u_down_source = glGetUniformLocation(down, "source");
+    b->u_down_texel = glGetUniformLocation(down, "texel");
+    b->u_down_uv_scale = glGetUniformLocation(down, "uv_scale");
+    b->u_down_prefilter = glGetUniformLocation(down, "prefilter");
+    b->u_down_threshold = glGetUniformLocation(down, "threshold");
+    b->u_down_knee = glGetUniformLocation(down, "knee");
+
+    b->u_up_source = glGetUniformLocation(up, "source");
+    b->u_up_texel = glGetUniformLocation(up, "texel");
+
+    b->u_comp_scene = glGetUniformLocation(composite, "scene");
+    b->u_comp_bloom = glGetUniformLocation(composite, "bloom");
+    b->u_comp_uv_scale = glGetUniformLocation(composite, "uv_scale");
+    b->u_comp_intensity = glGetUniformLocation(composite, "intensity");
+    return 1;
+}
+
+Bloom* bloom_init(int levels) {
+    Bloom *b = calloc(1, sizeof(Bloom));
+    if (!b) return NULL;
+
+    if (levels < 1) levels = 1;
+    if (levels > BLOOM_MAX_LEVELS) levels = BLOOM_MAX_LEVELS;
+    b->max_levels = levels;
+
+    if (!bloom_reload_shaders(b)) {
+        bloom_cleanup(b);
+        return NULL;
+    }
+    glGenVertexArrays(1, &b->vao);
+    return b;
+}
+
+// The chain follows the output size, not the (possibly scaled) scene size,
+// so adaptive resolution changes don't reallocate it.
+static int ensure_chain(Bloom *b, int dst_w, int dst_h) {
+    if (b->num_levels > 0 && b->dst_width == dst_w && b->dst_height == dst_h) return 1;
+
+    for (int i = 0; i < BLOOM_MAX_LEVELS; ++i) target_destroy(&b->level[i]);
+    b->num_levels = 0;
+
+    int w = dst_w / 2, h = dst_h / 2;
+    for (int i = 0; i < b->max_levels && w >= 2 && h >= 2; ++i) {
+        if (!target_create(&b->level[i], w, h, GL_RGBA16F, 0)) return 0;
+        b->num_levels++;
+        w /= 2;
+        h /= 2;
+    }
+    b->dst_width = dst_w;
+    b->dst_height = dst_h;
+    return b->num_levels > 0;
+}
+
+void bloom_apply(Bloom *b, GLuint scene_tex, int src_w, int src_h, int tex_w, int tex_h,
+                 GLuint dst_fbo, int dst_w, int dst_h, const BloomParams *params) {
+    if (!b || !ensure_chain(b, dst_w, dst_h)) return;
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glBindVertexArray(b->vao);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Downsample: scene -> level 0 (with bright pass) -> ... -> smallest
+    glUseProgram(b->down_program);
+    glUniform1i(b->u_down_source, 0);
+    glUniform1f(b->u_down_threshold, params->threshold);
+    glUniform1f(b->u_down_knee, params->knee > 1e-3f ? params->knee : 1e-3f);
+    for (int i = 0; i < b->num_levels; ++i) {
+        RenderTarget *dst = &b->level[i];
+        if (i == 0) {
+            glBindTexture(GL_TEXTURE_2D, scene_tex);
+            glUniform2f(b->u_down_texel, 1.0f / tex_w, 1.0f / tex_h);
+            glUniform2f(b->u_down_uv_scale, (float)src_w / tex_w, (float)src_h / tex_h);
+            glUniform1i(b->u_down_prefilter, 1);
+        } else {
+            RenderTarget *src = &b->level[i - 1];
+            glBindTexture(GL_TEXTURE_2D, src->color);
+            glUniform2f(b->u_down_texel, 1.0f / src->width, 1.0f / src->height);
+            glUniform2f(b->u_down_uv_scale, 1.0f, 1.0f);
+            glUniform1i(b->u_down_prefilter, 0);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, dst->fbo);
+        glViewport(0, 0, dst->width, dst->height);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    // Upsample back up the chain, adding each level onto the next larger one
+    glUseProgram(b->up_program);
+    glUniform1i(b->u_up_source, 0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (int i = b->num_levels - 1; i > 0; --i) {
+        RenderTarget *src = &b->level[i];
+        RenderTarget *dst = &b->level[i - 1];
+        glBindTexture(GL_TEXTURE_2D, src->color);
+        glUniform2f(b->u_up_texel, 1.0f / src->width, 1.0f / src->height);
+        glBindFramebuffer(GL_FRAMEBUFFER, dst->fbo);
+        glViewport(0, 0, dst->width, dst->height);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glDisable(GL_BLEND);
+
+    // Composite: scene (stretched to the output) plus glow
+    glUseProgram(b->composite_program);
+    glUniform1i(b->u_comp_scene, 0);
+    glUniform1i(b->u_comp_bloom, 1);
+    glUniform2f(b->u_comp_uv_scale, (float)src_w / tex_w, (float)src_h / tex_h);
+    glUniform1f(b->u_comp_intensity, params->intensity);
+    glBindTexture(GL_TEXTURE_2D, scene_tex);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, b->level[0].color);
+    glBindFramebuffer(GL_FRAMEBUFFER, dst_fbo);
+    glViewport(0, 0, dst_w, dst_h);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void bloom_cleanup(Bloom *b) {
+    if (b) {
+        for (int i = 0; i < BLOOM_MAX_LEVELS; ++i) target_destroy(&b->level[i]);
+        if (b->vao) glDeleteVertexArrays(1, &b->vao);
+        if (b->down_program) glDeleteProgram(b->down_program);
+        if (b->up_program) glDeleteProgram(b->up_program);
+        if (b->composite_program) glDeleteProgram(b->composite_program);
+        free(b);
+    }
+}
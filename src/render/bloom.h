@@ -0,0 +1,31 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include "gl_loader.h"
+
+typedef struct Bloom Bloom;
+
+typedef struct {
+    float threshold;    // Brightness where glow starts
+    float knee;         // Width of the soft transition around the threshold
+    float intensity;    // Glow multiplier applied in the composite
+} BloomParams;
+
+// Bright-pass plus dual-filter (Kawase) down/upsample chain in RGBA16F.
+// 'levels' is the maximum chain length; the first level is half the output
+// resolution and each further level halves again.
+Bloom* bloom_init(int levels);
+
+// Composite 'scene_tex' plus its glow into 'dst_fbo' (0 for the window).
+// The valid scene image is the bottom-left 'src_w' x 'src_h' of a
+// 'tex_w' x 'tex_h' texture and is stretched to the destination.
+// Leaves depth testing and alpha blending enabled, as render.c expects.
+void bloom_apply(Bloom *b, GLuint scene_tex, int src_w, int src_h, int tex_w, int tex_h,
+                 GLuint dst_fbo, int dst_w, int dst_h, const BloomParams *params);
+
+// Rebuild programs from the shader files. Keeps the old ones on failure.
+int bloom_reload_shaders(Bloom *b);
+
+void bloom_cleanup(Bloom *b);
+
+#endif
@@ -0,0 +1,113 @@
+#define _POSIX_C_SOURCE 199309L
+#include "frame_pacer.h"
+#include <stdlib.h>
+#include <time.h>
+
+#define RING (PACER_MAX_AHEAD + 1)
+
+struct FramePacer {
+    int max_ahead;
+    GLsync fence[RING];
+    long input_ns[RING];
+    int head;       // Slot for the next submitted frame
+
+    int frames;
+    double latency_sum_ms;
+    float latency_max_ms;
+};
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+FramePacer* pacer_init(int max_ahead) {
+    FramePacer *p = calloc(1, sizeof(FramePacer));
+    if (!p) return NULL;
+    if (max_ahead < 0) max_ahead = 0;
+    if (max_ahead > PACER_MAX_AHEAD) max_ahead = PACER_MAX_AHEAD;
+    p->max_ahead = max_ahead;
+    return p;
+}
+
+static void retire(FramePacer *p, int slot) {
+    glDeleteSync(p->fence[slot]);
+    p->fence[slot] = NULL;
+
+    if (p->input_ns[slot] > 0) {
+        float ms = (float)(now_ns() - p->input_ns[slot]) / 1.0e6f;
+        p->frames++;
+        p->latency_sum_ms += ms;
+        if (ms > p->latency_max_ms) p->latency_max_ms = ms;
+    }
+}
+
+void pacer_wait(FramePacer *p) {
+    if (!p) return;
+
+    // Oldest first: retire whatever already finished without blocking so
+    // completion times are observed as early as possible
+    for (int i = 0; i < RING; ++i) {
+        int slot = (p->head + i) % RING;
+        if (!p->fence[slot]) continue;
+        GLenum r = glClientWaitSync(p->fence[slot], 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+        retire(p, slot);
+    }
+
+    // The frame submitted 'max_ahead' frames before the newest must be done
+    int slot = (p->head - 1 - p->max_ahead + 2 * RING) % RING;
+    if (p->fence[slot]) {
+        glClientWaitSync(p->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        // Everything older is done as well
+        for (int i = 0; i < RING; ++i) {
+            int s = (p->head + i) % RING;
+            if (p->fence[s]) retire(p, s);
+            if (s == slot) break;
+        }
+    }
+}
+
+void pacer_submit(FramePacer *p, long input_ns) {
+    if (!p) return;
+    int slot = p->head;
+    if (p->fence[slot]) {
+        // Only reachable if pacer_wait was skipped
+        glClientWaitSync(p->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        retire(p, slot);
+    }
+    p->fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    p->input_ns[slot] = input_ns;
+    p->head = (slot + 1) % RING;
+}
+
+long pacer_finish(FramePacer *p) {
+    if (!p) return now_ns();
+    int slot = (p->head - 1 + RING) % RING;
+    if (p->fence[slot]) {
+        glClientWaitSync(p->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        retire(p, slot);
+    }
+    return now_ns();
+}
+
+void pacer_take_stats(FramePacer *p, PacerStats *out) {
+    out->frames = p ? p->frames : 0;
+    out->latency_avg_ms = out->frames > 0 ? (float)(p->latency_sum_ms / out->frames) : 0.0f;
+    out->latency_max_ms = p ? p->latency_max_ms : 0.0f;
+    if (p) {
+        p->frames = 0;
+        p->latency_sum_ms = 0.0;
+        p->latency_max_ms = 0.0f;
+    }
+}
+
+void pacer_cleanup(FramePacer *p) {
+    if (p) {
+        for (int i = 0; i < RING; ++i) {
+            if (p->fence[i]) glDeleteSync(p->fence[i]);
+        }
+        free(p);
+    }
+}
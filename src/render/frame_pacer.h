@@ -0,0 +1,40 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "gl_loader.h"
+
+#define PACER_MAX_AHEAD 2
+
+typedef struct FramePacer FramePacer;
+
+typedef struct {
+    int frames;             // Frames whose completion was observed
+    float latency_avg_ms;   // Input timestamp -> GPU completion
+    float latency_max_ms;
+} PacerStats;
+
+// Bounds how many frames the driver may queue behind SwapBuffers. A fence
+// follows every frame; before a new frame starts, the fence from
+// 'max_ahead' frames back (0-2) must have signalled. 0 means fully
+// synchronous: each frame finishes on the GPU before the next is built.
+FramePacer* pacer_init(int max_ahead);
+
+// Block until at most 'max_ahead' frames are in flight. Call before
+// sampling the input the next frame will show.
+void pacer_wait(FramePacer *p);
+
+// After SwapBuffers: fence the frame. 'input_ns' is the CLOCK_MONOTONIC
+// capture time of the data it shows, used for latency stats.
+void pacer_submit(FramePacer *p, long input_ns);
+
+// Block until the frame just submitted has finished on the GPU and return
+// the time that was seen (CLOCK_MONOTONIC ns). Gives up that frame's
+// CPU/GPU overlap, so it is only for measurements (--latency-test).
+long pacer_finish(FramePacer *p);
+
+// Stats since the previous call (which resets them).
+void pacer_take_stats(FramePacer *p, PacerStats *out);
+
+void pacer_cleanup(FramePacer *p);
+
+#endif
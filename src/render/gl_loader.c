@@ -1,6 +1,8 @@
 #include "gl_loader.h"
+#include "../utils/log.h"
 #include <GLFW/glfw3.h>
 #include <stdio.h>
+#include <string.h>
 
 PFNGLGENBUFFERS glGenBuffers = NULL;
 PFNGLBINDBUFFER glBindBuffer = NULL;
@@ -26,6 +28,8 @@ PFNGLGETUNIFORMLOCATION glGetUniformLocation = NULL;
 PFNGLUNIFORM1F glUniform1f = NULL;
 PFNGLUNIFORM1FV glUniform1fv = NULL;
 PFNGLUNIFORM1I glUniform1i = NULL;
+PFNGLUNIFORM2I glUniform2i = NULL;
+PFNGLUNIFORM2F glUniform2f = NULL;
 PFNGLUNIFORMMATRIX4FV glUniformMatrix4fv = NULL;
 
 PFNGLGENVERTEXARRAYS glGenVertexArrays = NULL;
@@ -34,17 +38,106 @@ PFNGLDELETEVERTEXARRAYS glDeleteVertexArrays = NULL;
 
 PFNGLENABLEVERTEXATTRIBARRAY glEnableVertexAttribArray = NULL;
 PFNGLVERTEXATTRIBPOINTER glVertexAttribPointer = NULL;
+PFNGLVERTEXATTRIBDIVISOR glVertexAttribDivisor = NULL;
+PFNGLDRAWARRAYSINSTANCED glDrawArraysInstanced = NULL;
+
+PFNGLTRANSFORMFEEDBACKVARYINGS glTransformFeedbackVaryings = NULL;
+PFNGLBEGINTRANSFORMFEEDBACK glBeginTransformFeedback = NULL;
+PFNGLENDTRANSFORMFEEDBACK glEndTransformFeedback = NULL;
+PFNGLBINDBUFFERBASE glBindBufferBase = NULL;
+PFNGLTEXBUFFER glTexBuffer = NULL;
+
+PFNGLGENFRAMEBUFFERS glGenFramebuffers = NULL;
+PFNGLDELETEFRAMEBUFFERS glDeleteFramebuffers = NULL;
+PFNGLBINDFRAMEBUFFER glBindFramebuffer = NULL;
+PFNGLFRAMEBUFFERTEXTURE2D glFramebufferTexture2D = NULL;
+PFNGLCHECKFRAMEBUFFERSTATUS glCheckFramebufferStatus = NULL;
+PFNGLGENRENDERBUFFERS glGenRenderbuffers = NULL;
+PFNGLDELETERENDERBUFFERS glDeleteRenderbuffers = NULL;
+PFNGLBINDRENDERBUFFER glBindRenderbuffer = NULL;
+PFNGLRENDERBUFFERSTORAGE glRenderbufferStorage = NULL;
+PFNGLFRAMEBUFFERRENDERBUFFER glFramebufferRenderbuffer = NULL;
+
+PFNGLMAPBUFFERRANGE glMapBufferRange = NULL;
+PFNGLUNMAPBUFFER glUnmapBuffer = NULL;
+PFNGLFENCESYNC glFenceSync = NULL;
+PFNGLCLIENTWAITSYNC glClientWaitSync = NULL;
+PFNGLDELETESYNC glDeleteSync = NULL;
+
+PFNGLGENQUERIES glGenQueries = NULL;
+PFNGLDELETEQUERIES glDeleteQueries = NULL;
+PFNGLBEGINQUERY glBeginQuery = NULL;
+PFNGLENDQUERY glEndQuery = NULL;
+PFNGLGETQUERYOBJECTIV glGetQueryObjectiv = NULL;
+PFNGLGETQUERYOBJECTUI64V glGetQueryObjectui64v = NULL;
+PFNGLBLITFRAMEBUFFER glBlitFramebuffer = NULL;
+
+PFNGLGETSTRINGI glGetStringi = NULL;
+PFNGLBUFFERSUBDATA glBufferSubData = NULL;
+PFNGLBINDBUFFERRANGE glBindBufferRange = NULL;
+PFNGLGETUNIFORMBLOCKINDEX glGetUniformBlockIndex = NULL;
+PFNGLUNIFORMBLOCKBINDING glUniformBlockBinding = NULL;
+
+PFNGLQUERYCOUNTER glQueryCounter = NULL;
+
+PFNGLGETPROGRAMBINARY glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARY glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERI glProgramParameteri = NULL;
+
+PFNGLCREATEBUFFERS glCreateBuffers = NULL;
+PFNGLNAMEDBUFFERSTORAGE glNamedBufferStorage = NULL;
+PFNGLMAPNAMEDBUFFERRANGE glMapNamedBufferRange = NULL;
+PFNGLBUFFERSTORAGE glBufferStorage = NULL;
+PFNGLTEXTURESUBIMAGE2D glTextureSubImage2D = NULL;
+
+GLCaps gl_caps;
+
+static int has_extension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char *ext = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (ext && strcmp(ext, name) == 0) return 1;
+    }
+    return 0;
+}
+
+static void detect_caps(void) {
+    memset(&gl_caps, 0, sizeof(gl_caps));
+    glGetIntegerv(GL_MAJOR_VERSION, &gl_caps.major);
+    glGetIntegerv(GL_MINOR_VERSION, &gl_caps.minor);
+    int version = gl_caps.major * 10 + gl_caps.minor;
+
+    // An advertised feature only counts if every entry point we use resolved
+    gl_caps.direct_state_access = (version >= 45 || has_extension("GL_ARB_direct_state_access")) &&
+        glCreateBuffers && glNamedBufferStorage && glMapNamedBufferRange && glTextureSubImage2D;
+    gl_caps.buffer_storage = (version >= 44 || has_extension("GL_ARB_buffer_storage")) &&
+        glBufferStorage;
+}
+
+static void* glfw_get_proc(const char *name) {
+    return (void*)glfwGetProcAddress(name);
+}
 
 int load_gl_functions() {
+    return load_gl_functions_from(glfw_get_proc);
+}
+
+int load_gl_functions_from(GLProcLoader get_proc) {
     int errors = 0;
     
     #define LOAD(name) \
-        name = (void*)glfwGetProcAddress(#name); \
+        name = (void*)get_proc(#name); \
         if (!name) { \
-            fprintf(stderr, "Failed to load GL function: %s\n", #name); \
+            log_error("Render", "Failed to load GL function: %s", #name); \
             errors++; \
         }
 
+    // Newer-than-3.3 entry points: a miss is not an error, callers check
+    // for NULL (or gl_caps) and fall back to the core 3.3 path
+    #define LOAD_OPTIONAL(name) \
+        name = (void*)get_proc(#name);
+
     LOAD(glGenBuffers);
     LOAD(glBindBuffer);
     LOAD(glBufferData);
@@ -69,6 +162,8 @@ int load_gl_functions() {
     LOAD(glUniform1f);
     LOAD(glUniform1fv);
     LOAD(glUniform1i);
+    LOAD(glUniform2i);
+    LOAD(glUniform2f);
     LOAD(glUniformMatrix4fv);
     
     LOAD(glGenVertexArrays);
@@ -77,6 +172,58 @@ int load_gl_functions() {
     
     LOAD(glEnableVertexAttribArray);
     LOAD(glVertexAttribPointer);
+    LOAD(glVertexAttribDivisor);
+    LOAD(glDrawArraysInstanced);
+    
+    LOAD(glTransformFeedbackVaryings);
+    LOAD(glBeginTransformFeedback);
+    LOAD(glEndTransformFeedback);
+    LOAD(glBindBufferBase);
+    LOAD(glTexBuffer);
+    
+    LOAD(glGenFramebuffers);
+    LOAD(glDeleteFramebuffers);
+    LOAD(glBindFramebuffer);
+    LOAD(glFramebufferTexture2D);
+    LOAD(glCheckFramebufferStatus);
+    LOAD(glGenRenderbuffers);
+    LOAD(glDeleteRenderbuffers);
+    LOAD(glBindRenderbuffer);
+    LOAD(glRenderbufferStorage);
+    LOAD(glFramebufferRenderbuffer);
+    
+    LOAD(glMapBufferRange);
+    LOAD(glUnmapBuffer);
+    LOAD(glFenceSync);
+    LOAD(glClientWaitSync);
+    LOAD(glDeleteSync);
+    
+    LOAD(glGenQueries);
+    LOAD(glDeleteQueries);
+    LOAD(glBeginQuery);
+    LOAD(glEndQuery);
+    LOAD(glGetQueryObjectiv);
+    LOAD(glGetQueryObjectui64v);
+    LOAD(glBlitFramebuffer);
+    
+    LOAD(glGetStringi);
+    LOAD(glBufferSubData);
+    LOAD(glBindBufferRange);
+    LOAD(glGetUniformBlockIndex);
+    LOAD(glUniformBlockBinding);
+    
+    LOAD(glQueryCounter);
+    
+    LOAD_OPTIONAL(glGetProgramBinary);
+    LOAD_OPTIONAL(glProgramBinary);
+    LOAD_OPTIONAL(glProgramParameteri);
+    
+    LOAD_OPTIONAL(glCreateBuffers);
+    LOAD_OPTIONAL(glNamedBufferStorage);
+    LOAD_OPTIONAL(glMapNamedBufferRange);
+    LOAD_OPTIONAL(glBufferStorage);
+    LOAD_OPTIONAL(glTextureSubImage2D);
     
+    if (errors == 0) detect_caps();
     return errors == 0;
 }
@@ -11,11 +11,17 @@
 
 // We need ptrdiff_t
 #include <stddef.h>
+#include <stdint.h>
 
 // Typedefs for function pointers
 typedef char GLchar;
 typedef ptrdiff_t GLsizeiptr;
 typedef ptrdiff_t GLintptr;
+#ifndef GL_VERSION_3_2
+typedef struct __GLsync *GLsync;
+typedef uint64_t GLuint64;
+typedef int64_t GLint64;
+#endif
 
 // Constants
 #define GL_ARRAY_BUFFER                   0x8892
@@ -27,6 +33,56 @@ typedef ptrdiff_t GLintptr;
 #define GL_LINK_STATUS                    0x8B82
 #define GL_INFO_LOG_LENGTH                0x8B84
 
+#define GL_R32F                           0x822E
+#define GL_RGBA16F                        0x881A
+#define GL_RG32F                          0x8230
+#define GL_RG16I                          0x8239
+#define GL_DYNAMIC_COPY                   0x88EA
+#define GL_TEXTURE_BUFFER                 0x8C2A
+#define GL_RASTERIZER_DISCARD             0x8C89
+#define GL_INTERLEAVED_ATTRIBS            0x8C8C
+#define GL_TRANSFORM_FEEDBACK_BUFFER      0x8C8E
+
+#define GL_FRAMEBUFFER                    0x8D40
+#define GL_READ_FRAMEBUFFER               0x8CA8
+#define GL_DRAW_FRAMEBUFFER               0x8CA9
+#define GL_RENDERBUFFER                   0x8D41
+#define GL_COLOR_ATTACHMENT0              0x8CE0
+#define GL_DEPTH_ATTACHMENT               0x8D00
+#define GL_DEPTH_COMPONENT24              0x81A6
+#define GL_FRAMEBUFFER_COMPLETE           0x8CD5
+
+#define GL_PIXEL_PACK_BUFFER              0x88EB
+#define GL_STREAM_READ                    0x88E1
+#define GL_MAP_READ_BIT                   0x0001
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+#define GL_TIMEOUT_IGNORED                0xFFFFFFFFFFFFFFFFull
+#define GL_ALREADY_SIGNALED               0x911A
+#define GL_TIMEOUT_EXPIRED                0x911B
+#define GL_CONDITION_SATISFIED            0x911C
+#define GL_WAIT_FAILED                    0x911D
+
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+
+#define GL_TIME_ELAPSED                   0x88BF
+#define GL_TIMESTAMP                      0x8E28
+#define GL_QUERY_RESULT                   0x8866
+#define GL_QUERY_RESULT_AVAILABLE         0x8867
+
+#define GL_UNIFORM_BUFFER                 0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 0x8A34
+#define GL_INVALID_INDEX                  0xFFFFFFFFu
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+#define GL_STREAM_DRAW                    0x88E0
+#define GL_MINOR_VERSION                  0x821C
+#define GL_NUM_EXTENSIONS                 0x821D
+
 #define GL_POINT                          0x1B00
 #define GL_LINE                           0x1B01
 #define GL_FILL                           0x1B02
@@ -57,6 +113,8 @@ typedef GLint (*PFNGLGETUNIFORMLOCATION)(GLuint program, const GLchar *name);
 typedef void (*PFNGLUNIFORM1F)(GLint location, GLfloat v0);
 typedef void (*PFNGLUNIFORM1FV)(GLint location, GLsizei count, const GLfloat *value);
 typedef void (*PFNGLUNIFORM1I)(GLint location, GLint v0);
+typedef void (*PFNGLUNIFORM2I)(GLint location, GLint v0, GLint v1);
+typedef void (*PFNGLUNIFORM2F)(GLint location, GLfloat v0, GLfloat v1);
 typedef void (*PFNGLUNIFORMMATRIX4FV)(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
 
 typedef void (*PFNGLGENVERTEXARRAYS)(GLsizei n, GLuint *arrays);
@@ -65,6 +123,58 @@ typedef void (*PFNGLDELETEVERTEXARRAYS)(GLsizei n, const GLuint *arrays);
 
 typedef void (*PFNGLENABLEVERTEXATTRIBARRAY)(GLuint index);
 typedef void (*PFNGLVERTEXATTRIBPOINTER)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+typedef void (*PFNGLVERTEXATTRIBDIVISOR)(GLuint index, GLuint divisor);
+typedef void (*PFNGLDRAWARRAYSINSTANCED)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+
+typedef void (*PFNGLTRANSFORMFEEDBACKVARYINGS)(GLuint program, GLsizei count, const GLchar *const*varyings, GLenum bufferMode);
+typedef void (*PFNGLBEGINTRANSFORMFEEDBACK)(GLenum primitiveMode);
+typedef void (*PFNGLENDTRANSFORMFEEDBACK)(void);
+typedef void (*PFNGLBINDBUFFERBASE)(GLenum target, GLuint index, GLuint buffer);
+typedef void (*PFNGLTEXBUFFER)(GLenum target, GLenum internalformat, GLuint buffer);
+
+typedef void (*PFNGLGENFRAMEBUFFERS)(GLsizei n, GLuint *framebuffers);
+typedef void (*PFNGLDELETEFRAMEBUFFERS)(GLsizei n, const GLuint *framebuffers);
+typedef void (*PFNGLBINDFRAMEBUFFER)(GLenum target, GLuint framebuffer);
+typedef void (*PFNGLFRAMEBUFFERTEXTURE2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (*PFNGLCHECKFRAMEBUFFERSTATUS)(GLenum target);
+typedef void (*PFNGLGENRENDERBUFFERS)(GLsizei n, GLuint *renderbuffers);
+typedef void (*PFNGLDELETERENDERBUFFERS)(GLsizei n, const GLuint *renderbuffers);
+typedef void (*PFNGLBINDRENDERBUFFER)(GLenum target, GLuint renderbuffer);
+typedef void (*PFNGLRENDERBUFFERSTORAGE)(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (*PFNGLFRAMEBUFFERRENDERBUFFER)(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+
+
+typedef void * (*PFNGLMAPBUFFERRANGE)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (*PFNGLUNMAPBUFFER)(GLenum target);
+typedef GLsync (*PFNGLFENCESYNC)(GLenum condition, GLbitfield flags);
+typedef GLenum (*PFNGLCLIENTWAITSYNC)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (*PFNGLDELETESYNC)(GLsync sync);
+
+typedef void (*PFNGLCREATEBUFFERS)(GLsizei n, GLuint *buffers);
+typedef void (*PFNGLNAMEDBUFFERSTORAGE)(GLuint buffer, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void * (*PFNGLMAPNAMEDBUFFERRANGE)(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef void (*PFNGLBUFFERSTORAGE)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (*PFNGLTEXTURESUBIMAGE2D)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+typedef void (*PFNGLGETPROGRAMBINARY)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (*PFNGLPROGRAMBINARY)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (*PFNGLPROGRAMPARAMETERI)(GLuint program, GLenum pname, GLint value);
+
+typedef void (*PFNGLGENQUERIES)(GLsizei n, GLuint *ids);
+typedef void (*PFNGLDELETEQUERIES)(GLsizei n, const GLuint *ids);
+typedef void (*PFNGLBEGINQUERY)(GLenum target, GLuint id);
+typedef void (*PFNGLENDQUERY)(GLenum target);
+typedef void (*PFNGLGETQUERYOBJECTIV)(GLuint id, GLenum pname, GLint *params);
+typedef void (*PFNGLGETQUERYOBJECTUI64V)(GLuint id, GLenum pname, GLuint64 *params);
+typedef void (*PFNGLBLITFRAMEBUFFER)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+
+typedef const GLubyte * (*PFNGLGETSTRINGI)(GLenum name, GLuint index);
+typedef void (*PFNGLBUFFERSUBDATA)(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+typedef void (*PFNGLBINDBUFFERRANGE)(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+typedef GLuint (*PFNGLGETUNIFORMBLOCKINDEX)(GLuint program, const GLchar *uniformBlockName);
+typedef void (*PFNGLUNIFORMBLOCKBINDING)(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+
+typedef void (*PFNGLQUERYCOUNTER)(GLuint id, GLenum target);
 
 // Externs
 extern PFNGLGENBUFFERS glGenBuffers;
@@ -91,6 +201,8 @@ extern PFNGLGETUNIFORMLOCATION glGetUniformLocation;
 extern PFNGLUNIFORM1F glUniform1f;
 extern PFNGLUNIFORM1FV glUniform1fv;
 extern PFNGLUNIFORM1I glUniform1i;
+extern PFNGLUNIFORM2I glUniform2i;
+extern PFNGLUNIFORM2F glUniform2f;
 extern PFNGLUNIFORMMATRIX4FV glUniformMatrix4fv;
 
 extern PFNGLGENVERTEXARRAYS glGenVertexArrays;
@@ -99,9 +211,75 @@ extern PFNGLDELETEVERTEXARRAYS glDeleteVertexArrays;
 
 extern PFNGLENABLEVERTEXATTRIBARRAY glEnableVertexAttribArray;
 extern PFNGLVERTEXATTRIBPOINTER glVertexAttribPointer;
+extern PFNGLVERTEXATTRIBDIVISOR glVertexAttribDivisor;
+extern PFNGLDRAWARRAYSINSTANCED glDrawArraysInstanced;
+
+extern PFNGLTRANSFORMFEEDBACKVARYINGS glTransformFeedbackVaryings;
+extern PFNGLBEGINTRANSFORMFEEDBACK glBeginTransformFeedback;
+extern PFNGLENDTRANSFORMFEEDBACK glEndTransformFeedback;
+extern PFNGLBINDBUFFERBASE glBindBufferBase;
+extern PFNGLTEXBUFFER glTexBuffer;
+
+extern PFNGLGENFRAMEBUFFERS glGenFramebuffers;
+extern PFNGLDELETEFRAMEBUFFERS glDeleteFramebuffers;
+extern PFNGLBINDFRAMEBUFFER glBindFramebuffer;
+extern PFNGLFRAMEBUFFERTEXTURE2D glFramebufferTexture2D;
+extern PFNGLCHECKFRAMEBUFFERSTATUS glCheckFramebufferStatus;
+extern PFNGLGENRENDERBUFFERS glGenRenderbuffers;
+extern PFNGLDELETERENDERBUFFERS glDeleteRenderbuffers;
+extern PFNGLBINDRENDERBUFFER glBindRenderbuffer;
+extern PFNGLRENDERBUFFERSTORAGE glRenderbufferStorage;
+extern PFNGLFRAMEBUFFERRENDERBUFFER glFramebufferRenderbuffer;
+
+extern PFNGLMAPBUFFERRANGE glMapBufferRange;
+extern PFNGLUNMAPBUFFER glUnmapBuffer;
+extern PFNGLFENCESYNC glFenceSync;
+extern PFNGLCLIENTWAITSYNC glClientWaitSync;
+extern PFNGLDELETESYNC glDeleteSync;
+
+extern PFNGLGENQUERIES glGenQueries;
+extern PFNGLDELETEQUERIES glDeleteQueries;
+extern PFNGLBEGINQUERY glBeginQuery;
+extern PFNGLENDQUERY glEndQuery;
+extern PFNGLGETQUERYOBJECTIV glGetQueryObjectiv;
+extern PFNGLGETQUERYOBJECTUI64V glGetQueryObjectui64v;
+extern PFNGLBLITFRAMEBUFFER glBlitFramebuffer;
 
+extern PFNGLGETSTRINGI glGetStringi;
+extern PFNGLBUFFERSUBDATA glBufferSubData;
+extern PFNGLBINDBUFFERRANGE glBindBufferRange;
+extern PFNGLGETUNIFORMBLOCKINDEX glGetUniformBlockIndex;
+extern PFNGLUNIFORMBLOCKBINDING glUniformBlockBinding;
 
-// Load functions
+extern PFNGLQUERYCOUNTER glQueryCounter;
+
+// Optional (NULL when unsupported)
+extern PFNGLGETPROGRAMBINARY glGetProgramBinary;
+extern PFNGLPROGRAMBINARY glProgramBinary;
+extern PFNGLPROGRAMPARAMETERI glProgramParameteri;
+
+extern PFNGLCREATEBUFFERS glCreateBuffers;
+extern PFNGLNAMEDBUFFERSTORAGE glNamedBufferStorage;
+extern PFNGLMAPNAMEDBUFFERRANGE glMapNamedBufferRange;
+extern PFNGLBUFFERSTORAGE glBufferStorage;
+extern PFNGLTEXTURESUBIMAGE2D glTextureSubImage2D;
+
+// What the current context actually provides. The context is requested as
+// 3.3 core, but Mesa and the proprietary drivers hand back the newest core
+// version they support, so 4.5 features are usable when present.
+typedef struct {
+    int major, minor;
+    int direct_state_access;  // GL 4.5 or ARB_direct_state_access
+    int buffer_storage;       // GL 4.4 or ARB_buffer_storage
+} GLCaps;
+
+extern GLCaps gl_caps;
+
+// Load functions through GLFW (requires a current GLFW context)
 int load_gl_functions();
 
+// Load functions through another loader, e.g. eglGetProcAddress
+typedef void* (*GLProcLoader)(const char *name);
+int load_gl_functions_from(GLProcLoader get_proc);
+
 #endif
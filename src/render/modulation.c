@@ -0,0 +1,174 @@
+#include "modulation.h"
+#include "../fft/fft.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Feature slots the table reads from. Each distinct bin range gets a
+// slot after the fixed ones.
+enum {
+    SLOT_LOW,           // FFT_BAND_* order
+    SLOT_MID,
+    SLOT_HIGH,
+    SLOT_LOUDNESS,
+    SLOT_ONSET,
+    SLOT_HUE,
+    SLOT_CHROMA,
+    SLOT_FIXED
+};
+#define MAX_SLOTS (SLOT_FIXED + MAX_MOD_ROUTES)
+
+// One compiled route: everything the per-frame loop needs, nothing it
+// has to look up
+typedef struct {
+    int slot;
+    float in_scale, in_bias;    // value * in_scale + in_bias maps the range to 0-1
+    ModCurve curve;
+    float attack, release;
+    float scale, offset;
+    int target;
+    float level;                // Follower output
+} ModEntry;
+
+struct Modulation {
+    ModEntry entries[MAX_MOD_ROUTES];
+    ModRoute routes[MAX_MOD_ROUTES];    // As compiled, to match routes across reloads
+    int count;
+    int bin_lo[MAX_MOD_ROUTES];         // Range of slot SLOT_FIXED + i
+    int bin_hi[MAX_MOD_ROUTES];
+    int num_ranges;
+    int uses_bands;
+    int uses_onset;
+    float base[MOD_TARGETS];            // Output of a target before its routes add up
+    int sample_rate;
+    int fft_size;
+    BeatTracker beat;
+};
+
+Modulation* modulation_init(const RavizConfig *config) {
+    Modulation *mod = calloc(1, sizeof(Modulation));
+    if (!mod) return NULL;
+    modulation_compile(mod, config);
+    return mod;
+}
+
+static int range_slot(Modulation *mod, int lo, int hi) {
+    for (int i = 0; i < mod->num_ranges; ++i) {
+        if (mod->bin_lo[i] == lo && mod->bin_hi[i] == hi) return SLOT_FIXED + i;
+    }
+    mod->bin_lo[mod->num_ranges] = lo;
+    mod->bin_hi[mod->num_ranges] = hi;
+    return SLOT_FIXED + mod->num_ranges++;
+}
+
+void modulation_compile(Modulation *mod, const RavizConfig *config) {
+    if (!mod) return;
+    float kept[MAX_MOD_ROUTES];
+    for (int i = 0; i < mod->count; ++i) kept[i] = mod->entries[i].level;
+    int old_count = mod->count;
+
+    mod->num_ranges = 0;
+    mod->uses_bands = 0;
+    mod->uses_onset = 0;
+    mod->sample_rate = config->audio_rate;
+    mod->fft_size = config->fft_size;
+    for (int t = 0; t < MOD_TARGETS; ++t) mod->base[t] = 0.0f;
+    mod->base[MOD_TARGET_GLOW] = 1.0f;
+
+    int count = config->num_mod_routes;
+    if (count > MAX_MOD_ROUTES) count = MAX_MOD_ROUTES;
+    for (int i = 0; i < count; ++i) {
+        const ModRoute *r = &config->mod_routes[i];
+        ModEntry *e = &mod->entries[i];
+
+        switch (r->source) {
+            case MOD_SOURCE_LOW:      e->slot = SLOT_LOW; break;
+            case MOD_SOURCE_MID:      e->slot = SLOT_MID; break;
+            case MOD_SOURCE_HIGH:     e->slot = SLOT_HIGH; break;
+            case MOD_SOURCE_BINS:     e->slot = range_slot(mod, r->bin_lo, r->bin_hi); break;
+            case MOD_SOURCE_LOUDNESS: e->slot = SLOT_LOUDNESS; break;
+            case MOD_SOURCE_ONSET:    e->slot = SLOT_ONSET; break;
+            case MOD_SOURCE_HUE:      e->slot = SLOT_HUE; break;
+            default:                  e->slot = SLOT_CHROMA; break;
+        }
+        if (e->slot <= SLOT_HIGH || e->slot == SLOT_ONSET) mod->uses_bands = 1;
+        if (e->slot == SLOT_ONSET) mod->uses_onset = 1;
+
+        float span = r->in_max - r->in_min;
+        if (fabsf(span) < 1e-6f) span = 1e-6f;
+        e->in_scale = 1.0f / span;
+        e->in_bias = -r->in_min * e->in_scale;
+        e->curve = r->curve;
+        e->attack = r->attack;
+        e->release = r->release;
+        e->scale = r->scale;
+        e->offset = r->offset;
+        e->target = r->target;
+
+        // Nothing drives the glow harder than configured unless a route says so
+        if (r->target == MOD_TARGET_GLOW) mod->base[MOD_TARGET_GLOW] = 0.0f;
+
+        int same = i < old_count && memcmp(&mod->routes[i], r, sizeof(*r)) == 0;
+        e->level = same ? kept[i] : 0.0f;
+        mod->routes[i] = *r;
+    }
+    mod->count = count;
+}
+
+// Bins past the spectrum count as silent rather than narrowing the range,
+// so "bins 5-19" weighs each bin the same at any fft_bins
+static float bin_mean(const float *bins, int num_bins, int lo, int hi) {
+    if (lo < 0) lo = 0;
+    if (lo > hi) return 0.0f;
+    int width = hi - lo + 1;
+    if (hi >= num_bins) hi = num_bins - 1;
+    float sum = 0.0f;
+    for (int i = lo; i <= hi; ++i) sum += bins[i];
+    return sum / width;
+}
+
+static void gather(Modulation *mod, const ModInputs *in, float *slots) {
+    if (mod->uses_bands) {
+        fft_bands(in->bins, in->num_bins, mod->sample_rate, mod->fft_size, slots + SLOT_LOW);
+    }
+    if (mod->uses_onset) {
+        slots[SLOT_ONSET] = (float)fft_beat(&mod->beat, slots[SLOT_LOW], (long)(in->time * 1e9));
+    }
+    slots[SLOT_LOUDNESS] = in->glow_level >= 0.0f ? in->glow_level : bin_mean(in->bins, in->num_bins, 0, in->num_bins - 1);
+    slots[SLOT_HUE] = in->hue;
+    slots[SLOT_CHROMA] = in->key_strength > 0.0f ? in->key_strength : 0.0f;
+    for (int i = 0; i < mod->num_ranges; ++i) {
+        slots[SLOT_FIXED + i] = bin_mean(in->bins, in->num_bins, mod->bin_lo[i], mod->bin_hi[i]);
+    }
+}
+
+void modulation_update(Modulation *mod, const ModInputs *in, float dt, float *out) {
+    if (!mod) return;
+    float slots[MAX_SLOTS];
+    gather(mod, in, slots);
+    memcpy(out, mod->base, sizeof(mod->base));
+
+    for (int i = 0; i < mod->count; ++i) {
+        ModEntry *e = &mod->entries[i];
+        float x = slots[e->slot] * e->in_scale + e->in_bias;
+        if (x < 0.0f) x = 0.0f;
+        switch (e->curve) {
+            case MOD_CURVE_SQUARE: x = x * x; break;
+            case MOD_CURVE_SQRT:   x = sqrtf(x); break;
+            case MOD_CURVE_SMOOTH: if (x > 1.0f) x = 1.0f; x = x * x * (3.0f - 2.0f * x); break;
+            case MOD_CURVE_STEP:   x = x >= 0.5f ? 1.0f : 0.0f; break;
+            default: break;
+        }
+
+        // One-pole follower, so the response is the same at any frame rate
+        float tau = x > e->level ? e->attack : e->release;
+        if (tau > 0.0f) e->level += (x - e->level) * (1.0f - expf(-dt / tau));
+        else e->level = x;
+
+        out[e->target] += e->offset + e->scale * e->level;
+    }
+}
+
+void modulation_cleanup(Modulation *mod) {
+    free(mod);
+}
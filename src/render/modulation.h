@@ -0,0 +1,32 @@
+#ifndef MODULATION_H
+#define MODULATION_H
+
+#include "../utils/config.h"
+
+typedef struct Modulation Modulation;
+
+// What the routes read this frame
+typedef struct {
+    const float *bins;      // The whole spectrum, not just the bins drawn
+    int num_bins;
+    float glow_level;       // Level of sources routed to glow, or < 0 for none
+    float hue;              // Reactive hue, 0-1
+    float key_strength;     // -1 to 1
+    float time;             // Seconds since start, for onset timing
+} ModInputs;
+
+// Compile config->mod_routes into a flat table of slot reads, ranges,
+// curves and followers. NULL on allocation failure.
+Modulation* modulation_init(const RavizConfig *config);
+
+// Recompile after a config reload. Followers of routes that are left
+// unchanged keep their state.
+void modulation_compile(Modulation *mod, const RavizConfig *config);
+
+// Advance every route by 'dt' seconds and write the sum per target into
+// 'out' (MOD_TARGETS values, indexed by ModTarget).
+void modulation_update(Modulation *mod, const ModInputs *in, float dt, float *out);
+
+void modulation_cleanup(Modulation *mod);
+
+#endif
@@ -0,0 +1,184 @@
+#include "particles.h"
+#include "shader.h"
+#include "../utils/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PARTICLE_BINS 64
+
+// Per-particle state, interleaved in one buffer:
+//   vec4 pos  (xyz, remaining life in seconds)
+//   vec4 vel  (xyz, spawn seed)
+#define PARTICLE_STRIDE (8 * sizeof(float))
+
+struct ParticleSystem {
+    int count;
+    int current;        // Buffer holding the latest state
+
+    GLuint state[2];
+    GLuint update_vao[2];
+    GLuint draw_vao[2];
+
+    GLuint update_program;
+    GLuint draw_program;
+
+    GLint u_fft_data;
+    GLint u_intensity;
+    GLint u_time;
+    GLint u_dt;
+
+    GLint u_model;
+    GLint u_view;
+    GLint u_projection;
+    GLint u_viewport;
+    GLint u_point_size;
+    GLint u_color_mode;
+    GLint u_hue;
+};
+
+static void setup_state_attribs(GLuint buffer, GLuint divisor) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, PARTICLE_STRIDE, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, divisor);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, PARTICLE_STRIDE, (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, divisor);
+}
+
+int particles_reload_shaders(ParticleSystem *ps) {
+    static const char *varyings[] = { "out_pos", "out_vel" };
+    ProgramBuilder build = ps->draw_program ? build_program_files : build_program_initial;
+    GLuint update_program = build("particles_update.vert", NULL, varyings, 2);
+    GLuint draw_program = build("particles_draw.vert", "particles_draw.frag", NULL, 0);
+    if (!update_program || !draw_program) {
+        if (update_program) glDeleteProgram(update_program);
+        if (draw_program) glDeleteProgram(draw_program);
+        return 0;
+    }
+
+    if (ps->update_program) glDeleteProgram(ps->update_program);
+    if (ps->draw_program) glDeleteProgram(ps->draw_program);
+    ps->update_program = update_program;
+    ps->draw_program = draw_program;
+
+    ps->u_fft_data = glGetUniformLocation(ps->update_program, "fft_data");
+    ps->u_intensity = glGetUniformLocation(ps->update_program, "intensity");
+    ps->u_time = glGetUniformLocation(ps->update_program, "time");
+    ps->u_dt = glGetUniformLocation(ps->update_program, "dt");
+
+    ps->u_model = glGetUniformLocation(ps->draw_program, "model");
+    ps->u_view = glGetUniformLocation(ps->draw_program, "view");
+    ps->u_projection = glGetUniformLocation(ps->draw_program, "projection");
+    ps->u_viewport = glGetUniformLocation(ps->draw_program, "viewport");
+    ps->u_point_size = glGetUniformLocation(ps->draw_program, "point_size");
+    ps->u_color_mode = glGetUniformLocation(ps->draw_program, "color_mode");
+    ps->u_hue = glGetUniformLocation(ps->draw_program, "hue");
+    return 1;
+}
+
+ParticleSystem* particles_init(int count) {
+    if (count < 1) return NULL;
+
+    ParticleSystem *ps = calloc(1, sizeof(ParticleSystem));
+    if (!ps) return NULL;
+    ps->count = count;
+
+    if (!particles_reload_shaders(ps)) {
+        particles_cleanup(ps);
+        return NULL;
+    }
+
+    // Zeroed state: every particle has no life left, so the first update
+    // respawns all of them on the GPU. This is the only CPU upload of state.
+    float *initial = calloc((size_t)count, PARTICLE_STRIDE);
+    for (int i = 0; i < count; ++i) {
+        initial[i * 8 + 7] = (float)i; // Distinct spawn seed per particle
+    }
+
+    glGenBuffers(2, ps->state);
+    glGenVertexArrays(2, ps->update_vao);
+    glGenVertexArrays(2, ps->draw_vao);
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, ps->state[i]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)count * PARTICLE_STRIDE, initial, GL_DYNAMIC_COPY);
+
+        glBindVertexArray(ps->update_vao[i]);
+        setup_state_attribs(ps->state[i], 0);
+
+        glBindVertexArray(ps->draw_vao[i]);
+        setup_state_attribs(ps->state[i], 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    free(initial);
+
+    ps->current = 0;
+    log_info("Render", "Particle field: %d particles (%.1f MB GPU state)",
+           count, 2.0 * count * PARTICLE_STRIDE / (1024.0 * 1024.0));
+    return ps;
+}
+
+void particles_update(ParticleSystem *ps, const float *fft_data, int num_bins,
+                      float intensity, float time, float dt) {
+    if (!ps) return;
+    if (dt > 0.1f) dt = 0.1f; // Don't explode after a stall
+
+    float bins[PARTICLE_BINS] = {0};
+    for (int i = 0; i < num_bins && i < PARTICLE_BINS; ++i) bins[i] = fft_data[i];
+
+    int src = ps->current;
+    int dst = 1 - src;
+
+    glUseProgram(ps->update_program);
+    glUniform1fv(ps->u_fft_data, PARTICLE_BINS, bins);
+    glUniform1f(ps->u_intensity, intensity);
+    glUniform1f(ps->u_time, time);
+    glUniform1f(ps->u_dt, dt);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(ps->update_vao[src]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, ps->state[dst]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, ps->count);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    ps->current = dst;
+}
+
+void particles_draw(ParticleSystem *ps, const float *model, const float *view, const float *projection,
+                    int width, int height, float point_size, int color_mode, float hue) {
+    if (!ps) return;
+
+    glUseProgram(ps->draw_program);
+    glUniformMatrix4fv(ps->u_model, 1, GL_FALSE, model);
+    glUniformMatrix4fv(ps->u_view, 1, GL_FALSE, view);
+    glUniformMatrix4fv(ps->u_projection, 1, GL_FALSE, projection);
+    glUniform2f(ps->u_viewport, (float)width, (float)height);
+    glUniform1f(ps->u_point_size, point_size);
+    glUniform1i(ps->u_color_mode, color_mode);
+    glUniform1f(ps->u_hue, hue);
+
+    // Additive, unsorted: no depth writes needed
+    glDepthMask(GL_FALSE);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+    glBindVertexArray(ps->draw_vao[ps->current]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, ps->count);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_TRUE);
+}
+
+void particles_cleanup(ParticleSystem *ps) {
+    if (ps) {
+        glDeleteVertexArrays(2, ps->update_vao);
+        glDeleteVertexArrays(2, ps->draw_vao);
+        glDeleteBuffers(2, ps->state);
+        if (ps->update_program) glDeleteProgram(ps->update_program);
+        if (ps->draw_program) glDeleteProgram(ps->draw_program);
+        free(ps);
+    }
+}
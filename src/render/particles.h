@@ -0,0 +1,27 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "gl_loader.h"
+
+typedef struct ParticleSystem ParticleSystem;
+
+// Allocate GPU state for 'count' particles. All per-particle state lives in
+// two GPU buffers that are ping-ponged through transform feedback.
+ParticleSystem* particles_init(int count);
+
+// Advance the simulation by 'dt' seconds. Only the spectrum is uploaded.
+void particles_update(ParticleSystem *ps, const float *fft_data, int num_bins,
+                      float intensity, float time, float dt);
+
+// Draw all particles as instanced camera-facing quads.
+// 'model', 'view', 'projection' are column-major 4x4 matrices.
+void particles_draw(ParticleSystem *ps, const float *model, const float *view, const float *projection,
+                    int width, int height, float point_size, int color_mode, float hue);
+
+// Rebuild both programs from the shader files. Keeps the old programs and
+// returns 0 if either fails to build.
+int particles_reload_shaders(ParticleSystem *ps);
+
+void particles_cleanup(ParticleSystem *ps);
+
+#endif
@@ -0,0 +1,157 @@
+#include "program_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "RAVIZPB1"
+
+typedef struct {
+    char magic[8];
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+} CacheHeader;
+
+static int cache_enabled = 1;
+static int cache_state = -1;   // -1: not probed, 0: unavailable, 1: ready
+static char cache_dir[512];
+
+void program_cache_set_enabled(int enabled) {
+    cache_enabled = enabled;
+}
+
+static int cache_ready(void) {
+    if (!cache_enabled) return 0;
+    if (cache_state >= 0) return cache_state;
+
+    cache_state = 0;
+    if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri) return 0;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats < 1) return 0;
+
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char base[448];
+    if (xdg && xdg[0]) snprintf(base, sizeof(base), "%s", xdg);
+    else if (home) snprintf(base, sizeof(base), "%s/.cache", home);
+    else return 0;
+
+    mkdir(base, 0755);
+    snprintf(cache_dir, sizeof(cache_dir), "%s/raviz", base);
+    if (mkdir(cache_dir, 0755) != 0 && access(cache_dir, W_OK) != 0) return 0;
+
+    cache_state = 1;
+    return 1;
+}
+
+// FNV-1a, 64 bit
+static uint64_t hash_string(uint64_t h, const char *s) {
+    if (s) {
+        for (; *s; s++) {
+            h ^= (unsigned char)*s;
+            h *= 0x100000001b3ULL;
+        }
+    }
+    // Separator so ("ab", "c") and ("a", "bc") differ
+    h ^= 0xff;
+    h *= 0x100000001b3ULL;
+    return h;
+}
+
+uint64_t program_cache_key(const char *const *parts, int count) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = hash_string(h, (const char*)glGetString(GL_VENDOR));
+    h = hash_string(h, (const char*)glGetString(GL_RENDERER));
+    h = hash_string(h, (const char*)glGetString(GL_VERSION));
+    for (int i = 0; i < count; ++i) {
+        h = hash_string(h, parts[i]);
+    }
+    return h;
+}
+
+static void entry_path(char *out, size_t size, uint64_t key) {
+    snprintf(out, size, "%s/%016llx.bin", cache_dir, (unsigned long long)key);
+}
+
+GLuint program_cache_load(uint64_t key) {
+    if (!cache_ready()) return 0;
+
+    char path[600];
+    entry_path(path, sizeof(path), key);
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    CacheHeader header;
+    void *binary = NULL;
+    int ok = fread(&header, sizeof(header), 1, f) == 1 &&
+             memcmp(header.magic, CACHE_MAGIC, 8) == 0 &&
+             header.key == key && header.length > 0;
+    if (ok) {
+        binary = malloc(header.length);
+        ok = binary && fread(binary, 1, header.length, f) == header.length;
+    }
+    fclose(f);
+
+    GLuint program = 0;
+    if (ok) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    free(binary);
+
+    // Stale or corrupt: drop it so the fresh link replaces it
+    if (!program) unlink(path);
+    return program;
+}
+
+void program_cache_prepare(GLuint program) {
+    if (cache_ready()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void program_cache_store(uint64_t key, GLuint program) {
+    if (!cache_ready()) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    void *binary = malloc(length);
+    if (!binary) return;
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    header.key = key;
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary);
+    header.format = format;
+    header.length = (uint32_t)written;
+
+    // Write to a temporary name and rename so readers never see a partial file
+    char path[600], tmp[620];
+    entry_path(path, sizeof(path), key);
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+
+    FILE *f = fopen(tmp, "wb");
+    if (f) {
+        int ok = written > 0 &&
+                 fwrite(&header, sizeof(header), 1, f) == 1 &&
+                 fwrite(binary, 1, written, f) == (size_t)written;
+        ok = (fclose(f) == 0) && ok;
+        if (!ok || rename(tmp, path) != 0) unlink(tmp);
+    }
+    free(binary);
+}
@@ -0,0 +1,28 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "gl_loader.h"
+#include <stdint.h>
+
+// On-disk cache of linked program binaries (glGetProgramBinary) under
+// $XDG_CACHE_HOME/raviz or ~/.cache/raviz. Entries are keyed by a hash of
+// the program's sources plus the GL vendor/renderer/version strings, so a
+// driver update or shader edit simply misses. Inert when the driver exposes
+// no binary formats or the cache is disabled.
+
+void program_cache_set_enabled(int enabled);
+
+// Hash 'count' NUL-terminated strings (NULL entries allowed) together with
+// the current driver identity. Requires a current GL context.
+uint64_t program_cache_key(const char *const *parts, int count);
+
+// Returns a linked program restored from the cache, or 0 on a miss.
+GLuint program_cache_load(uint64_t key);
+
+// Call on a program before glLinkProgram so its binary can be retrieved.
+void program_cache_prepare(GLuint program);
+
+// Write a successfully linked program to the cache.
+void program_cache_store(uint64_t key, GLuint program);
+
+#endif
@@ -0,0 +1,205 @@
+#define _POSIX_C_SOURCE 200809L
+#include "readback.h"
+#include "../utils/png_write.h"
+#include "../utils/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+// Frames in flight. glReadPixels into a bound PBO returns immediately; the
+// copy is only waited on (by fence) when the slot comes round again.
+#define READBACK_RING 3
+
+typedef enum {
+    READBACK_NONE,
+    READBACK_RAW,
+    READBACK_PNG
+} ReadbackFormat;
+
+struct FrameReadback {
+    int width;
+    int height;
+    size_t frame_bytes;
+
+    GLuint pbo[READBACK_RING];
+    GLsync fence[READBACK_RING];
+    long frame_index[READBACK_RING];
+    int next;
+
+    ReadbackFormat format;
+    FILE *raw;
+    char *pattern;
+    long captured;
+    long written;
+
+    long mark_index;        // Frame being timed (readback_mark), or -1
+    long mark_written_ns;
+};
+
+static int write_frame(FrameReadback *rb, const unsigned char *pixels, long index) {
+    size_t row = (size_t)rb->width * 4;
+
+    if (rb->format == READBACK_RAW) {
+        // GL rows are bottom-up; write top-down so ffmpeg needs no vflip
+        for (int y = rb->height - 1; y >= 0; --y) {
+            if (fwrite(pixels + (size_t)y * row, 1, row, rb->raw) != row) return 0;
+        }
+    } else if (rb->format == READBACK_PNG) {
+        char path[1024];
+        snprintf(path, sizeof(path), rb->pattern, (int)index);
+        if (png_write_rgba(path, pixels, rb->width, rb->height, (int)row, 1) != 0) {
+            log_error("Readback", "Failed to write %s", path);
+            return 0;
+        }
+    }
+    rb->written++;
+    if (index == rb->mark_index) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        rb->mark_written_ns = ts.tv_sec * 1000000000L + ts.tv_nsec;
+        rb->mark_index = -1;
+    }
+    return 1;
+}
+
+// The pattern is handed to snprintf with the frame index as its only
+// argument: it must hold exactly one %d, %i or %0Nd, and %% for a
+// literal percent sign.
+static int valid_pattern(const char *pattern) {
+    int conversions = 0;
+    for (const char *p = pattern; *p; ++p) {
+        if (*p != '%') continue;
+        if (p[1] == '%') { ++p; continue; }
+        ++p;
+        while (*p >= '0' && *p <= '9') ++p;
+        if (*p != 'd' && *p != 'i') return 0;
+        ++conversions;
+    }
+    return conversions == 1;
+}
+
+// Wait for the slot's copy to land, then hand the pixels to the writer
+static int retire_slot(FrameReadback *rb, int slot) {
+    if (!rb->fence[slot]) return 1;
+
+    glClientWaitSync(rb->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(rb->fence[slot]);
+    rb->fence[slot] = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo[slot]);
+    const unsigned char *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rb->frame_bytes, GL_MAP_READ_BIT);
+    int ok = 1;
+    if (pixels) {
+        ok = write_frame(rb, pixels, rb->frame_index[slot]);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return ok;
+}
+
+FrameReadback* readback_init(int width, int height, const char *output) {
+    FrameReadback *rb = calloc(1, sizeof(FrameReadback));
+    if (!rb) return NULL;
+
+    rb->width = width;
+    rb->height = height;
+    rb->frame_bytes = (size_t)width * height * 4;
+    rb->mark_index = -1;
+
+    if (!output) {
+        rb->format = READBACK_NONE;
+    } else if (strcmp(output, "-") == 0) {
+        // The video stream owns stdout from here on: keep a private handle
+        // to it and point fd 1 at stderr so log output can't corrupt frames.
+        // Anything still buffered in stdout is flushed after the swap so it
+        // lands on stderr too.
+        int video_fd = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        fflush(stdout);
+        rb->raw = fdopen(video_fd, "wb");
+        rb->format = READBACK_RAW;
+    } else if (strchr(output, '%')) {
+        if (!valid_pattern(output)) {
+            log_error("Readback", "Output pattern '%s' needs exactly one %%d (or %%0Nd) for the frame number", output);
+            free(rb);
+            return NULL;
+        }
+        rb->pattern = strdup(output);
+        rb->format = READBACK_PNG;
+    } else {
+        rb->raw = fopen(output, "wb");
+        rb->format = READBACK_RAW;
+    }
+
+    if (rb->format == READBACK_RAW && !rb->raw) {
+        log_error("Readback", "Cannot open output '%s'", output);
+        free(rb);
+        return NULL;
+    }
+
+    glGenBuffers(READBACK_RING, rb->pbo);
+    for (int i = 0; i < READBACK_RING; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, rb->frame_bytes, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    log_info("Readback", "%dx%d, %d PBOs in flight, output: %s",
+            width, height, READBACK_RING, output ? output : "(discard)");
+    return rb;
+}
+
+int readback_capture(FrameReadback *rb, GLuint fbo) {
+    if (!rb) return 1;
+
+    int slot = rb->next;
+    int ok = retire_slot(rb, slot);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo[slot]);
+    glReadPixels(0, 0, rb->width, rb->height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    rb->fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    rb->frame_index[slot] = rb->captured++;
+    rb->next = (slot + 1) % READBACK_RING;
+    return ok;
+}
+
+void readback_flush(FrameReadback *rb) {
+    if (!rb) return;
+    // Oldest first so frames stay in order
+    for (int i = 0; i < READBACK_RING; ++i) {
+        retire_slot(rb, (rb->next + i) % READBACK_RING);
+    }
+    if (rb->raw) fflush(rb->raw);
+}
+
+void readback_mark(FrameReadback *rb) {
+    if (!rb) return;
+    rb->mark_index = rb->captured;
+    rb->mark_written_ns = 0;
+}
+
+long readback_marked_written(const FrameReadback *rb) {
+    return rb ? rb->mark_written_ns : 0;
+}
+
+long readback_frames_written(FrameReadback *rb) {
+    return rb ? rb->written : 0;
+}
+
+void readback_cleanup(FrameReadback *rb) {
+    if (rb) {
+        readback_flush(rb);
+        glDeleteBuffers(READBACK_RING, rb->pbo);
+        if (rb->raw) fclose(rb->raw);
+        free(rb->pattern);
+        free(rb);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include "gl_loader.h"
+
+typedef struct FrameReadback FrameReadback;
+
+// Asynchronous frame readback through a ring of pixel buffer objects.
+// 'output' is "-" for raw RGBA on stdout, a printf-style pattern containing
+// '%' (e.g. "frames/%06d.png") for numbered PNGs, or any other path for a
+// raw RGBA file. NULL reads frames back without writing them.
+FrameReadback* readback_init(int width, int height, const char *output);
+
+// Queue a readback of the colour attachment of 'fbo'. Returns immediately;
+// the frame is written once its fence has signalled, a few frames later.
+// Returns 0 if writing the output failed.
+int readback_capture(FrameReadback *rb, GLuint fbo);
+
+// Block until all queued frames are written.
+void readback_flush(FrameReadback *rb);
+
+// Time the next captured frame: readback_marked_written then returns when
+// it was written (CLOCK_MONOTONIC ns), 0 until it has been.
+void readback_mark(FrameReadback *rb);
+long readback_marked_written(const FrameReadback *rb);
+
+// Number of frames written so far.
+long readback_frames_written(FrameReadback *rb);
+
+void readback_cleanup(FrameReadback *rb);
+
+#endif
@@ -1,14 +1,55 @@
+#define _GNU_SOURCE   // RTLD_DEFAULT
 #include "render.h"
 #include "gl_loader.h"
+#include "shader.h"
+#include "particles.h"
+#include "scope.h"
+#include "../fft/fft.h"
+#include "spring.h"
+#include "target.h"
+#include "readback.h"
+#include "program_cache.h"
+#include "resolution.h"
+#include "bloom.h"
+#include "frame_pacer.h"
+#include "uniform_ring.h"
+#include "modulation.h"
+#include "../utils/watch.h"
+#include "../utils/alloc_audit.h"
+#include "../utils/log.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include <GLFW/glfw3.h>
+#ifdef RAVIZ_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 #include <cglm/cglm.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
 
 #define MAX_FFT_BINS 64
+#define FRAME_BINDING 0
+#define GPU_TIMER_RING 4
+
+// std140 image of the "Frame" block in sphere.vert/sphere.frag
+typedef struct {
+    mat4 model;                     // offset 0
+    mat4 view;                      // 64
+    mat4 projection;                // 128
+    float fft[MAX_FFT_BINS];        // 192, as vec4[16]
+    float time;                     // 448
+    float intensity;                // 452
+    int color_mode;                 // 456
+    float hue;                      // 460
+    float modulation[8];            // 464, as vec4[2]: output per ModTarget
+} FrameUniforms;
+
+_Static_assert(MOD_TARGETS <= 8, "FrameUniforms.modulation (vec4[2] in the shaders) holds 8 targets");
 
 void set_window_icon(GLFWwindow* window) {
     GLFWimage images[1];
@@ -28,178 +69,168 @@ void set_window_icon(GLFWwindow* window) {
             return;
         }
     }
-    fprintf(stderr, "[Render] Could not find logo.png for window icon.\n");
+    log_warn("Render", "Could not find logo.png for window icon.");
 }
 
 struct RenderContext {
     GLFWwindow *window;
+    int glfw_ready;
     RavizConfig config;
+
+    // Extra windows (render_init_shared) draw with the main window's
+    // program, mesh, spring field and history ring; 'share' is that window.
+    // Only their VAOs, targets, pacer and scene extras are their own.
+    RenderContext *share;
+    int sharers;        // Main window: extra windows open on it
+    int id;             // 0 for the main window, else the order it opened in
+    int opened;         // Main window: extra windows opened so far
+    unsigned shader_epoch;   // Main window: bumped by every program rebuild
+    unsigned shaders_seen;   // Epoch this window's scene programs match
+    unsigned mesh_epoch;     // Main window: bumped by every mesh rebuild
+    unsigned mesh_seen;      // Extra window: epoch its mesh VAO was built for
+    long spring_ns;          // Main window: when the spring field last advanced
+
+    // Headless: render into 'output' and read frames back asynchronously
+    int headless;
+    RenderTarget output;
+    FrameReadback *readback;
+    int output_failed;
+#ifdef RAVIZ_HAVE_EGL
+    EGLDisplay egl_display;
+    EGLContext egl_context;
+#endif
     
     GLuint shader_program;
     GLuint vao, vbo, ebo;
     int num_indices;
+    GLenum index_type;
+    GLuint empty_vao;   // Bound for attribute-less draws
+    int lod_lat, lod_lon;
     
-    GLint u_time;
-    GLint u_fft_data;
     GLint u_resolution;
-    GLint u_view;
-    GLint u_projection;
-    GLint u_model;
-    GLint u_intensity;
-    GLint u_color_mode;
+    GLint u_scene;
+    GLint u_history;
+    GLint u_history_offset;
+    GLint u_procedural;
+    GLint u_grid;
+    GLint u_spring;
+    GLint u_deform_state;
     
     float time;
+    float dt;
     float fft_data[MAX_FFT_BINS];
+    float hue;          // Reactive colour: pitch class from the analysis, 0-1
+    int has_pitch;      // Else (replay) the hue drifts with time
+    int key;
+    float key_strength;
+    UniformRing *frame_ring;   // Backs the sphere's "Frame" uniform block
+    Modulation *modulation;    // Compiled [[modulation.routes]]
+    float mod_out[MOD_TARGETS]; // This frame's value per target
+    float spin;                // Rotation the modulation added on top of rotation_speed
+
+    ParticleSystem *particles; // Created on first use of the particle scene
+    ScopeView *scope;          // Created with the first oscilloscope window
+    SpringField *spring;       // Per-vertex dynamics, mesh mode only
+
+    // Spectrogram history: fft_bins x history_frames ring, one row per hop.
+    // Rows are never moved; history_row is the next row to overwrite.
+    GLuint history_tex;
+    int history_bins;
+    int history_row;
 
     // Runtime state
     int wireframe_mode; // 0: Fill, 1: Line, 2: Point
+    FileWatch *shader_watch;
+
+    // Dynamic resolution: the scene renders into 'scene' at a governed
+    // fraction of the window size and is upscaled with a linear blit
+    ResolutionGovernor *governor;
+    RenderTarget scene;
+    float pixel_scale;  // Scene pixels per window pixel this frame
+    GLenum scene_format;
+
+    Bloom *bloom;       // NULL until bloom is first enabled
+    float glow_level;   // render_set_glow: drives the glow instead of the spectrum
+    int has_glow;
+
+    // Frame throttling and latency stats
+    FramePacer *pacer;
+    long input_ns;      // Capture time of the spectrum being drawn
+    int mark_next;      // render_mark_frame: time the next frame
+    long marked_submitted;
+    long marked_shown;
+    long stats_start_ns;
+    int stats_frames;
+    unsigned long stats_allocs;
+
+    // --perf-report: a GL_TIMESTAMP pair around each frame's GPU work,
+    // read a few frames later so measuring never stalls the pipeline
+    int gpu_timing;
+    GLuint gpu_queries[GPU_TIMER_RING][2];
+    int gpu_pending[GPU_TIMER_RING];
+    int gpu_head;
+    double gpu_ms;
+    long gpu_frames;
 };
 
-const char *vs_source = "#version 330 core\n"
-    "layout (location = 0) in vec3 aPos;\n"
-    "layout (location = 1) in vec3 aNormal;\n"
-    "\n"
-    "uniform float time;\n"
-    "uniform float fft_data[64];\n"
-    "uniform float intensity;\n"
-    "uniform mat4 model;\n"
-    "uniform mat4 view;\n"
-    "uniform mat4 projection;\n"
-    "\n"
-    "out vec3 vNormal;\n"
-    "out vec3 vPos;\n"
-    "out float vDisplacement;\n"
-    "\n"
-    "float random(vec3 st) {\n"
-    "    return fract(sin(dot(st.xyz, vec3(12.9898,78.233,45.5432))) * 43758.5453123);\n"
-    "}\n"
-    "\n"
-    "void main() {\n"
-    "    vec3 pos = aPos;\n"
-    "    \n"
-    "    float low_energy = 0.0;\n"
-    "    for(int i=0; i<5; i++) low_energy += fft_data[i];\n"
-    "    low_energy /= 5.0;\n"
-    "    \n"
-    "    float mid_energy = 0.0;\n"
-    "    for(int i=5; i<20; i++) mid_energy += fft_data[i];\n"
-    "    mid_energy /= 15.0;\n"
-    "    \n"
-    "    float displacement = 0.0;\n"
-    "    \n"
-    "    displacement += low_energy * 0.2 * intensity;\n"
-    "    \n"
-    "    float noise = random(pos + time * 0.1);\n"
-    "    displacement += noise * mid_energy * 0.5 * intensity;\n"
-    "    \n"
-    "    vec3 new_pos = pos + aNormal * displacement;\n"
-    "    \n"
-    "    vDisplacement = displacement;\n"
-    "    vNormal = aNormal;\n"
-    "    vPos = new_pos;\n"
-    "    \n"
-    "    gl_Position = projection * view * model * vec4(new_pos, 1.0);\n"
-    "}\n";
-
-const char *fs_source = "#version 330 core\n"
-    "out vec4 FragColor;\n"
-    "\n"
-    "in vec3 vNormal;\n"
-    "in vec3 vPos;\n"
-    "in float vDisplacement;\n"
-    "\n"
-    "uniform float time;\n"
-    "uniform int color_mode;\n"
-    "\n"
-    "// 0: None (Blue/Purple), 1: Static (White/Gold), 2: Reactive (Rainbow)\n"
-    "\n"
-    "vec3 hsv2rgb(vec3 c) {\n"
-    "    vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);\n"
-    "    vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);\n"
-    "    return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);\n"
-    "}\n"
-    "\n"
-    "void main() {\n"
-    "    vec3 norm = normalize(vNormal);\n"
-    "    float fresnel = pow(1.0 - max(dot(norm, vec3(0.0, 0.0, 1.0)), 0.0), 3.0);\n"
-    "    \n"
-    "    vec3 base_color = vec3(0.1, 0.4, 0.8);\n"
-    "    vec3 glow_color = vec3(0.5, 0.8, 1.0);\n"
-    "    \n"
-    "    if (color_mode == 1) { // Static (Golden/Warm)\n"
-    "        base_color = vec3(0.8, 0.5, 0.1);\n"
-    "        glow_color = vec3(1.0, 0.8, 0.5);\n"
-    "    } else if (color_mode == 2) { // Reactive (Rainbow)\n"
-    "        float hue = fract(time * 0.1 + vDisplacement);\n"
-    "        base_color = hsv2rgb(vec3(hue, 0.8, 0.8));\n"
-    "        glow_color = hsv2rgb(vec3(hue + 0.1, 0.5, 1.0));\n"
-    "    }\n"
-    "    \n"
-    "    vec3 color = base_color;\n"
-    "    color += vec3(0.8, 0.2, 0.5) * vDisplacement * 5.0;\n"
-    "    color += glow_color * fresnel * 0.8;\n"
-    "    \n"
-    "    FragColor = vec4(color, 1.0);\n"
-    "}\n";
-
-GLuint compile_shader(GLenum type, const char *source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
-    
-    int success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        fprintf(stderr, "Shader compilation failed: %s\n", infoLog);
-        return 0;
-    }
-    return shader;
+static long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// The context holding the objects extra windows share
+static RenderContext* gl_owner(RenderContext *ctx) {
+    return ctx->share ? ctx->share : ctx;
+}
+
+// Windows share one thread, and GL calls go to whichever context is
+// current: every entry point that issues them selects its own first
+static void make_current(RenderContext *ctx) {
+    if (ctx->window && glfwGetCurrentContext() != ctx->window) glfwMakeContextCurrent(ctx->window);
+}
+
+static void fetch_uniforms(RenderContext *ctx) {
+    GLuint frame_block = glGetUniformBlockIndex(ctx->shader_program, "Frame");
+    if (frame_block != GL_INVALID_INDEX) glUniformBlockBinding(ctx->shader_program, frame_block, FRAME_BINDING);
+    ctx->u_scene = glGetUniformLocation(ctx->shader_program, "scene");
+    ctx->u_history = glGetUniformLocation(ctx->shader_program, "history");
+    ctx->u_history_offset = glGetUniformLocation(ctx->shader_program, "history_offset");
+    ctx->u_procedural = glGetUniformLocation(ctx->shader_program, "procedural");
+    ctx->u_grid = glGetUniformLocation(ctx->shader_program, "grid");
+    ctx->u_spring = glGetUniformLocation(ctx->shader_program, "spring");
+    ctx->u_deform_state = glGetUniformLocation(ctx->shader_program, "deform_state");
+}
+
+// Programs of the per-window scene extras. On failure these keep their
+// previous programs.
+static void reload_scene_shaders(RenderContext *ctx) {
+    if (ctx->particles) particles_reload_shaders(ctx->particles);
+    if (ctx->scope) scope_reload_shaders(ctx->scope);
+    if (ctx->bloom) bloom_reload_shaders(ctx->bloom);
+    ctx->shaders_seen = gl_owner(ctx)->shader_epoch;
 }
 
 void reload_shaders(RenderContext *ctx) {
     if (!ctx) return;
+    make_current(ctx);
+    RenderContext *owner = gl_owner(ctx);
     
-    GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_source);
-    if (!vs) return;
-    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fs_source);
-    if (!fs) { glDeleteShader(vs); return; }
-    
-    GLuint new_program = glCreateProgram();
-    glAttachShader(new_program, vs);
-    glAttachShader(new_program, fs);
-    glLinkProgram(new_program);
-    
-    int success;
-    glGetProgramiv(new_program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(new_program, 512, NULL, infoLog);
-        fprintf(stderr, "Program linking failed: %s\n", infoLog);
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        glDeleteProgram(new_program);
-        return;
-    }
-    
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    GLuint new_program = build_program_files("sphere.vert", "sphere.frag", NULL, 0);
+    if (!new_program) return;
     
     // Replace old program
-    glDeleteProgram(ctx->shader_program);
-    ctx->shader_program = new_program;
+    glDeleteProgram(owner->shader_program);
+    owner->shader_program = new_program;
     
-    // Re-fetch uniforms
-    ctx->u_time = glGetUniformLocation(ctx->shader_program, "time");
-    ctx->u_fft_data = glGetUniformLocation(ctx->shader_program, "fft_data");
-    ctx->u_model = glGetUniformLocation(ctx->shader_program, "model");
-    ctx->u_view = glGetUniformLocation(ctx->shader_program, "view");
-    ctx->u_projection = glGetUniformLocation(ctx->shader_program, "projection");
-    ctx->u_intensity = glGetUniformLocation(ctx->shader_program, "intensity");
-    ctx->u_color_mode = glGetUniformLocation(ctx->shader_program, "color_mode");
+    fetch_uniforms(owner);
+    if (owner->spring) spring_reload_shaders(owner->spring);
+
+    // Other windows pick the change up in their next render_update
+    owner->shader_epoch++;
+    reload_scene_shaders(ctx);
     
-    printf("Shaders reloaded.\n");
+    log_info(NULL, "Shaders reloaded.");
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -212,27 +243,44 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             break;
         case GLFW_KEY_F1: // Cycle Color Mode
             ctx->config.color_mode = (ctx->config.color_mode + 1) % 3;
-            printf("Color Mode: %d\n", ctx->config.color_mode);
+            log_info(NULL, "Color Mode: %d", ctx->config.color_mode);
+            break;
+        case GLFW_KEY_F2: // Cycle Scene
+            ctx->config.scene = (ctx->config.scene + 1) % 3;
+            log_info(NULL, "Scene: %d", ctx->config.scene);
+            break;
+        case GLFW_KEY_F3: // Toggle Deformation Mode
+            if (!gl_owner(ctx)->spring) {
+                log_info(NULL, "Spring deformation needs sphere_mode = \"mesh\"");
+                break;
+            }
+            ctx->config.deform = (ctx->config.deform == DEFORM_SPRING) ? DEFORM_STATELESS : DEFORM_SPRING;
+            log_info(NULL, "Deform Mode: %d", ctx->config.deform);
             break;
         case GLFW_KEY_F4: // Cycle Wireframe Mode
             ctx->wireframe_mode = (ctx->wireframe_mode + 1) % 3;
+            make_current(ctx);
              // 0: Fill, 1: Line, 2: Point
              if (ctx->wireframe_mode == 0) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
              else if (ctx->wireframe_mode == 1) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
              else glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
-            printf("Render Mode: %d\n", ctx->wireframe_mode);
+            log_info(NULL, "Render Mode: %d", ctx->wireframe_mode);
             break;
         case GLFW_KEY_F5: // Reload Shaders
             reload_shaders(ctx);
             break;
+        case GLFW_KEY_F6: // Toggle Bloom
+            ctx->config.bloom = !ctx->config.bloom;
+            log_info(NULL, "Bloom: %s", ctx->config.bloom ? "on" : "off");
+            break;
         case GLFW_KEY_UP:
             ctx->config.intensity += 0.1f;
-            printf("Intensity: %.1f\n", ctx->config.intensity);
+            log_info(NULL, "Intensity: %.1f", ctx->config.intensity);
             break;
         case GLFW_KEY_DOWN:
             ctx->config.intensity -= 0.1f;
             if (ctx->config.intensity < 0.0f) ctx->config.intensity = 0.0f;
-            printf("Intensity: %.1f\n", ctx->config.intensity);
+            log_info(NULL, "Intensity: %.1f", ctx->config.intensity);
             break;
     }
 }
@@ -251,46 +299,50 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
         if (ctx->config.sphere_scale < 0.1f) ctx->config.sphere_scale = 0.1f;
         if (ctx->config.sphere_scale > 5.0f) ctx->config.sphere_scale = 5.0f;
         
-        printf("Sphere Scale: %.1f\n", ctx->config.sphere_scale);
+        log_info(NULL, "Sphere Scale: %.1f", ctx->config.sphere_scale);
     }
 }
 
-void generate_sphere(int lat_segments, int lon_segments, GLuint *vao, GLuint *vbo, GLuint *ebo, int *num_indices) {
+void generate_sphere(int lat_segments, int lon_segments, GLuint *vao, GLuint *vbo, GLuint *ebo, int *num_indices, GLenum *index_type) {
     int num_vertices = (lat_segments + 1) * (lon_segments + 1);
     *num_indices = lat_segments * lon_segments * 6;
+
+    // Position only: on the unit sphere the normal equals the position.
+    // 16-bit indices whenever the vertex count allows it.
+    *index_type = (num_vertices <= 65536) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    size_t index_size = (*index_type == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
     
-    float *vertices = malloc(num_vertices * 6 * sizeof(float)); 
-    unsigned int *indices = malloc(*num_indices * sizeof(unsigned int));
+    float *vertices = malloc(num_vertices * 3 * sizeof(float)); 
+    void *indices = malloc(*num_indices * index_size);
     
     int v_idx = 0;
     for (int y = 0; y <= lat_segments; ++y) {
+        float y_segment = (float)y / (float)lat_segments;
+        float sin_phi = sin(y_segment * GLM_PI);
+        float cos_phi = cos(y_segment * GLM_PI);
         for (int x = 0; x <= lon_segments; ++x) {
             float x_segment = (float)x / (float)lon_segments;
-            float y_segment = (float)y / (float)lat_segments;
-            float x_pos = cos(x_segment * 2.0f * GLM_PI) * sin(y_segment * GLM_PI);
-            float y_pos = cos(y_segment * GLM_PI);
-            float z_pos = sin(x_segment * 2.0f * GLM_PI) * sin(y_segment * GLM_PI);
-            
-            vertices[v_idx++] = x_pos;
-            vertices[v_idx++] = y_pos;
-            vertices[v_idx++] = z_pos;
-            
-            vertices[v_idx++] = x_pos;
-            vertices[v_idx++] = y_pos;
-            vertices[v_idx++] = z_pos;
+            vertices[v_idx++] = cos(x_segment * 2.0f * GLM_PI) * sin_phi;
+            vertices[v_idx++] = cos_phi;
+            vertices[v_idx++] = sin(x_segment * 2.0f * GLM_PI) * sin_phi;
         }
     }
     
     int i_idx = 0;
     for (int y = 0; y < lat_segments; ++y) {
         for (int x = 0; x < lon_segments; ++x) {
-            indices[i_idx++] = (y + 1) * (lon_segments + 1) + x;
-            indices[i_idx++] = y * (lon_segments + 1) + x;
-            indices[i_idx++] = y * (lon_segments + 1) + x + 1;
-            
-            indices[i_idx++] = (y + 1) * (lon_segments + 1) + x;
-            indices[i_idx++] = y * (lon_segments + 1) + x + 1;
-            indices[i_idx++] = (y + 1) * (lon_segments + 1) + x + 1;
+            unsigned int quad[6] = {
+                (y + 1) * (lon_segments + 1) + x,
+                y * (lon_segments + 1) + x,
+                y * (lon_segments + 1) + x + 1,
+                (y + 1) * (lon_segments + 1) + x,
+                y * (lon_segments + 1) + x + 1,
+                (y + 1) * (lon_segments + 1) + x + 1
+            };
+            for (int k = 0; k < 6; ++k, ++i_idx) {
+                if (*index_type == GL_UNSIGNED_SHORT) ((unsigned short*)indices)[i_idx] = (unsigned short)quad[k];
+                else ((unsigned int*)indices)[i_idx] = quad[k];
+            }
         }
     }
     
@@ -301,136 +353,856 @@ void generate_sphere(int lat_segments, int lon_segments, GLuint *vao, GLuint *vb
     glBindVertexArray(*vao);
     
     glBindBuffer(GL_ARRAY_BUFFER, *vbo);
-    glBufferData(GL_ARRAY_BUFFER, num_vertices * 6 * sizeof(float), vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, num_vertices * 3 * sizeof(float), vertices, GL_STATIC_DRAW);
     
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, *num_indices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, *num_indices * index_size, indices, GL_STATIC_DRAW);
     
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
     free(vertices);
     free(indices);
 }
 
+// Pick procedural tessellation from the sphere's on-screen size: aim for
+// roughly LOD_EDGE_PIXELS per triangle edge around the silhouette, then
+// scale down uniformly if that exceeds the triangle budget.
+#define LOD_EDGE_PIXELS 6.0f
+
+static void choose_lod(RenderContext *ctx, int height, int *lat, int *lon) {
+    // Camera sits 3 units away with a 45 degree vertical FOV (see render_draw)
+    float radius_px = ctx->config.sphere_scale * height * 0.5f / (tanf(glm_rad(22.5f)) * 3.0f);
+    float circumference_px = 2.0f * GLM_PI * radius_px;
+
+    int n_lon = (int)(circumference_px / LOD_EDGE_PIXELS);
+    if (n_lon < 8) n_lon = 8;
+    if (n_lon > 2048) n_lon = 2048;
+    int n_lat = n_lon / 2;
+
+    long triangles = 2L * n_lat * n_lon;
+    if (ctx->config.lod_triangle_budget > 0 && triangles > ctx->config.lod_triangle_budget) {
+        float k = sqrtf((float)ctx->config.lod_triangle_budget / (float)triangles);
+        n_lon = (int)(n_lon * k);
+        n_lat = (int)(n_lat * k);
+    }
+    if (n_lon < 8) n_lon = 8;
+    if (n_lat < 4) n_lat = 4;
+
+    *lat = n_lat;
+    *lon = n_lon;
+}
+
+void create_history_texture(RenderContext *ctx) {
+    ctx->history_bins = ctx->config.fft_bins;
+    ctx->history_row = 0;
+    if (ctx->config.history_frames < 2) ctx->config.history_frames = 2;
+
+    // Past the driver's limit glTexImage2D fails and the scene stays blank.
+    // Narrowing only drops the top bins: rows are uploaded from the start.
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    if (max_size > 0 && ctx->config.history_frames > max_size) {
+        log_warn("Render", "history_frames %d exceeds the GL texture limit, using %d", ctx->config.history_frames, max_size);
+        ctx->config.history_frames = max_size;
+    }
+    if (max_size > 0 && ctx->history_bins > max_size) {
+        log_warn("Render", "History keeps the lowest %d of %d bins (GL texture limit)", max_size, ctx->history_bins);
+        ctx->history_bins = max_size;
+    }
+
+    float *zeros = calloc((size_t)ctx->history_bins * ctx->config.history_frames, sizeof(float));
+    if (!zeros) log_warn("Render", "Out of memory clearing the history ring, it starts uninitialised");
+
+    glGenTextures(1, &ctx->history_tex);
+    glBindTexture(GL_TEXTURE_2D, ctx->history_tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, ctx->history_bins, ctx->config.history_frames, 0, GL_RED, GL_FLOAT, zeros);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    // Rows wrap so the shader can address the ring with a plain offset
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    free(zeros);
+}
+
+// Build the mesh (and the spring field indexed by it) for the current
+// config first, then retire the old ones, so a live reload never leaves
+// a frame without geometry.
+static void rebuild_sphere(RenderContext *ctx) {
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    int num_indices = 0;
+    GLenum index_type = GL_UNSIGNED_SHORT;
+    SpringField *spring = NULL;
+
+    // Spring state is indexed by mesh vertex, so it needs the fixed mesh.
+    // Created whenever a mesh exists so F3 can toggle it at runtime.
+    if (ctx->config.sphere_mode == SPHERE_MESH) {
+        generate_sphere(ctx->config.sphere_lat, ctx->config.sphere_lon, &vao, &vbo, &ebo, &num_indices, &index_type);
+        spring = spring_init(vbo, ctx->config.sphere_lat, ctx->config.sphere_lon);
+    } else if (ctx->config.deform == DEFORM_SPRING) {
+        log_warn("Render", "Spring deformation needs sphere_mode = \"mesh\", using stateless.");
+        ctx->config.deform = DEFORM_STATELESS;
+    }
+
+    spring_cleanup(ctx->spring);
+    glDeleteVertexArrays(1, &ctx->vao);
+    glDeleteBuffers(1, &ctx->vbo);
+    glDeleteBuffers(1, &ctx->ebo);
+
+    ctx->vao = vao;
+    ctx->vbo = vbo;
+    ctx->ebo = ebo;
+    ctx->num_indices = num_indices;
+    ctx->index_type = index_type;
+    ctx->spring = spring;
+    ctx->mesh_epoch++;
+}
+
+// VAOs are not shared between contexts: an extra window keeps its own
+// over the main window's buffers, redone whenever the mesh is rebuilt
+static void bind_shared_mesh(RenderContext *ctx) {
+    RenderContext *owner = ctx->share;
+    if (!ctx->vao) glGenVertexArrays(1, &ctx->vao);
+    glBindVertexArray(ctx->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, owner->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, owner->ebo);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    ctx->mesh_seen = owner->mesh_epoch;
+}
+
+static void rebuild_history(RenderContext *ctx) {
+    GLuint old = ctx->history_tex;
+    create_history_texture(ctx);
+    glDeleteTextures(1, &old);
+}
+
+static void create_governor(RenderContext *ctx) {
+    resolution_cleanup(ctx->governor);
+    ctx->governor = NULL;
+    ctx->pixel_scale = 1.0f;
+    if (!ctx->headless && ctx->config.adaptive_resolution) {
+        float *lo = &ctx->config.render_scale_min, *hi = &ctx->config.render_scale_max;
+        if (*hi > 2.0f) *hi = 2.0f;
+        if (*hi < 0.25f) *hi = 0.25f;
+        if (*lo < 0.25f) *lo = 0.25f;
+        if (*lo > *hi) *lo = *hi;
+        ctx->governor = resolution_init(*lo, *hi, ctx->config.fps);
+    }
+}
+
 void error_callback(int error, const char* description) {
-    fprintf(stderr, "GLFW Error: %s\n", description);
+    log_error("Render", "GLFW Error: %s", description);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-RenderContext* render_init(const RavizConfig *config) {
-    RenderContext *ctx = malloc(sizeof(RenderContext));
-    if (!ctx) return NULL;
-    
-    ctx->config = *config;
-    ctx->time = 0.0f;
-    ctx->wireframe_mode = 0;
-    for(int i=0; i<MAX_FFT_BINS; i++) ctx->fft_data[i] = 0.0f;
-    
-    glfwSetErrorCallback(error_callback);
-    
-    if (!glfwInit()) {
-        fprintf(stderr, "Failed to initialize GLFW\n");
-        free(ctx);
-        return NULL;
+// Borderless over monitor 'index' (glfwGetMonitors order). The window
+// stays floating if no such monitor is connected.
+static void cover_monitor(GLFWwindow *window, int index) {
+    int count = 0;
+    GLFWmonitor **monitors = glfwGetMonitors(&count);
+    if (index >= count) {
+        log_warn("Render", "No monitor %d (%d connected), window left floating.", index, count);
+        return;
+    }
+    const GLFWvidmode *mode = glfwGetVideoMode(monitors[index]);
+    int x, y;
+    glfwGetMonitorPos(monitors[index], &x, &y);
+    glfwSetWindowPos(window, x, y);
+    if (mode) glfwSetWindowSize(window, mode->width, mode->height);
+}
+
+static int create_window_context(RenderContext *ctx) {
+    // Extra windows join the main window's GLFW session
+    if (!ctx->share) {
+        glfwSetErrorCallback(error_callback);
+
+        if (!glfwInit()) {
+            log_error("Render", "Failed to initialize GLFW");
+            return 0;
+        }
+        ctx->glfw_ready = 1;
     }
     
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     
-    glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, GLFW_TRUE);
-    glfwWindowHint(GLFW_DECORATED, GLFW_FALSE);
-    glfwWindowHint(GLFW_FLOATING, GLFW_TRUE);
+    if (ctx->headless) {
+        // Only needed for the context; everything renders into an FBO
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    } else {
+        glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, GLFW_TRUE);
+        glfwWindowHint(GLFW_DECORATED, GLFW_FALSE);
+        glfwWindowHint(GLFW_FLOATING, GLFW_TRUE);
+    }
     
-    ctx->window = glfwCreateWindow(800, 800, "Raviz", NULL, NULL);
+    GLFWwindow *share = ctx->share ? ctx->share->window : NULL;
+    ctx->window = glfwCreateWindow(ctx->headless ? 64 : 800, ctx->headless ? 64 : 800, "Raviz", NULL, share);
     if (!ctx->window) {
-        fprintf(stderr, "Failed to create GLFW window\n");
-        glfwTerminate();
-        free(ctx);
-        return NULL;
+        log_error("Render", "Failed to create GLFW window");
+        return 0;
     }
 
+    glfwMakeContextCurrent(ctx->window);
+    if (ctx->headless) return load_gl_functions();
+
     set_window_icon(ctx->window);
+    if (ctx->config.monitor >= 0) cover_monitor(ctx->window, ctx->config.monitor);
     
     // Set user pointer for callbacks
     glfwSetWindowUserPointer(ctx->window, ctx);
     glfwSetKeyCallback(ctx->window, key_callback);
     glfwSetScrollCallback(ctx->window, scroll_callback);
     
-    glfwMakeContextCurrent(ctx->window);
     glfwSetFramebufferSizeCallback(ctx->window, framebuffer_size_callback);
     
-    if (!load_gl_functions()) {
-        fprintf(stderr, "Failed to load OpenGL functions\n");
+    return load_gl_functions();
+}
+
+#ifdef RAVIZ_HAVE_EGL
+static void* egl_get_proc(const char *name) {
+    return (void*)eglGetProcAddress(name);
+}
+
+// Surfaceless EGL context: no window system at all, so headless renders
+// work on display-less servers (e.g. Mesa llvmpipe in CI).
+static int create_egl_context(RenderContext *ctx) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!get_platform_display) return 0;
+
+    ctx->egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (ctx->egl_display == EGL_NO_DISPLAY || !eglInitialize(ctx->egl_display, NULL, NULL)) {
+        ctx->egl_display = EGL_NO_DISPLAY;
+        return 0;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) return 0;
+
+    EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    ctx->egl_context = eglCreateContext(ctx->egl_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+    if (ctx->egl_context == EGL_NO_CONTEXT) return 0;
+    if (!eglMakeCurrent(ctx->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx->egl_context)) return 0;
+
+    log_info("Render", "Using surfaceless EGL context");
+    return load_gl_functions_from(egl_get_proc);
+}
+
+static void destroy_egl_context(RenderContext *ctx) {
+    if (ctx->egl_display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(ctx->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ctx->egl_context != EGL_NO_CONTEXT) eglDestroyContext(ctx->egl_display, ctx->egl_context);
+    eglTerminate(ctx->egl_display);
+    ctx->egl_display = EGL_NO_DISPLAY;
+    ctx->egl_context = EGL_NO_CONTEXT;
+}
+#endif
+
+static void destroy_context(RenderContext *ctx) {
+#ifdef RAVIZ_HAVE_EGL
+    destroy_egl_context(ctx);
+#endif
+    if (ctx->window) {
         glfwDestroyWindow(ctx->window);
+        ctx->window = NULL;
+    }
+    if (ctx->glfw_ready) {
         glfwTerminate();
-        free(ctx);
-        return NULL;
+        ctx->glfw_ready = 0;
     }
+}
+
+static int create_headless_context(RenderContext *ctx) {
+#ifdef RAVIZ_HAVE_EGL
+    if (create_egl_context(ctx)) return 1;
+    destroy_egl_context(ctx);
+    log_warn("Render", "Surfaceless EGL unavailable, using an invisible window.");
+#endif
+    return create_window_context(ctx);
+}
+
+// What every window has of its own: uniform ring, modulation state, attribute-less VAO,
+// resolution governor, pacer, GPU timers and fixed-function state
+static void init_window_state(RenderContext *ctx) {
+    ctx->frame_ring = uniform_ring_init(sizeof(FrameUniforms), ctx->config.gl_fast_path);
+    ctx->modulation = modulation_init(&ctx->config);
+    ctx->mod_out[MOD_TARGET_GLOW] = 1.0f;
+    glGenVertexArrays(1, &ctx->empty_vao);
+    ctx->lod_lat = ctx->lod_lon = 0;
+
+    ctx->governor = NULL;
+    create_governor(ctx);
+
+    ctx->pacer = NULL;
+    if (!ctx->headless) {
+        ctx->pacer = pacer_init(ctx->config.max_frames_ahead);
+    }
+
+    ctx->gpu_timing = ctx->config.perf_report != NULL;
+    if (ctx->gpu_timing) glGenQueries(2 * GPU_TIMER_RING, &ctx->gpu_queries[0][0]);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPointSize(4.0f); // Make points visible
+}
+
+RenderContext* render_init(const RavizConfig *config) {
+    RenderContext *ctx = calloc(1, sizeof(RenderContext));
+    if (!ctx) return NULL;
     
-    GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_source);
-    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fs_source);
-    
-    ctx->shader_program = glCreateProgram();
-    glAttachShader(ctx->shader_program, vs);
-    glAttachShader(ctx->shader_program, fs);
-    glLinkProgram(ctx->shader_program);
+    ctx->config = *config;
+    ctx->time = 0.0f;
+    ctx->dt = 0.0f;
+    ctx->particles = NULL;
+    ctx->wireframe_mode = 0;
+    ctx->headless = config->headless;
+#ifdef RAVIZ_HAVE_EGL
+    ctx->egl_display = EGL_NO_DISPLAY;
+    ctx->egl_context = EGL_NO_CONTEXT;
+#endif
+    for(int i=0; i<MAX_FFT_BINS; i++) ctx->fft_data[i] = 0.0f;
     
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    int ok = ctx->headless ? create_headless_context(ctx) : create_window_context(ctx);
+    if (!ok) {
+        log_error("Render", "Failed to create OpenGL context");
+        destroy_context(ctx);
+        free(ctx);
+        return NULL;
+    }
+
+    if (ctx->headless) {
+        if (!target_create(&ctx->output, config->output_width, config->output_height, GL_RGBA8, 1)) {
+            destroy_context(ctx);
+            free(ctx);
+            return NULL;
+        }
+        ctx->readback = readback_init(config->output_width, config->output_height, config->output_path);
+        if (!ctx->readback) {
+            target_destroy(&ctx->output);
+            destroy_context(ctx);
+            free(ctx);
+            return NULL;
+        }
+    }
     
-    ctx->u_time = glGetUniformLocation(ctx->shader_program, "time");
-    ctx->u_fft_data = glGetUniformLocation(ctx->shader_program, "fft_data");
-    ctx->u_model = glGetUniformLocation(ctx->shader_program, "model");
-    ctx->u_view = glGetUniformLocation(ctx->shader_program, "view");
-    ctx->u_projection = glGetUniformLocation(ctx->shader_program, "projection");
-    ctx->u_intensity = glGetUniformLocation(ctx->shader_program, "intensity");
-    ctx->u_color_mode = glGetUniformLocation(ctx->shader_program, "color_mode");
+    shader_set_dir(config->shader_dir);
+    program_cache_set_enabled(config->shader_cache);
+    ctx->shader_program = build_program_initial("sphere.vert", "sphere.frag", NULL, 0);
     
-    generate_sphere(config->sphere_lat, config->sphere_lon, &ctx->vao, &ctx->vbo, &ctx->ebo, &ctx->num_indices);
+    fetch_uniforms(ctx);
     
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glPointSize(4.0f); // Make points visible
+    ctx->vao = ctx->vbo = ctx->ebo = 0;
+    ctx->spring = NULL;
+    rebuild_sphere(ctx);
+    create_history_texture(ctx);
+    init_window_state(ctx);
+
+    // Live reload: rebuild programs whenever a shader file changes
+    ctx->shader_watch = NULL;
+    if (!ctx->headless) {
+        const char *dirs[SHADER_MAX_DIRS];
+        int num_dirs = shader_search_dirs(dirs, SHADER_MAX_DIRS);
+        if (num_dirs > 0) ctx->shader_watch = watch_init();
+        for (int i = 0; i < num_dirs; ++i) {
+            if (watch_add(ctx->shader_watch, dirs[i])) log_info("Render", "Watching shaders in %s", dirs[i]);
+        }
+    }
     
     return ctx;
 }
 
+RenderContext* render_init_shared(RenderContext *main, const RavizConfig *config) {
+    if (!main || main->headless || main->share || !main->window) return NULL;
+    RenderContext *ctx = calloc(1, sizeof(RenderContext));
+    if (!ctx) return NULL;
+
+    ctx->config = *config;
+    ctx->share = main;
+#ifdef RAVIZ_HAVE_EGL
+    ctx->egl_display = EGL_NO_DISPLAY;
+    ctx->egl_context = EGL_NO_CONTEXT;
+#endif
+    if (!create_window_context(ctx)) {
+        destroy_context(ctx);
+        free(ctx);
+        return NULL;
+    }
+
+    init_window_state(ctx);
+    ctx->shaders_seen = main->shader_epoch;
+    ctx->id = ++main->opened;
+    main->sharers++;
+    return ctx;
+}
+
 void render_update(RenderContext *ctx, const float *fft_bins, float dt) {
     if (!ctx) return; 
     
     ctx->time += dt;
+    ctx->dt = dt;
+    if (!ctx->has_pitch) ctx->hue = fmodf(ctx->time * 0.1f, 1.0f);
+
+    if (watch_poll(ctx->shader_watch)) reload_shaders(ctx);
+    if (ctx->shaders_seen != gl_owner(ctx)->shader_epoch) reload_scene_shaders(ctx);
     
+    // Only the shader upload is capped; bands and bin ranges need the
+    // whole spectrum to land on the right frequencies
     int bins = ctx->config.fft_bins;
     if (bins > MAX_FFT_BINS) bins = MAX_FFT_BINS;
     
     for (int i=0; i<bins; i++) {
         ctx->fft_data[i] = fft_bins[i];
     }
+
+    ModInputs in = {
+        fft_bins, ctx->config.fft_bins,
+        ctx->has_glow ? ctx->glow_level : -1.0f,
+        ctx->hue, ctx->key_strength, ctx->time
+    };
+    modulation_update(ctx->modulation, &in, dt, ctx->mod_out);
+    ctx->spin += ctx->mod_out[MOD_TARGET_ROTATION] * dt;
+}
+
+void render_push_history(RenderContext *ctx, const float *fft_bins) {
+    // Extra windows draw the main window's ring, which it fills
+    if (!ctx || ctx->share || !ctx->history_tex) return;
+
+    // One row per hop, written in place: upload cost is independent of history length
+    if (ctx->config.gl_fast_path && gl_caps.direct_state_access) {
+        glTextureSubImage2D(ctx->history_tex, 0, 0, ctx->history_row, ctx->history_bins, 1, GL_RED, GL_FLOAT, fft_bins);
+    } else {
+        glBindTexture(GL_TEXTURE_2D, ctx->history_tex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, ctx->history_row, ctx->history_bins, 1, GL_RED, GL_FLOAT, fft_bins);
+    }
+    ctx->history_row = (ctx->history_row + 1) % ctx->config.history_frames;
+}
+
+// The reactive hue with the routes to "hue" added
+static float frame_hue(const RenderContext *ctx) {
+    float hue = ctx->hue + ctx->mod_out[MOD_TARGET_HUE];
+    return hue - floorf(hue);
+}
+
+// One spring field serves every window. With extra windows open,
+// whichever draws it next advances it to the present, so it keeps
+// real time however many windows show it.
+static void step_spring(RenderContext *ctx, RenderContext *owner) {
+    float dt = ctx->dt;
+    if (owner->sharers > 0) {
+        long now = monotonic_ns();
+        if (owner->spring_ns) dt = (now - owner->spring_ns) / 1e9f;
+        if (dt > 0.1f) dt = 0.1f;
+        owner->spring_ns = now;
+    }
+    SpringParams params = {
+        ctx->config.spring_stiffness,
+        ctx->config.spring_damping,
+        ctx->config.spring_coupling
+    };
+    float intensity = ctx->config.intensity;
+    // The feedback VAOs are container objects of the owner's context; the
+    // buffers they write are shared, and a flush makes the result visible
+    // to the window drawing it
+    if (ctx != owner) make_current(owner);
+    spring_update(owner->spring, ctx->mod_out[MOD_TARGET_DISPLACEMENT] * intensity,
+                  ctx->mod_out[MOD_TARGET_NOISE] * intensity, ctx->time, dt, &params);
+    if (ctx != owner) {
+        glFlush();
+        make_current(ctx);
+    }
+}
+
+static void draw_sphere(RenderContext *ctx, mat4 model, mat4 view, mat4 projection, int height) {
+    RenderContext *owner = gl_owner(ctx);
+    int use_spring = owner->spring && ctx->config.deform == DEFORM_SPRING && ctx->config.scene == SCENE_SPHERE;
+    if (use_spring) step_spring(ctx, owner);
+
+    FrameUniforms frame;
+    glm_mat4_copy(model, frame.model);
+    glm_mat4_copy(view, frame.view);
+    glm_mat4_copy(projection, frame.projection);
+    memcpy(frame.fft, ctx->fft_data, sizeof(frame.fft));
+    frame.time = ctx->time;
+    frame.intensity = ctx->config.intensity;
+    frame.color_mode = ctx->config.color_mode;
+    frame.hue = frame_hue(ctx);
+    memset(frame.modulation, 0, sizeof(frame.modulation));
+    memcpy(frame.modulation, ctx->mod_out, sizeof(ctx->mod_out));
+    uniform_ring_upload(ctx->frame_ring, &frame, FRAME_BINDING);
+
+    glUseProgram(owner->shader_program);    
+    glUniform1i(owner->u_scene, ctx->config.scene);
+
+    // Newest row is the one just before history_row; address its texel centre
+    int rows = owner->config.history_frames;
+    int newest = (owner->history_row + rows - 1) % rows;
+    glUniform1f(owner->u_history_offset, (newest + 0.5f) / (float)rows);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, owner->history_tex);
+    glUniform1i(owner->u_history, 0);
+
+    glUniform1i(owner->u_spring, use_spring);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, use_spring ? spring_state_texture(owner->spring) : 0);
+    glUniform1i(owner->u_deform_state, 1);
+    glActiveTexture(GL_TEXTURE0);
+    
+    // The main window only builds a mesh in mesh mode
+    if (ctx->config.sphere_mode == SPHERE_PROCEDURAL || !owner->num_indices) {
+        int lat, lon;
+        choose_lod(ctx, height, &lat, &lon);
+        if (lat != ctx->lod_lat || lon != ctx->lod_lon) {
+            ctx->lod_lat = lat;
+            ctx->lod_lon = lon;
+            log_info("Render", "LOD: %dx%d (%d triangles)", lat, lon, 2 * lat * lon);
+        }
+        glUniform1i(owner->u_procedural, 1);
+        glUniform2i(owner->u_grid, lat, lon);
+        glBindVertexArray(ctx->empty_vao);
+        glDrawArrays(GL_TRIANGLES, 0, lat * lon * 6);
+    } else {
+        glUniform1i(owner->u_procedural, 0);
+        if (ctx->share && ctx->mesh_seen != owner->mesh_epoch) bind_shared_mesh(ctx);
+        glBindVertexArray(ctx->vao);
+        glDrawElements(GL_TRIANGLES, owner->num_indices, owner->index_type, 0);
+    }
+    uniform_ring_fence(ctx->frame_ring);
+}
+
+static void draw_particles(RenderContext *ctx, mat4 model, mat4 view, mat4 projection, int width, int height) {
+    // Allocated on first use: at high counts the state buffers are large
+    if (!ctx->particles) {
+        ctx->particles = particles_init(ctx->config.particle_count);
+        if (!ctx->particles) {
+            log_warn("Render", "Particle field unavailable, falling back to sphere.");
+            ctx->config.scene = SCENE_SPHERE;
+            return;
+        }
+    }
+
+    particles_update(ctx->particles, ctx->fft_data, MAX_FFT_BINS, ctx->config.intensity, ctx->time, ctx->dt);
+    particles_draw(ctx->particles, (float*)model, (float*)view, (float*)projection,
+                   width, height, ctx->config.particle_size * ctx->pixel_scale, ctx->config.color_mode, frame_hue(ctx));
+}
+
+static void draw_scope(RenderContext *ctx, int width, int height) {
+    // Flat on screen: no rotation or projection, just the trace
+    scope_draw(ctx->scope, ctx->config.scope_xy, width, height, ctx->config.intensity,
+               ctx->config.color_mode, frame_hue(ctx));
+}
+
+// Sized for the largest scale so scale changes only move the viewport;
+// reallocated only when the output size or format changes.
+static int ensure_scene_target(RenderContext *ctx, int out_width, int out_height, GLenum format) {
+    float max_scale = ctx->governor ? ctx->config.render_scale_max : 1.0f;
+    int w = (int)ceilf(out_width * max_scale);
+    int h = (int)ceilf(out_height * max_scale);
+    if (ctx->scene.fbo && ctx->scene.width == w && ctx->scene.height == h && ctx->scene_format == format) return 1;
+    ctx->scene_format = format;
+    return target_create(&ctx->scene, w, h, format, 1);
+}
+
+static int bloom_enabled(RenderContext *ctx) {
+    if (!ctx->config.bloom) return 0;
+    // Created on first use so a disabled bloom costs nothing
+    if (!ctx->bloom) {
+        ctx->bloom = bloom_init(ctx->config.bloom_levels);
+        if (!ctx->bloom) {
+            log_warn("Render", "Bloom unavailable, disabling.");
+            ctx->config.bloom = false;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#define STATS_INTERVAL_NS 2000000000L
+
+// Fold a finished timestamp pair into the totals. Without 'wait' a pair
+// the GPU hasn't reached yet is left for later.
+static void collect_gpu_time(RenderContext *ctx, int slot, int wait) {
+    if (!ctx->gpu_pending[slot]) return;
+    if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(ctx->gpu_queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+    }
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(ctx->gpu_queries[slot][0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(ctx->gpu_queries[slot][1], GL_QUERY_RESULT, &end);
+    if (end > start) ctx->gpu_ms += (end - start) / 1e6;
+    ctx->gpu_frames++;
+    ctx->gpu_pending[slot] = 0;
+}
+
+long render_gpu_time(RenderContext *ctx, double *total_ms) {
+    *total_ms = 0.0;
+    if (!ctx || !ctx->gpu_timing) return 0;
+    make_current(ctx);
+    for (int i = 0; i < GPU_TIMER_RING; ++i) collect_gpu_time(ctx, i, 1);
+    *total_ms = ctx->gpu_ms;
+    return ctx->gpu_frames;
+}
+
+static void report_stats(RenderContext *ctx) {
+    long now = monotonic_ns();
+    ctx->stats_frames++;
+    if (ctx->stats_start_ns == 0) {
+        ctx->stats_start_ns = now;
+        ctx->stats_allocs = alloc_audit_count();
+    }
+    if (now - ctx->stats_start_ns < STATS_INTERVAL_NS) return;
+
+    float seconds = (now - ctx->stats_start_ns) / 1.0e9f;
+    PacerStats ps;
+    pacer_take_stats(ctx->pacer, &ps);
+    char line[256];
+    int n = 0;
+    if (ctx->share || ctx->sharers) n = snprintf(line, sizeof(line), "window %d | ", ctx->id + 1);
+    n += snprintf(line + n, sizeof(line) - n, "%.1f fps | audio->GPU done %.1f ms avg, %.1f ms max | %d frame(s) ahead",
+                     ctx->stats_frames / seconds, ps.latency_avg_ms, ps.latency_max_ms, ctx->config.max_frames_ahead);
+    if (ctx->governor) {
+        n += snprintf(line + n, sizeof(line) - n, " | GPU %.1f ms @ %.2fx",
+                      resolution_gpu_ms(ctx->governor), resolution_scale(ctx->governor));
+    }
+    // Process-wide, so audio thread and driver allocations show up too
+    unsigned long allocs = alloc_audit_count();
+    if (alloc_audit_available()) n += snprintf(line + n, sizeof(line) - n, " | %lu allocs", allocs - ctx->stats_allocs);
+    if (ctx->has_pitch && ctx->key >= 0) {
+        snprintf(line + n, sizeof(line) - n, " | key %s (%.2f)", fft_key_name(ctx->key), ctx->key_strength);
+    }
+    log_info("Stats", "%s", line);
+
+    ctx->stats_start_ns = now;
+    ctx->stats_frames = 0;
+    ctx->stats_allocs = allocs;
+}
+
+void render_begin_frame(RenderContext *ctx) {
+    if (!ctx) return;
+    make_current(ctx);
+    pacer_wait(ctx->pacer);
+}
+
+void render_set_input_time(RenderContext *ctx, long capture_ns) {
+    if (ctx) ctx->input_ns = capture_ns;
+}
+
+void render_mark_frame(RenderContext *ctx) {
+    if (!ctx) return;
+    ctx->mark_next = 1;
+    ctx->marked_submitted = 0;
+    ctx->marked_shown = 0;
+    if (ctx->headless) readback_mark(ctx->readback);
+}
+
+int render_marked_frame(RenderContext *ctx, long *submitted, long *shown) {
+    if (!ctx || !ctx->marked_submitted) return 0;
+    *submitted = ctx->marked_submitted;
+    *shown = ctx->headless ? readback_marked_written(ctx->readback) : ctx->marked_shown;
+    return *shown != 0;
+}
+
+void render_set_bins(RenderContext *ctx, int bins) {
+    if (!ctx) return;
+    if (ctx->share) {
+        // The main window resizes the ring they share
+        ctx->config.fft_bins = bins;
+        return;
+    }
+    // history_bins may be clamped below fft_bins: compare the request
+    if (bins == ctx->config.fft_bins) return;
+    ctx->config.fft_bins = bins;
+    rebuild_history(ctx);
+}
+
+void render_set_pitch(RenderContext *ctx, float hue, int key, float key_strength) {
+    if (!ctx) return;
+    ctx->hue = hue;
+    ctx->key = key;
+    ctx->key_strength = key_strength;
+    ctx->has_pitch = 1;
+}
+
+void render_set_glow(RenderContext *ctx, float level) {
+    if (!ctx) return;
+    ctx->glow_level = level;
+    ctx->has_glow = level >= 0.0f;
+}
+
+void render_set_scope(RenderContext *ctx, const int16_t *frames, int count) {
+    if (!ctx || ctx->config.scene != SCENE_SCOPE) return;
+    // Always sized for the largest window, so scope_samples can change freely
+    if (!ctx->scope) {
+        ctx->scope = scope_init(SCOPE_MAX_FRAMES);
+        if (!ctx->scope) {
+            log_warn("Render", "Oscilloscope unavailable, falling back to sphere.");
+            ctx->config.scene = SCENE_SPHERE;
+            return;
+        }
+    }
+    scope_upload(ctx->scope, frames, count);
+}
+
+void render_apply_config(RenderContext *ctx, const RavizConfig *old, const RavizConfig *cfg) {
+    if (!ctx) return;
+    make_current(ctx);
+    RavizConfig *cur = &ctx->config;
+
+    // Only keys the file actually changed are taken over, so runtime
+    // toggles (F1-F6, arrows, scroll) survive unrelated edits
+#define TAKE(field) if (old->field != cfg->field) cur->field = cfg->field
+    TAKE(fps);
+    TAKE(sphere_scale);
+    TAKE(lod_triangle_budget);
+    TAKE(deform);
+    TAKE(spring_stiffness);
+    TAKE(spring_damping);
+    TAKE(spring_coupling);
+    TAKE(color_mode);
+    TAKE(scene);
+    TAKE(particle_size);
+    TAKE(scope_xy);
+    TAKE(intensity);
+    TAKE(rotation_speed);
+    TAKE(window_opacity);
+    TAKE(bloom);
+    TAKE(bloom_intensity);
+    TAKE(bloom_threshold);
+    TAKE(show_fps);
+
+    if (old->num_mod_routes != cfg->num_mod_routes ||
+        memcmp(old->mod_routes, cfg->mod_routes, cfg->num_mod_routes * sizeof(ModRoute)) != 0 ||
+        old->fft_size != cfg->fft_size || old->audio_rate != cfg->audio_rate) {
+        cur->num_mod_routes = cfg->num_mod_routes;
+        memcpy(cur->mod_routes, cfg->mod_routes, sizeof(cur->mod_routes));
+        modulation_compile(ctx->modulation, cfg);
+        if (!ctx->share) log_info("Config", "Modulation: %d routes", cur->num_mod_routes);
+    }
+
+    int mesh = old->sphere_mode != cfg->sphere_mode ||
+               old->sphere_lat != cfg->sphere_lat || old->sphere_lon != cfg->sphere_lon;
+    TAKE(sphere_mode);
+    TAKE(sphere_lat);
+    TAKE(sphere_lon);
+    // Extra windows draw the main window's mesh and history
+    if (mesh && !ctx->share) {
+        rebuild_sphere(ctx);
+        log_info("Config", "Sphere rebuilt (%s, %dx%d)",
+               cur->sphere_mode == SPHERE_MESH ? "mesh" : "procedural", cur->sphere_lat, cur->sphere_lon);
+    }
+
+    if (old->history_frames != cfg->history_frames) {
+        cur->history_frames = cfg->history_frames;
+        if (!ctx->share) rebuild_history(ctx);
+    }
+
+    if (old->particle_count != cfg->particle_count) {
+        cur->particle_count = cfg->particle_count;
+        // Replaced only once the new field exists; otherwise created lazily
+        if (ctx->particles) {
+            ParticleSystem *ps = particles_init(cur->particle_count);
+            if (ps) {
+                particles_cleanup(ctx->particles);
+                ctx->particles = ps;
+            }
+        }
+    }
+
+    if (old->bloom_levels != cfg->bloom_levels) {
+        cur->bloom_levels = cfg->bloom_levels;
+        if (ctx->bloom) {
+            Bloom *bloom = bloom_init(cur->bloom_levels);
+            if (bloom) {
+                bloom_cleanup(ctx->bloom);
+                ctx->bloom = bloom;
+            }
+        }
+    }
+
+    if (old->adaptive_resolution != cfg->adaptive_resolution || old->fps != cfg->fps ||
+        old->render_scale_min != cfg->render_scale_min || old->render_scale_max != cfg->render_scale_max) {
+        TAKE(adaptive_resolution);
+        TAKE(render_scale_min);
+        TAKE(render_scale_max);
+        create_governor(ctx);
+    }
+
+    if (old->max_frames_ahead != cfg->max_frames_ahead && ctx->pacer) {
+        cur->max_frames_ahead = cfg->max_frames_ahead;
+        FramePacer *pacer = pacer_init(cur->max_frames_ahead);
+        if (pacer) {
+            pacer_cleanup(ctx->pacer);
+            ctx->pacer = pacer;
+        }
+    }
+#undef TAKE
+
+    if (old->gl_fast_path != cfg->gl_fast_path || old->shader_cache != cfg->shader_cache ||
+        config_str_changed(old->shader_dir, cfg->shader_dir)) {
+        log_info("Config", "gl_fast_path, shader_cache and shader_dir take effect after a restart");
+    }
 }
 
 void render_draw(RenderContext *ctx) {
-    if (!ctx || !ctx->window) return;
+    if (!ctx || (!ctx->window && !ctx->headless)) return;
+    make_current(ctx);
+    
+    // Final destination: the headless output target or the window
+    GLuint out_fbo = 0;
+    int out_width, out_height;
+    if (ctx->headless) {
+        out_fbo = ctx->output.fbo;
+        out_width = ctx->output.width;
+        out_height = ctx->output.height;
+    } else {
+        glfwGetFramebufferSize(ctx->window, &out_width, &out_height);
+        resolution_begin_frame(ctx->governor);
+    }
+
+    int gpu_slot = ctx->gpu_head;
+    if (ctx->gpu_timing) {
+        // The ring is deep enough that this slot has normally finished
+        for (int i = 0; i < GPU_TIMER_RING; ++i) collect_gpu_time(ctx, i, 0);
+        collect_gpu_time(ctx, gpu_slot, 1);
+        glQueryCounter(ctx->gpu_queries[gpu_slot][0], GL_TIMESTAMP);
+    }
+
+    // The scene goes offscreen when it is scaled or post-processed
+    float scale = resolution_scale(ctx->governor);
+    int bloom = bloom_enabled(ctx);
+    int offscreen = 0;
+    if ((scale != 1.0f || bloom) && out_width > 0 && out_height > 0) {
+        offscreen = ensure_scene_target(ctx, out_width, out_height, bloom ? GL_RGBA16F : GL_RGBA8);
+    }
+
+    int width = out_width, height = out_height;
+    ctx->pixel_scale = 1.0f;
+    if (offscreen) {
+        width = (int)(out_width * scale + 0.5f);
+        height = (int)(out_height * scale + 0.5f);
+        if (width < 1) width = 1;
+        if (height < 1) height = 1;
+        ctx->pixel_scale = scale;
+        glBindFramebuffer(GL_FRAMEBUFFER, ctx->scene.fbo);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, out_fbo);
+    }
+    glViewport(0, 0, width, height);
     
     glClearColor(0.0f, 0.0f, 0.0f, ctx->config.window_opacity); 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    glUseProgram(ctx->shader_program);    
-    glUniform1f(ctx->u_time, ctx->time);
-    glUniform1fv(ctx->u_fft_data, MAX_FFT_BINS, ctx->fft_data);
-    glUniform1f(ctx->u_intensity, ctx->config.intensity);
-    glUniform1i(ctx->u_color_mode, ctx->config.color_mode);
-    
-    int width, height;
-    glfwGetFramebufferSize(ctx->window, &width, &height);
     float aspect = (float)width / (float)height;
     
     mat4 model, view, projection;
@@ -438,27 +1210,103 @@ void render_draw(RenderContext *ctx) {
     glm_mat4_identity(view);
     glm_mat4_identity(projection);
     
-    glm_rotate(model, ctx->time * ctx->config.rotation_speed, (vec3){0.0f, 1.0f, 0.0f});
-    glm_scale(model, (vec3){ctx->config.sphere_scale, ctx->config.sphere_scale, ctx->config.sphere_scale});
+    float size = ctx->config.sphere_scale + ctx->mod_out[MOD_TARGET_SCALE];
+    glm_rotate(model, ctx->time * ctx->config.rotation_speed + ctx->spin, (vec3){0.0f, 1.0f, 0.0f});
+    glm_scale(model, (vec3){size, size, size});
     glm_translate(view, (vec3){0.0f, 0.0f, -3.0f});
     glm_perspective(glm_rad(45.0f), aspect, 0.1f, 100.0f, projection);
     
-    glUniformMatrix4fv(ctx->u_model, 1, GL_FALSE, (float*)model);
-    glUniformMatrix4fv(ctx->u_view, 1, GL_FALSE, (float*)view);
-    glUniformMatrix4fv(ctx->u_projection, 1, GL_FALSE, (float*)projection);
-    
-    glBindVertexArray(ctx->vao);
-    glDrawElements(GL_TRIANGLES, ctx->num_indices, GL_UNSIGNED_INT, 0);
+    if (ctx->config.scene == SCENE_PARTICLES) {
+        draw_particles(ctx, model, view, projection, width, height);
+    } else if (ctx->config.scene == SCENE_SCOPE) {
+        draw_scope(ctx, width, height);
+    } else {
+        draw_sphere(ctx, model, view, projection, height);
+    }
     
+    if (bloom && offscreen) {
+        BloomParams params;
+        params.threshold = ctx->config.bloom_threshold;
+        params.knee = ctx->config.bloom_threshold * 0.5f;
+        // Scaled by the routes to "glow" (by default louder passages glow harder)
+        params.intensity = ctx->config.bloom_intensity * ctx->mod_out[MOD_TARGET_GLOW];
+        bloom_apply(ctx->bloom, ctx->scene.color, width, height, ctx->scene.width, ctx->scene.height,
+                    out_fbo, out_width, out_height, &params);
+    } else if (offscreen) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx->scene.fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, out_fbo);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, out_width, out_height,
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Readback and presentation are left out: this is the frame's own work
+    if (ctx->gpu_timing) {
+        glQueryCounter(ctx->gpu_queries[gpu_slot][1], GL_TIMESTAMP);
+        ctx->gpu_pending[gpu_slot] = 1;
+        ctx->gpu_head = (gpu_slot + 1) % GPU_TIMER_RING;
+    }
+
+    if (ctx->headless) {
+        if (!readback_capture(ctx->readback, ctx->output.fbo)) ctx->output_failed = 1;
+        if (ctx->mark_next) {
+            ctx->marked_submitted = monotonic_ns();
+            ctx->mark_next = 0;
+        }
+        return;
+    }
+
+    resolution_end_frame(ctx->governor);
+
     glfwSwapBuffers(ctx->window);
+    pacer_submit(ctx->pacer, ctx->input_ns);
+    if (ctx->mark_next) {
+        ctx->marked_submitted = monotonic_ns();
+        ctx->marked_shown = pacer_finish(ctx->pacer);
+        ctx->mark_next = 0;
+    }
     glfwPollEvents();
+
+    if (ctx->config.show_fps) report_stats(ctx);
 }
 
 int render_should_close(RenderContext *ctx) {
-    if (!ctx || !ctx->window) return 1;
+    if (!ctx) return 1;
+    if (ctx->headless) return ctx->output_failed;
+    if (!ctx->window) return 1;
     return glfwWindowShouldClose(ctx->window);
 }
 
+// GLFW's native accessors are looked up at run time, so the build needs
+// neither the X11 nor the Wayland headers and works with a GLFW built for
+// either platform (or, from 3.4, both).
+#define GLFW_PLATFORM_WAYLAND_ID 0x00060003
+#define GLFW_PLATFORM_X11_ID     0x00060004
+
+int render_event_fd(RenderContext *ctx) {
+    if (!ctx || ctx->headless || !ctx->window) return -1;
+    int (*get_platform)(void) = (int (*)(void))dlsym(RTLD_DEFAULT, "glfwGetPlatform");
+    int platform = get_platform ? get_platform() : 0;
+
+    void *(*wl_display)(void) = (void *(*)(void))dlsym(RTLD_DEFAULT, "glfwGetWaylandDisplay");
+    int (*wl_fd)(void*) = (int (*)(void*))dlsym(RTLD_DEFAULT, "wl_display_get_fd");
+    if (wl_display && wl_fd && (platform == 0 || platform == GLFW_PLATFORM_WAYLAND_ID)) {
+        void *display = wl_display();
+        if (display) return wl_fd(display);
+    }
+    void *(*x11_display)(void) = (void *(*)(void))dlsym(RTLD_DEFAULT, "glfwGetX11Display");
+    int (*x11_fd)(void*) = (int (*)(void*))dlsym(RTLD_DEFAULT, "XConnectionNumber");
+    if (x11_display && x11_fd && (platform == 0 || platform == GLFW_PLATFORM_X11_ID)) {
+        void *display = x11_display();
+        if (display) return x11_fd(display);
+    }
+    return -1;
+}
+
+void render_poll_events(RenderContext *ctx) {
+    if (ctx && ctx->window && !ctx->headless) glfwPollEvents();
+}
+
 void render_resize(RenderContext *ctx, int width, int height) {
     if (ctx && ctx->window) {
         glfwSetWindowSize(ctx->window, width, height);
@@ -467,15 +1315,37 @@ void render_resize(RenderContext *ctx, int width, int height) {
 
 void render_cleanup(RenderContext *ctx) {
     if (ctx) {
+        make_current(ctx);
+        particles_cleanup(ctx->particles);
+        scope_cleanup(ctx->scope);
         glDeleteVertexArrays(1, &ctx->vao);
-        glDeleteBuffers(1, &ctx->vbo);
-        glDeleteBuffers(1, &ctx->ebo);
-        glDeleteProgram(ctx->shader_program);
-        
-        if (ctx->window) {
-            glfwDestroyWindow(ctx->window);
+        glDeleteVertexArrays(1, &ctx->empty_vao);
+        if (ctx->share) {
+            ctx->share->sharers--;
+        } else {
+            spring_cleanup(ctx->spring);
+            glDeleteBuffers(1, &ctx->vbo);
+            glDeleteBuffers(1, &ctx->ebo);
+            glDeleteTextures(1, &ctx->history_tex);
+            glDeleteProgram(ctx->shader_program);
         }
-        glfwTerminate();
+        uniform_ring_cleanup(ctx->frame_ring);
+        modulation_cleanup(ctx->modulation);
+        if (ctx->gpu_timing) glDeleteQueries(2 * GPU_TIMER_RING, &ctx->gpu_queries[0][0]);
+        watch_cleanup(ctx->shader_watch);
+        resolution_cleanup(ctx->governor);
+        bloom_cleanup(ctx->bloom);
+        pacer_cleanup(ctx->pacer);
+        target_destroy(&ctx->scene);
+
+        if (ctx->readback) {
+            readback_flush(ctx->readback);
+            log_info("Render", "Wrote %ld frames", readback_frames_written(ctx->readback));
+            readback_cleanup(ctx->readback);
+        }
+        target_destroy(&ctx->output);
+        
+        destroy_context(ctx);
         free(ctx);
     }
 }
\ No newline at end of file
@@ -2,24 +2,95 @@
 #define RENDER_H
 
 #include "../utils/config.h"
+#include <stdint.h>
 
 typedef struct RenderContext RenderContext;
 
 // Initialize the renderer (Window, OpenGL, Shaders)
 RenderContext* render_init(const RavizConfig *config);
 
-// Update render state based on audio data
+// Another window on 'main' (a windowed render_init context) with its own
+// 'config' (see config_window). Its GL context shares the main window's
+// objects: it draws with the same sphere program, mesh, spring field and
+// history ring, and only adds its own targets, pacer and the scene extras
+// it uses (particles, scope, bloom). Pushing history to it does nothing;
+// the main window fills the ring. Clean it up before 'main'. NULL if the
+// window cannot be opened.
+RenderContext* render_init_shared(RenderContext *main, const RavizConfig *config);
+
+// Update render state based on audio data: 'fft_bins' holds the
+// config's fft_bins values (see render_set_bins)
 void render_update(RenderContext *ctx, const float *fft_bins, float dt);
 
+// Append one spectrum row (config->fft_bins values) to the history ring.
+// Call once per analysis hop.
+void render_push_history(RenderContext *ctx, const float *fft_bins);
+
 // Handle resize (called by GLFW callback usually, or manually)
 void render_resize(RenderContext *ctx, int width, int height);
 
+// Throttle: block until at most config->max_frames_ahead frames are queued
+// on the GPU. Call right before sampling the input for the next frame.
+void render_begin_frame(RenderContext *ctx);
+
+// CLOCK_MONOTONIC capture time (ns) of the spectrum about to be drawn,
+// used for the audio-to-GPU latency in the stats output.
+void render_set_input_time(RenderContext *ctx, long capture_ns);
+
+// --latency-test: time the next frame drawn. Once it is out,
+// render_marked_frame returns 1 with when it was submitted (SwapBuffers
+// returned, or the readback was queued) and when it finished on the GPU
+// (windowed; that one frame is waited for right after the swap) or was
+// written out (headless).
+void render_mark_frame(RenderContext *ctx);
+int render_marked_frame(RenderContext *ctx, long *submitted, long *shown);
+
+// The analysis now produces 'bins' values per hop (fft_bins changed at
+// runtime). Resizes the history ring; call before pushing such a row.
+void render_set_bins(RenderContext *ctx, int bins);
+
+// Harmony of the spectrum about to be drawn: 'hue' (0-1) is the current
+// pitch class and replaces the time-based hue of the reactive colour mode;
+// 'key' (see fft_key_name) shows up in the stats output. Without it the
+// hue drifts with time.
+void render_set_pitch(RenderContext *ctx, float hue, int key, float key_strength);
+
+// Level (a spectrum's mean) the modulation routes read as "loudness" in
+// place of the drawn spectrum's own, e.g. from a source routed to glow
+// (by default loudness drives the bloom). A negative level hands it back
+// to the drawn spectrum.
+void render_set_glow(RenderContext *ctx, float level);
+
+// Oscilloscope scene: the window to draw, 'count' interleaved stereo
+// frames (at most SCOPE_MAX_FRAMES). Ignored in the other scenes.
+void render_set_scope(RenderContext *ctx, const int16_t *frames, int count);
+
+// Apply a reloaded config. 'old' is the previously loaded config and 'cfg'
+// the new one; only settings that differ between them are taken over.
+// Meshes, history, particles and bloom chains are rebuilt as needed, each
+// replacement created before the old one is released. Audio settings are
+// left to the caller.
+void render_apply_config(RenderContext *ctx, const RavizConfig *old, const RavizConfig *cfg);
+
 // Draw the frame
 void render_draw(RenderContext *ctx);
 
+// GPU time of the frames drawn so far with config->perf_report set: waits
+// for outstanding measurements, stores the total in '*total_ms' and returns
+// the number of frames it covers (0 when not measuring).
+long render_gpu_time(RenderContext *ctx, double *total_ms);
+
 // Check if window should close
 int render_should_close(RenderContext *ctx);
 
+// The window system connection (X11 or Wayland), readable when input is
+// waiting: lets --single-thread sleep in one poll. -1 when headless or
+// when GLFW does not expose it.
+int render_event_fd(RenderContext *ctx);
+
+// Handle pending window events between frames (render_draw does too)
+void render_poll_events(RenderContext *ctx);
+
 // Cleanup
 void render_cleanup(RenderContext *ctx);
 
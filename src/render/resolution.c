@@ -0,0 +1,126 @@
+#include "resolution.h"
+#include "../utils/log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUERY_RING 4
+
+// Hysteresis band as a fraction of the frame budget. Above HIGH the scale
+// drops right away; below LOW it creeps back up. In between nothing changes,
+// so a load sitting near the budget doesn't flip-flop.
+#define BAND_HIGH 0.90f
+#define BAND_LOW  0.65f
+#define STEP_UP   0.05f
+#define EMA_ALPHA 0.15f
+
+// Frames to wait after a change before judging again: long enough for the
+// new size's timings to come through the query ring and the average.
+#define COOLDOWN_FRAMES 12
+
+struct ResolutionGovernor {
+    GLuint queries[QUERY_RING];
+    int pending[QUERY_RING];
+    int head;
+
+    float min_scale;
+    float max_scale;
+    float scale;
+    float budget_ms;
+    float gpu_ms;       // Exponential moving average
+    int samples;
+    int cooldown;
+};
+
+ResolutionGovernor* resolution_init(float min_scale, float max_scale, int fps) {
+    ResolutionGovernor *rg = calloc(1, sizeof(ResolutionGovernor));
+    if (!rg) return NULL;
+
+    if (min_scale > max_scale) min_scale = max_scale;
+    rg->min_scale = min_scale;
+    rg->max_scale = max_scale;
+    rg->scale = max_scale;
+    rg->budget_ms = 1000.0f / (fps > 0 ? fps : 60);
+    rg->cooldown = COOLDOWN_FRAMES;
+
+    glGenQueries(QUERY_RING, rg->queries);
+    return rg;
+}
+
+static void adjust(ResolutionGovernor *rg) {
+    if (rg->cooldown > 0) {
+        rg->cooldown--;
+        return;
+    }
+
+    float load = rg->gpu_ms / rg->budget_ms;
+    float scale = rg->scale;
+    if (load > BAND_HIGH) {
+        // GPU time is roughly proportional to pixel count (scale squared):
+        // jump straight to the scale that lands in the middle of the band.
+        float target = 0.5f * (BAND_HIGH + BAND_LOW);
+        scale *= sqrtf(target / load);
+    } else if (load < BAND_LOW) {
+        scale += STEP_UP;
+    } else {
+        return;
+    }
+
+    if (scale < rg->min_scale) scale = rg->min_scale;
+    if (scale > rg->max_scale) scale = rg->max_scale;
+    if (fabsf(scale - rg->scale) < 0.01f) return;
+
+    log_info("Render", "Resolution scale %.2f -> %.2f (GPU %.1f ms of %.1f ms)",
+           rg->scale, scale, rg->gpu_ms, rg->budget_ms);
+    rg->scale = scale;
+    rg->cooldown = COOLDOWN_FRAMES;
+}
+
+void resolution_begin_frame(ResolutionGovernor *rg) {
+    if (!rg) return;
+
+    // Reuse the oldest slot; if its result still isn't back, skip timing
+    // this frame rather than block on it.
+    if (rg->pending[rg->head]) {
+        GLint available = 0;
+        glGetQueryObjectiv(rg->queries[rg->head], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(rg->queries[rg->head], GL_QUERY_RESULT, &ns);
+        rg->pending[rg->head] = 0;
+
+        // The first result includes warm-up (and is garbage on some drivers);
+        // clamping keeps one hitch from dominating the average.
+        if (rg->samples++ > 0) {
+            float ms = (float)ns / 1.0e6f;
+            if (ms > 4.0f * rg->budget_ms) ms = 4.0f * rg->budget_ms;
+            rg->gpu_ms = rg->gpu_ms > 0.0f ? rg->gpu_ms + EMA_ALPHA * (ms - rg->gpu_ms) : ms;
+            adjust(rg);
+        }
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, rg->queries[rg->head]);
+    rg->pending[rg->head] = 2; // Open
+}
+
+void resolution_end_frame(ResolutionGovernor *rg) {
+    if (!rg || rg->pending[rg->head] != 2) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    rg->pending[rg->head] = 1;
+    rg->head = (rg->head + 1) % QUERY_RING;
+}
+
+float resolution_scale(const ResolutionGovernor *rg) {
+    return rg ? rg->scale : 1.0f;
+}
+
+float resolution_gpu_ms(const ResolutionGovernor *rg) {
+    return rg ? rg->gpu_ms : 0.0f;
+}
+
+void resolution_cleanup(ResolutionGovernor *rg) {
+    if (rg) {
+        glDeleteQueries(QUERY_RING, rg->queries);
+        free(rg);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include "gl_loader.h"
+
+typedef struct ResolutionGovernor ResolutionGovernor;
+
+// Frame-time governor for dynamic resolution. GPU time per frame is measured
+// with a small ring of GL_TIME_ELAPSED queries (read back a few frames late,
+// so it never stalls) and the render scale is steered to keep it inside a
+// band below the frame budget of 1/fps.
+ResolutionGovernor* resolution_init(float min_scale, float max_scale, int fps);
+
+// Bracket all GPU work of a frame.
+void resolution_begin_frame(ResolutionGovernor *rg);
+void resolution_end_frame(ResolutionGovernor *rg);
+
+// Current scale factor applied to the framebuffer size.
+float resolution_scale(const ResolutionGovernor *rg);
+
+// Smoothed GPU frame time in milliseconds (0 until the first result).
+float resolution_gpu_ms(const ResolutionGovernor *rg);
+
+void resolution_cleanup(ResolutionGovernor *rg);
+
+#endif
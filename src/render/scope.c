@@ -0,0 +1,116 @@
+#include "scope.h"
+#include "shader.h"
+#include "../utils/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SCOPE_FRAME_BYTES (2 * sizeof(int16_t))
+
+struct ScopeView {
+    int max_frames;
+    int count;          // Frames in the current window
+
+    GLuint buffer;
+    GLuint texture;
+    GLuint vao;         // Empty: attribute-less draw
+    GLuint program;
+
+    GLint u_samples;
+    GLint u_count;
+    GLint u_xy;
+    GLint u_aspect;
+    GLint u_gain;
+    GLint u_color_mode;
+    GLint u_hue;
+};
+
+int scope_reload_shaders(ScopeView *sv) {
+    ProgramBuilder build = sv->program ? build_program_files : build_program_initial;
+    GLuint program = build("scope.vert", "scope.frag", NULL, 0);
+    if (!program) return 0;
+
+    if (sv->program) glDeleteProgram(sv->program);
+    sv->program = program;
+
+    sv->u_samples = glGetUniformLocation(program, "samples");
+    sv->u_count = glGetUniformLocation(program, "count");
+    sv->u_xy = glGetUniformLocation(program, "xy");
+    sv->u_aspect = glGetUniformLocation(program, "aspect");
+    sv->u_gain = glGetUniformLocation(program, "gain");
+    sv->u_color_mode = glGetUniformLocation(program, "color_mode");
+    sv->u_hue = glGetUniformLocation(program, "hue");
+    return 1;
+}
+
+ScopeView* scope_init(int max_frames) {
+    if (max_frames < 2) return NULL;
+    ScopeView *sv = calloc(1, sizeof(ScopeView));
+    if (!sv) return NULL;
+    sv->max_frames = max_frames;
+
+    if (!scope_reload_shaders(sv)) {
+        scope_cleanup(sv);
+        return NULL;
+    }
+
+    glGenBuffers(1, &sv->buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, sv->buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)max_frames * SCOPE_FRAME_BYTES, NULL, GL_STREAM_DRAW);
+    glGenTextures(1, &sv->texture);
+    glBindTexture(GL_TEXTURE_BUFFER, sv->texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG16I, sv->buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGenVertexArrays(1, &sv->vao);
+
+    log_info("Render", "Oscilloscope: up to %d frames per window", max_frames);
+    return sv;
+}
+
+void scope_upload(ScopeView *sv, const int16_t *frames, int count) {
+    if (!sv) return;
+    if (count > sv->max_frames) count = sv->max_frames;
+    sv->count = count;
+    if (count <= 0) return;
+
+    // Orphan, then fill: the driver hands out fresh storage if a draw is
+    // still reading the old window. The texture follows the buffer name.
+    GLsizeiptr size = (GLsizeiptr)sv->max_frames * SCOPE_FRAME_BYTES;
+    glBindBuffer(GL_TEXTURE_BUFFER, sv->buffer);
+    glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)count * SCOPE_FRAME_BYTES, frames);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void scope_draw(ScopeView *sv, int xy, int width, int height, float gain, int color_mode, float hue) {
+    if (!sv || sv->count < 2) return;
+
+    glUseProgram(sv->program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, sv->texture);
+    glUniform1i(sv->u_samples, 0);
+    glUniform1i(sv->u_count, sv->count);
+    glUniform1i(sv->u_xy, xy);
+    glUniform1f(sv->u_aspect, height > 0 ? (float)width / (float)height : 1.0f);
+    glUniform1f(sv->u_gain, gain);
+    glUniform1i(sv->u_color_mode, color_mode);
+    glUniform1f(sv->u_hue, hue);
+
+    // A flat trace: no depth test, drawn over the cleared frame
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(sv->vao);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, sv->count, xy ? 1 : 2);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void scope_cleanup(ScopeView *sv) {
+    if (sv) {
+        glDeleteVertexArrays(1, &sv->vao);
+        glDeleteTextures(1, &sv->texture);
+        glDeleteBuffers(1, &sv->buffer);
+        if (sv->program) glDeleteProgram(sv->program);
+        free(sv);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef SCOPE_H
+#define SCOPE_H
+
+#include "gl_loader.h"
+#include <stdint.h>
+
+typedef struct ScopeView ScopeView;
+
+// GPU side of the oscilloscope scene: a buffer texture of up to
+// 'max_frames' stereo int16 frames (RG16I), drawn as line strips whose
+// vertices are fetched from it by gl_VertexID. No vertex buffer exists.
+ScopeView* scope_init(int max_frames);
+
+// Replace the displayed window with 'count' interleaved stereo frames.
+// The buffer is orphaned first, so this never waits on a draw still
+// reading the previous window.
+void scope_upload(ScopeView *sv, const int16_t *frames, int count);
+
+// Draw the last uploaded window: one trace per channel, or a single
+// left-vs-right Lissajous trace when 'xy' is set.
+void scope_draw(ScopeView *sv, int xy, int width, int height, float gain, int color_mode, float hue);
+
+// Rebuild the program from the shader files. Keeps the old program and
+// returns 0 if it fails to build.
+int scope_reload_shaders(ScopeView *sv);
+
+void scope_cleanup(ScopeView *sv);
+
+#endif
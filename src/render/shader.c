@@ -0,0 +1,189 @@
+#include "shader.h"
+#include "program_cache.h"
+#include "../utils/log.h"
+#include "shaders_embedded.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static char user_dir[512];
+static char config_dir[512];
+
+GLuint compile_shader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        log_error("Shader", "Compilation failed: %s", infoLog);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint build_program(const char *vs_source, const char *fs_source, const char *const *varyings, int num_varyings) {
+    // Key covers everything that affects the linked result
+    const char *parts[2 + 8];
+    int num_parts = 0;
+    parts[num_parts++] = vs_source;
+    parts[num_parts++] = fs_source;
+    for (int i = 0; i < num_varyings && i < 8; ++i) parts[num_parts++] = varyings[i];
+    uint64_t key = program_cache_key(parts, num_parts);
+
+    GLuint program = program_cache_load(key);
+    if (program) return program;
+
+    GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_source);
+    if (!vs) return 0;
+
+    GLuint fs = 0;
+    if (fs_source) {
+        fs = compile_shader(GL_FRAGMENT_SHADER, fs_source);
+        if (!fs) { glDeleteShader(vs); return 0; }
+    }
+    
+    program = glCreateProgram();
+    glAttachShader(program, vs);
+    if (fs) glAttachShader(program, fs);
+    if (varyings && num_varyings > 0) {
+        glTransformFeedbackVaryings(program, num_varyings, varyings, GL_INTERLEAVED_ATTRIBS);
+    }
+    program_cache_prepare(program);
+    glLinkProgram(program);
+
+    glDeleteShader(vs);
+    if (fs) glDeleteShader(fs);
+    
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        log_error("Shader", "Program linking failed: %s", infoLog);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    program_cache_store(key, program);
+    return program;
+}
+
+void shader_set_dir(const char *dir) {
+    snprintf(config_dir, sizeof(config_dir), "%s", dir ? dir : "");
+}
+
+static int is_dir(const char *path) {
+    struct stat st;
+    return path[0] && stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+int shader_search_dirs(const char **dirs, int max) {
+    const char *home = getenv("HOME");
+    if (home) snprintf(user_dir, sizeof(user_dir), "%s/.config/raviz/shaders", home);
+
+    const char *candidates[SHADER_MAX_DIRS] = {
+        config_dir,
+        user_dir,
+#ifdef RAVIZ_SHADER_DIR
+        RAVIZ_SHADER_DIR,
+#else
+        "",
+#endif
+    };
+
+    int count = 0;
+    for (int i = 0; i < SHADER_MAX_DIRS && count < max; ++i) {
+        if (is_dir(candidates[i])) dirs[count++] = candidates[i];
+    }
+    return count;
+}
+
+static char* read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *text = size >= 0 ? malloc(size + 1) : NULL;
+    if (text && fread(text, 1, size, f) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text) text[size] = '\0';
+    fclose(f);
+    return text;
+}
+
+static const char* embedded_source(const char *name) {
+    for (size_t i = 0; i < sizeof(embedded_shaders) / sizeof(embedded_shaders[0]); ++i) {
+        if (strcmp(embedded_shaders[i].name, name) == 0) return embedded_shaders[i].source;
+    }
+    return NULL;
+}
+
+// 'overridden' is set if the source came from a search directory
+static char* load_source(const char *name, int *overridden) {
+    const char *dirs[SHADER_MAX_DIRS];
+    int num_dirs = shader_search_dirs(dirs, SHADER_MAX_DIRS);
+    for (int i = 0; i < num_dirs; ++i) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dirs[i], name);
+        char *text = read_file(path);
+        if (text) {
+            *overridden = 1;
+            return text;
+        }
+    }
+
+    const char *embedded = embedded_source(name);
+    if (embedded) return strdup(embedded);
+
+    log_error("Shader", "%s not found", name);
+    return NULL;
+}
+
+char* shader_load_source(const char *name) {
+    int overridden = 0;
+    return load_source(name, &overridden);
+}
+
+static GLuint build_from(const char *vs_name, const char *fs_name, const char *const *varyings, int num_varyings,
+                         int *overridden) {
+    char *vs = load_source(vs_name, overridden);
+    char *fs = fs_name ? load_source(fs_name, overridden) : NULL;
+
+    GLuint program = 0;
+    if (vs && (fs || !fs_name)) {
+        program = build_program(vs, fs, varyings, num_varyings);
+    }
+
+    free(vs);
+    free(fs);
+    return program;
+}
+
+GLuint build_program_files(const char *vs_name, const char *fs_name, const char *const *varyings, int num_varyings) {
+    int overridden = 0;
+    return build_from(vs_name, fs_name, varyings, num_varyings, &overridden);
+}
+
+GLuint build_program_initial(const char *vs_name, const char *fs_name, const char *const *varyings, int num_varyings) {
+    int overridden = 0;
+    GLuint program = build_from(vs_name, fs_name, varyings, num_varyings, &overridden);
+    if (program || !overridden) return program;
+
+    const char *vs = embedded_source(vs_name);
+    const char *fs = fs_name ? embedded_source(fs_name) : NULL;
+    if (!vs || (fs_name && !fs)) return 0;
+    log_warn("Shader", "Override of %s%s%s does not build, using the built-in copy",
+             vs_name, fs_name ? "/" : "", fs_name ? fs_name : "");
+    return build_program(vs, fs, varyings, num_varyings);
+}
@@ -0,0 +1,39 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include "gl_loader.h"
+
+#define SHADER_MAX_DIRS 3
+
+// Compile a single shader stage. Returns 0 (and logs) on failure.
+GLuint compile_shader(GLenum type, const char *source);
+
+// Compile and link a program. 'fs_source' may be NULL for transform-feedback
+// only programs. 'varyings' (may be NULL) are captured interleaved.
+// Linked programs are restored from / saved to the program binary cache.
+// Returns 0 (and logs) on failure.
+GLuint build_program(const char *vs_source, const char *fs_source, const char *const *varyings, int num_varyings);
+
+// Shader files are looked up by name (e.g. "sphere.vert") in: the directory
+// given here (config shader_dir), ~/.config/raviz/shaders, then the install
+// directory. The copy embedded at build time is used if none has the file.
+void shader_set_dir(const char *dir);
+
+// Existing search directories, highest priority first. Returns the count.
+int shader_search_dirs(const char **dirs, int max);
+
+// Load a shader source by name. Returns a malloc'd string or NULL.
+char* shader_load_source(const char *name);
+
+// build_program() on sources loaded with shader_load_source().
+GLuint build_program_files(const char *vs_name, const char *fs_name, const char *const *varyings, int num_varyings);
+
+// build_program_files() for a first build, with no earlier program to keep
+// on failure: if an override does not build, the embedded copies are used.
+GLuint build_program_initial(const char *vs_name, const char *fs_name, const char *const *varyings, int num_varyings);
+
+// Either of the above: reload paths pick build_program_initial while they
+// have no program yet
+typedef GLuint (*ProgramBuilder)(const char *vs_name, const char *fs_name, const char *const *varyings, int num_varyings);
+
+#endif
@@ -0,0 +1,149 @@
+#include "spring.h"
+#include "shader.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Fixed integration step. Slow frames run as many substeps as they are
+// behind; only a stall longer than SPRING_MAX_LAG drops simulated time,
+// so the catch-up can't spiral.
+#define SPRING_STEP (1.0f / 240.0f)
+#define SPRING_MAX_LAG 0.1f
+
+struct SpringField {
+    int num_vertices;
+    int lat, lon;
+    int current;        // Buffer holding the latest state
+    float accumulator;  // Wall time not yet simulated
+
+    GLuint state[2];    // vec2 per vertex: displacement, velocity
+    GLuint state_tex[2];
+    GLuint vao[2];
+
+    GLuint program;
+    GLint u_displacement;
+    GLint u_ripple;
+    GLint u_time;
+    GLint u_step;
+    GLint u_grid;
+    GLint u_prev_state;
+    GLint u_stiffness;
+    GLint u_damping;
+    GLint u_coupling;
+};
+
+int spring_reload_shaders(SpringField *sf) {
+    static const char *varyings[] = { "out_state" };
+    ProgramBuilder build = sf->program ? build_program_files : build_program_initial;
+    GLuint program = build("spring.vert", NULL, varyings, 1);
+    if (!program) return 0;
+
+    if (sf->program) glDeleteProgram(sf->program);
+    sf->program = program;
+
+    sf->u_displacement = glGetUniformLocation(sf->program, "displacement");
+    sf->u_ripple = glGetUniformLocation(sf->program, "ripple");
+    sf->u_time = glGetUniformLocation(sf->program, "time");
+    sf->u_step = glGetUniformLocation(sf->program, "step");
+    sf->u_grid = glGetUniformLocation(sf->program, "grid");
+    sf->u_prev_state = glGetUniformLocation(sf->program, "prev_state");
+    sf->u_stiffness = glGetUniformLocation(sf->program, "stiffness");
+    sf->u_damping = glGetUniformLocation(sf->program, "damping");
+    sf->u_coupling = glGetUniformLocation(sf->program, "coupling");
+    return 1;
+}
+
+SpringField* spring_init(GLuint mesh_vbo, int lat_segments, int lon_segments) {
+    SpringField *sf = calloc(1, sizeof(SpringField));
+    if (!sf) return NULL;
+
+    sf->lat = lat_segments;
+    sf->lon = lon_segments;
+    sf->num_vertices = (lat_segments + 1) * (lon_segments + 1);
+
+    if (!spring_reload_shaders(sf)) {
+        free(sf);
+        return NULL;
+    }
+
+    float *zeros = calloc((size_t)sf->num_vertices * 2, sizeof(float));
+
+    glGenBuffers(2, sf->state);
+    glGenTextures(2, sf->state_tex);
+    glGenVertexArrays(2, sf->vao);
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, sf->state[i]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)sf->num_vertices * 2 * sizeof(float), zeros, GL_DYNAMIC_COPY);
+
+        glBindTexture(GL_TEXTURE_BUFFER, sf->state_tex[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, sf->state[i]);
+
+        glBindVertexArray(sf->vao[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, sf->state[i]);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    free(zeros);
+
+    return sf;
+}
+
+void spring_update(SpringField *sf, float displacement, float ripple,
+                   float time, float dt, const SpringParams *params) {
+    if (!sf) return;
+
+    sf->accumulator += dt;
+    if (sf->accumulator > SPRING_MAX_LAG) sf->accumulator = SPRING_MAX_LAG;
+    int steps = (int)(sf->accumulator / SPRING_STEP);
+    sf->accumulator -= steps * SPRING_STEP;
+    if (steps == 0) return;
+
+    glUseProgram(sf->program);
+    glUniform1f(sf->u_displacement, displacement);
+    glUniform1f(sf->u_ripple, ripple);
+    glUniform1f(sf->u_step, SPRING_STEP);
+    glUniform2i(sf->u_grid, sf->lat, sf->lon);
+    glUniform1f(sf->u_stiffness, params->stiffness);
+    glUniform1f(sf->u_damping, params->damping);
+    glUniform1f(sf->u_coupling, params->coupling);
+    glUniform1i(sf->u_prev_state, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    for (int i = 0; i < steps; ++i) {
+        int src = sf->current;
+        int dst = 1 - src;
+
+        glUniform1f(sf->u_time, time - (steps - 1 - i) * SPRING_STEP);
+        glBindTexture(GL_TEXTURE_BUFFER, sf->state_tex[src]);
+        glBindVertexArray(sf->vao[src]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, sf->state[dst]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, sf->num_vertices);
+        glEndTransformFeedback();
+
+        sf->current = dst;
+    }
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+GLuint spring_state_texture(SpringField *sf) {
+    return sf ? sf->state_tex[sf->current] : 0;
+}
+
+void spring_cleanup(SpringField *sf) {
+    if (sf) {
+        glDeleteVertexArrays(2, sf->vao);
+        glDeleteTextures(2, sf->state_tex);
+        glDeleteBuffers(2, sf->state);
+        if (sf->program) glDeleteProgram(sf->program);
+        free(sf);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef SPRING_H
+#define SPRING_H
+
+#include "gl_loader.h"
+
+typedef struct SpringField SpringField;
+
+typedef struct {
+    float stiffness;    // Pull toward the audio-driven target displacement
+    float damping;      // Velocity damping
+    float coupling;     // Neighbour coupling (wave speed squared)
+} SpringParams;
+
+// Per-vertex displacement/velocity state for a sphere mesh built by
+// generate_sphere() with the given segment counts. 'mesh_vbo' holds the
+// rest positions (3 floats per vertex).
+SpringField* spring_init(GLuint mesh_vbo, int lat_segments, int lon_segments);
+
+// Advance the field by 'dt' seconds of wall time using fixed substeps,
+// chasing 'displacement' plus a random ripple of amplitude 'ripple' (the
+// modulated values, intensity applied). Runs entirely on the GPU; nothing
+// is read back.
+void spring_update(SpringField *sf, float displacement, float ripple,
+                   float time, float dt, const SpringParams *params);
+
+// Buffer texture (RG32F: displacement, velocity) holding the latest state,
+// indexed by mesh vertex id.
+GLuint spring_state_texture(SpringField *sf);
+
+// Rebuild the update program from spring.vert. Keeps the old program and
+// returns 0 on failure.
+int spring_reload_shaders(SpringField *sf);
+
+void spring_cleanup(SpringField *sf);
+
+#endif
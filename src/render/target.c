@@ -0,0 +1,48 @@
+#include "target.h"
+#include "../utils/log.h"
+#include <stdio.h>
+
+int target_create(RenderTarget *t, int width, int height, GLenum color_format, int with_depth) {
+    target_destroy(t);
+
+    t->width = width;
+    t->height = height;
+
+    glGenTextures(1, &t->color);
+    glBindTexture(GL_TEXTURE_2D, t->color);
+    // Format/type are only used for the (NULL) upload; any valid pair works
+    glTexImage2D(GL_TEXTURE_2D, 0, color_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &t->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, t->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t->color, 0);
+
+    if (with_depth) {
+        glGenRenderbuffers(1, &t->depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, t->depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, t->depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        log_error("Render", "Offscreen target %dx%d incomplete (0x%x)", width, height, status);
+        target_destroy(t);
+        return 0;
+    }
+    return 1;
+}
+
+void target_destroy(RenderTarget *t) {
+    if (t->fbo) glDeleteFramebuffers(1, &t->fbo);
+    if (t->color) glDeleteTextures(1, &t->color);
+    if (t->depth) glDeleteRenderbuffers(1, &t->depth);
+    t->fbo = t->color = t->depth = 0;
+}
@@ -0,0 +1,21 @@
+#ifndef TARGET_H
+#define TARGET_H
+
+#include "gl_loader.h"
+
+// Offscreen framebuffer: one colour texture plus a depth renderbuffer.
+typedef struct {
+    GLuint fbo;
+    GLuint color;
+    GLuint depth;
+    int width;
+    int height;
+} RenderTarget;
+
+// Create (or recreate) 't' at the given size. 'color_format' is a sized
+// internal format such as GL_RGBA8. Returns 1 on success.
+int target_create(RenderTarget *t, int width, int height, GLenum color_format, int with_depth);
+
+void target_destroy(RenderTarget *t);
+
+#endif
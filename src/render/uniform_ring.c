@@ -0,0 +1,116 @@
+#include "uniform_ring.h"
+#include "../utils/log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct UniformRing {
+    GLuint buffer;
+    GLsizeiptr block_size;
+    GLsizeiptr stride;      // block_size rounded up to the offset alignment
+    unsigned char *mapped;  // NULL on the glBufferSubData path
+    GLsync fence[UNIFORM_RING_SLOTS];
+    int slot;               // Slot written by the last upload
+};
+
+static int create_persistent(UniformRing *ring) {
+    GLint align = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    if (align < 1) align = 256;
+    ring->stride = (ring->block_size + align - 1) / align * align;
+
+    GLsizeiptr size = ring->stride * UNIFORM_RING_SLOTS;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    if (gl_caps.direct_state_access) {
+        glCreateBuffers(1, &ring->buffer);
+        glNamedBufferStorage(ring->buffer, size, NULL, flags);
+        ring->mapped = glMapNamedBufferRange(ring->buffer, 0, size, flags);
+    } else {
+        glGenBuffers(1, &ring->buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+        glBufferStorage(GL_UNIFORM_BUFFER, size, NULL, flags);
+        ring->mapped = glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    if (!ring->mapped) {
+        glDeleteBuffers(1, &ring->buffer);
+        ring->buffer = 0;
+        return 0;
+    }
+    return 1;
+}
+
+static void create_fallback(UniformRing *ring) {
+    ring->stride = ring->block_size;
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+    glBufferData(GL_UNIFORM_BUFFER, ring->block_size, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRing* uniform_ring_init(GLsizeiptr block_size, int fast_path) {
+    UniformRing *ring = calloc(1, sizeof(UniformRing));
+    if (!ring) return NULL;
+    ring->block_size = block_size;
+    ring->slot = UNIFORM_RING_SLOTS - 1;
+
+    int persistent = fast_path && gl_caps.buffer_storage && create_persistent(ring);
+    if (!persistent) create_fallback(ring);
+
+    log_info("Render", "GL %d.%d, per-frame uniforms: %s", gl_caps.major, gl_caps.minor,
+           persistent ? (gl_caps.direct_state_access ? "persistent mapped ring (DSA)" : "persistent mapped ring")
+                      : "glBufferSubData");
+    return ring;
+}
+
+void uniform_ring_upload(UniformRing *ring, const void *data, GLuint binding) {
+    if (!ring) return;
+
+    if (!ring->mapped) {
+        // Orphan first so the driver can hand out fresh storage instead of
+        // stalling on the previous frame's reads
+        glBindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+        glBufferData(GL_UNIFORM_BUFFER, ring->block_size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, ring->block_size, data);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ring->buffer);
+        return;
+    }
+
+    int slot = (ring->slot + 1) % UNIFORM_RING_SLOTS;
+    if (ring->fence[slot]) {
+        // Normally long signalled: the frame pacer keeps fewer frames in
+        // flight than there are slots
+        glClientWaitSync(ring->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(ring->fence[slot]);
+        ring->fence[slot] = NULL;
+    }
+
+    GLintptr offset = ring->stride * slot;
+    memcpy(ring->mapped + offset, data, ring->block_size);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ring->buffer, offset, ring->block_size);
+    ring->slot = slot;
+}
+
+void uniform_ring_fence(UniformRing *ring) {
+    if (!ring || !ring->mapped) return;
+    int slot = ring->slot;
+    if (ring->fence[slot]) glDeleteSync(ring->fence[slot]);
+    ring->fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+int uniform_ring_persistent(const UniformRing *ring) {
+    return ring && ring->mapped != NULL;
+}
+
+void uniform_ring_cleanup(UniformRing *ring) {
+    if (ring) {
+        for (int i = 0; i < UNIFORM_RING_SLOTS; ++i) {
+            if (ring->fence[i]) glDeleteSync(ring->fence[i]);
+        }
+        // Persistent mappings are released with the buffer
+        glDeleteBuffers(1, &ring->buffer);
+        free(ring);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "gl_loader.h"
+
+#define UNIFORM_RING_SLOTS 3
+
+typedef struct UniformRing UniformRing;
+
+// Per-frame uniform block storage. With GL 4.4+/4.5 (or the ARB extensions)
+// and 'fast_path' set, a single immutable buffer holds UNIFORM_RING_SLOTS
+// copies of the block and stays persistently mapped: each frame writes the
+// next slot directly and binds it with glBindBufferRange, and a fence per
+// slot keeps the CPU from overwriting data the GPU has yet to read.
+// Otherwise the block lives in an ordinary buffer that is orphaned and
+// refilled with glBufferSubData every frame.
+UniformRing* uniform_ring_init(GLsizeiptr block_size, int fast_path);
+
+// Copy 'data' (block_size bytes) into the next slot and bind it to
+// uniform buffer binding point 'binding'.
+void uniform_ring_upload(UniformRing *ring, const void *data, GLuint binding);
+
+// Call after the draws that read the last upload have been issued.
+void uniform_ring_fence(UniformRing *ring);
+
+// Non-zero when the persistently mapped path is in use.
+int uniform_ring_persistent(const UniformRing *ring);
+
+void uniform_ring_cleanup(UniformRing *ring);
+
+#endif
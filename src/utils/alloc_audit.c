@@ -0,0 +1,195 @@
+#define _GNU_SOURCE
+#include "alloc_audit.h"
+#include "log.h"
+#include <stdio.h>
+
+#ifdef RAVIZ_ALLOC_AUDIT
+
+#include <stdint.h>
+#include <errno.h>
+#include <execinfo.h>
+
+// glibc's own entry points: what malloc & co. resolve to without us
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+#define MAX_SITES  256
+#define MAX_FRAMES 32
+#define SKIP_FRAMES 2   // record() and the interposed function
+
+typedef struct {
+    uint64_t hash;
+    int depth;
+    void *frames[MAX_FRAMES];
+    unsigned long count;
+    unsigned long bytes;
+} AllocSite;
+
+static unsigned long total_allocs;
+static int enabled;
+static int armed;
+
+// Recording must not allocate: a fixed table under a spinlock
+static AllocSite sites[MAX_SITES];
+static int num_sites;
+static unsigned long overflow;
+static char lock;
+static __thread int inside;   // backtrace() itself may allocate
+
+static __attribute__((noinline)) void record(size_t size) {
+    __atomic_fetch_add(&total_allocs, 1, __ATOMIC_RELAXED);
+    if (!__atomic_load_n(&armed, __ATOMIC_RELAXED) || inside) return;
+    inside = 1;
+
+    void *frames[MAX_FRAMES];
+    int depth = backtrace(frames, MAX_FRAMES);
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = SKIP_FRAMES; i < depth; ++i) {
+        hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ULL;
+    }
+
+    while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE)) {}
+    AllocSite *site = NULL;
+    for (int i = 0; i < num_sites; ++i) {
+        if (sites[i].hash == hash) {
+            site = &sites[i];
+            break;
+        }
+    }
+    if (!site && num_sites < MAX_SITES) {
+        site = &sites[num_sites++];
+        site->hash = hash;
+        site->depth = depth > SKIP_FRAMES ? depth - SKIP_FRAMES : 0;
+        for (int i = 0; i < site->depth; ++i) site->frames[i] = frames[i + SKIP_FRAMES];
+    }
+    if (site) {
+        site->count++;
+        site->bytes += size;
+    } else {
+        overflow++;
+    }
+    __atomic_clear(&lock, __ATOMIC_RELEASE);
+    inside = 0;
+}
+
+void *malloc(size_t size) {
+    record(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    record(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    record(size);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    record(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    record(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) return EINVAL;
+    record(size);
+    void *p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+int alloc_audit_available(void) {
+    return 1;
+}
+
+unsigned long alloc_audit_count(void) {
+    return __atomic_load_n(&total_allocs, __ATOMIC_RELAXED);
+}
+
+void alloc_audit_enable(void) {
+    // The first backtrace() loads the unwinder; get that over with now
+    void *frames[4];
+    backtrace(frames, 4);
+    enabled = 1;
+    log_info("Alloc", "Auditing allocations after warm-up");
+}
+
+void alloc_audit_arm(void) {
+    if (enabled && !armed) {
+        // Logged first so the message's own ring use is not recorded
+        log_info("Alloc", "Warm-up done at %lu allocations, recording from here", alloc_audit_count());
+        __atomic_store_n(&armed, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void alloc_audit_report(void) {
+    if (!enabled) return;
+    __atomic_store_n(&armed, 0, __ATOMIC_RELAXED);
+    // The report shares stderr with the log writer (and the stacks go
+    // straight to fd 2): drain and stop it so nothing lands mid-line
+    log_shutdown();
+    while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE)) {}
+
+    unsigned long count = overflow;
+    for (int i = 0; i < num_sites; ++i) count += sites[i].count;
+    if (count == 0) {
+        fprintf(stderr, "[Alloc] No allocations after warm-up\n");
+    } else {
+        fprintf(stderr, "[Alloc] %lu allocation(s) after warm-up from %d call site(s):\n", count, num_sites);
+    }
+
+    // Most frequent first (selection sort: the table is small)
+    for (int i = 0; i < num_sites; ++i) {
+        int best = i;
+        for (int j = i + 1; j < num_sites; ++j) {
+            if (sites[j].count > sites[best].count) best = j;
+        }
+        AllocSite tmp = sites[i];
+        sites[i] = sites[best];
+        sites[best] = tmp;
+
+        fprintf(stderr, "[Alloc] %lu x, %lu bytes:\n", sites[i].count, sites[i].bytes);
+        fflush(stderr);
+        // Writes straight to the fd: no allocation, works from any state
+        backtrace_symbols_fd(sites[i].frames, sites[i].depth, 2);
+    }
+    if (overflow) fprintf(stderr, "[Alloc] %lu more from sites beyond the first %d\n", overflow, MAX_SITES);
+    __atomic_clear(&lock, __ATOMIC_RELEASE);
+}
+
+#else
+
+int alloc_audit_available(void) {
+    return 0;
+}
+
+unsigned long alloc_audit_count(void) {
+    return 0;
+}
+
+void alloc_audit_enable(void) {
+    log_warn("Alloc", "--alloc-audit needs a build with RAVIZ_ALLOC_AUDIT (glibc only)");
+}
+
+void alloc_audit_arm(void) {
+}
+
+void alloc_audit_report(void) {
+}
+
+#endif
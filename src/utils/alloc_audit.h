@@ -0,0 +1,29 @@
+#ifndef ALLOC_AUDIT_H
+#define ALLOC_AUDIT_H
+
+// Allocation counting and auditing (--alloc-audit).
+//
+// When built with RAVIZ_ALLOC_AUDIT the executable interposes malloc,
+// calloc, realloc, posix_memalign, aligned_alloc and free for the whole
+// process (including libraries and the GL driver) and counts every
+// allocation. Once auditing is enabled and armed, each allocation's call
+// stack is also recorded, grouped by call site, for alloc_audit_report.
+// Without RAVIZ_ALLOC_AUDIT all of these are no-ops.
+
+// 1 if the interposer is compiled in.
+int alloc_audit_available(void);
+
+// Allocations so far, all threads.
+unsigned long alloc_audit_count(void);
+
+// Start collecting call stacks once alloc_audit_arm is called.
+void alloc_audit_enable(void);
+
+// End of warm-up: from now on every allocation is recorded (if enabled).
+void alloc_audit_arm(void);
+
+// Print the recorded call sites, most frequent first, to stderr. Shuts
+// the log writer down first; later messages are written directly.
+void alloc_audit_report(void);
+
+#endif
@@ -0,0 +1,35 @@
+#define _POSIX_C_SOURCE 200112L
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t round_up(size_t bytes) {
+    return (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+void arena_reserve(Arena *a, size_t bytes) {
+    a->size += round_up(bytes);
+}
+
+int arena_init(Arena *a) {
+    void *base = NULL;
+    if (a->size == 0 || posix_memalign(&base, ARENA_ALIGN, a->size) != 0) return 0;
+    memset(base, 0, a->size);
+    a->base = base;
+    a->used = 0;
+    return 1;
+}
+
+void* arena_alloc(Arena *a, size_t bytes) {
+    size_t n = round_up(bytes);
+    if (!a->base || n > a->size - a->used) return NULL;
+    void *p = a->base + a->used;
+    a->used += n;
+    return p;
+}
+
+void arena_release(Arena *a) {
+    free(a->base);
+    a->base = NULL;
+    a->size = a->used = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// One block holding all of a subsystem's buffers, allocated at init and
+// freed at cleanup, so nothing on a per-frame path touches the allocator.
+// Usage: start from a zeroed Arena, arena_reserve() every buffer, then
+// arena_init() once and arena_alloc() the same sizes.
+
+#define ARENA_ALIGN 64   // Cache line; also enough for FFTW's SIMD arrays
+
+typedef struct {
+    unsigned char *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+// Account for a buffer of 'bytes' before arena_init.
+void arena_reserve(Arena *a, size_t bytes);
+
+// Allocate the reserved size in one zeroed block. Returns 0 on failure.
+int arena_init(Arena *a);
+
+// Next ARENA_ALIGN-aligned, zeroed piece of 'bytes', or NULL if it was
+// not reserved.
+void* arena_alloc(Arena *a, size_t bytes);
+
+void arena_release(Arena *a);
+
+#endif
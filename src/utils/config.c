@@ -13,6 +13,23 @@
 #define PATH_SEPARATOR "/"
 #endif
 
+static ModRoute mod_route(ModSource source, int bin_lo, int bin_hi, float scale, ModTarget target) {
+    ModRoute r = { source, bin_lo, bin_hi, 0.0f, 1.0f, MOD_CURVE_LINEAR, 0.0f, 0.0f, scale, 0.0f, target };
+    return r;
+}
+
+// The response raviz had before routes were configurable: bass pushes the
+// sphere out, mids ripple it, and loudness swells the glow
+static void default_mod_routes(RavizConfig *config) {
+    config->mod_routes[0] = mod_route(MOD_SOURCE_BINS, 0, 4, 0.2f, MOD_TARGET_DISPLACEMENT);
+    config->mod_routes[1] = mod_route(MOD_SOURCE_BINS, 5, 19, 0.5f, MOD_TARGET_NOISE);
+    config->mod_routes[2] = mod_route(MOD_SOURCE_LOUDNESS, 0, 0, 2.0f, MOD_TARGET_GLOW);
+    config->mod_routes[2].offset = 0.3f;
+    config->mod_routes[2].attack = 0.05f;
+    config->mod_routes[2].release = 0.33f;
+    config->num_mod_routes = 3;
+}
+
 void config_init_defaults(RavizConfig *config) {
     config->fps = 30;
     config->audio_rate = 44100;
@@ -21,13 +38,204 @@ void config_init_defaults(RavizConfig *config) {
     config->sphere_lat = 40;
     config->sphere_lon = 40;
     config->sphere_scale = 1.0f;
+    config->sphere_mode = SPHERE_MESH;
+    config->lod_triangle_budget = 200000;
+    config->deform = DEFORM_STATELESS;
+    config->spring_stiffness = 120.0f;
+    config->spring_damping = 4.0f;
+    config->spring_coupling = 600.0f;
     config->color_mode = COLOR_MODE_NONE; 
+    config->scene = SCENE_SPHERE;
+    config->history_frames = 256;
+    config->particle_count = 100000;
+    config->particle_size = 2.0f;
+    config->scope_samples = 2048;
+    config->scope_xy = false;
+    config->scope_trigger = 0.0f;
     config->intensity = 1.0f;
     config->rotation_speed = 0.05f;
     config->smoothing = 0.15f; 
     config->window_opacity = 1.0f; 
+    config->adaptive_resolution = true;
+    config->render_scale_min = 0.5f;
+    config->render_scale_max = 1.0f;
+    config->bloom = false;
+    config->bloom_intensity = 1.0f;
+    config->bloom_threshold = 0.6f;
+    config->bloom_levels = 5;
+    config->max_frames_ahead = 1;
     config->show_fps = false;
+    default_mod_routes(config);
+    config->monitor = -1;
+    config->num_windows = 0;
+    config->shader_dir = NULL;
+    config->shader_cache = true;
+    config->gl_fast_path = true;
     config->audio_device = NULL;
+    config->num_sources = 0;
+    config->audio_workers = 0;
+    config->publish = false;
+    config->publish_name = "/raviz-spectrum";
+    config->headless = false;
+    config->no_render = false;
+    config->single_thread = false;
+    config->output_width = 1280;
+    config->output_height = 720;
+    config->output_path = "-";
+    config->input_file = NULL;
+    config->max_frames = 0;
+    config->record_spectra = NULL;
+    config->replay_spectra = NULL;
+    config->replay_fast = false;
+    config->perf_report = NULL;
+    config->alloc_audit = false;
+    config->latency_test = false;
+    config->latency_clicks = 20;
+    config->log_level = LOG_LEVEL_INFO;
+    config->log_json = false;
+}
+
+static SceneMode parse_scene(const char *s) {
+    if (strcmp(s, "history") == 0) return SCENE_HISTORY;
+    if (strcmp(s, "particles") == 0) return SCENE_PARTICLES;
+    if (strcmp(s, "scope") == 0) return SCENE_SCOPE;
+    return SCENE_SPHERE;
+}
+
+static int parse_route(const char *s, SourceRoute *out) {
+    static const char *names[] = { "mix", "hue", "glow" };
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i) {
+        if (strcmp(s, names[i]) == 0) {
+            *out = (SourceRoute)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int parse_mod_source(const char *s, ModSource *out) {
+    static const char *names[] = { "low", "mid", "high", "bins", "loudness", "onset", "hue", "chroma" };
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i) {
+        if (strcmp(s, names[i]) == 0) {
+            *out = (ModSource)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int parse_mod_target(const char *s, ModTarget *out) {
+    static const char *names[MOD_TARGETS] = { "displacement", "noise", "hue", "rotation", "scale", "glow" };
+    for (int i = 0; i < MOD_TARGETS; ++i) {
+        if (strcmp(s, names[i]) == 0) {
+            *out = (ModTarget)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static ModCurve parse_mod_curve(const char *s) {
+    if (strcmp(s, "square") == 0) return MOD_CURVE_SQUARE;
+    if (strcmp(s, "sqrt") == 0) return MOD_CURVE_SQRT;
+    if (strcmp(s, "smooth") == 0) return MOD_CURVE_SMOOTH;
+    if (strcmp(s, "step") == 0) return MOD_CURVE_STEP;
+    return MOD_CURVE_LINEAR;
+}
+
+// One [[modulation.routes]] table. Returns 0 (logged) for a route without
+// a usable source or target.
+static int parse_mod_route(toml_table_t *t, int index, ModRoute *r) {
+    *r = mod_route(MOD_SOURCE_LOW, 0, 0, 1.0f, MOD_TARGET_DISPLACEMENT);
+
+    // bins = [lo, hi] implies source = "bins"
+    int have_bins = 0;
+    toml_array_t *bins = toml_array_in(t, "bins");
+    if (bins && toml_array_nelem(bins) == 2) {
+        toml_datum_t lo = toml_int_at(bins, 0);
+        toml_datum_t hi = toml_int_at(bins, 1);
+        if (lo.ok && hi.ok) {
+            r->source = MOD_SOURCE_BINS;
+            r->bin_lo = (int)lo.u.i;
+            r->bin_hi = (int)hi.u.i;
+            have_bins = 1;
+        }
+    }
+    int have_source = have_bins;
+    toml_datum_t src = toml_string_in(t, "source");
+    if (src.ok) {
+        have_source = parse_mod_source(src.u.s, &r->source);
+        if (!have_source) log_warn("Config", "Modulation route %d: unknown source \"%s\"", index + 1, src.u.s);
+        free(src.u.s);
+        if (!have_source) return 0;
+    }
+    if (!have_source) {
+        log_warn("Config", "Modulation route %d has no source", index + 1);
+        return 0;
+    }
+    if (r->source == MOD_SOURCE_BINS && !have_bins) {
+        log_warn("Config", "Modulation route %d: source \"bins\" needs bins = [lo, hi]", index + 1);
+        return 0;
+    }
+
+    toml_datum_t tgt = toml_string_in(t, "target");
+    int have_target = 0;
+    if (tgt.ok) {
+        have_target = parse_mod_target(tgt.u.s, &r->target);
+        if (!have_target) log_warn("Config", "Modulation route %d: unknown target \"%s\"", index + 1, tgt.u.s);
+        free(tgt.u.s);
+    } else {
+        log_warn("Config", "Modulation route %d has no target", index + 1);
+    }
+    if (!have_target) return 0;
+
+    toml_array_t *range = toml_array_in(t, "range");
+    if (range && toml_array_nelem(range) == 2) {
+        toml_datum_t lo = toml_double_at(range, 0);
+        toml_datum_t hi = toml_double_at(range, 1);
+        if (lo.ok && hi.ok) {
+            r->in_min = (float)lo.u.d;
+            r->in_max = (float)hi.u.d;
+        }
+    }
+    toml_datum_t cv = toml_string_in(t, "curve");
+    if (cv.ok) {
+        r->curve = parse_mod_curve(cv.u.s);
+        free(cv.u.s);
+    }
+    toml_datum_t at = toml_double_in(t, "attack");
+    if (at.ok) r->attack = (float)at.u.d;
+    toml_datum_t rl = toml_double_in(t, "release");
+    if (rl.ok) r->release = (float)rl.u.d;
+    toml_datum_t sc = toml_double_in(t, "scale");
+    if (sc.ok) r->scale = (float)sc.u.d;
+    toml_datum_t of = toml_double_in(t, "offset");
+    if (of.ok) r->offset = (float)of.u.d;
+    return 1;
+}
+
+// Strings read from the file. Copies of a config (the audio thread's,
+// each window's) keep pointing at them after a reload, so they are never
+// freed; each distinct value is allocated once instead, and reloading an
+// unchanged file allocates nothing.
+typedef struct ConfigString {
+    struct ConfigString *next;
+    char text[];
+} ConfigString;
+
+static ConfigString *config_strings;
+
+static char* config_string(const char *s) {
+    for (ConfigString *c = config_strings; c; c = c->next) {
+        if (strcmp(c->text, s) == 0) return c->text;
+    }
+    size_t len = strlen(s) + 1;
+    ConfigString *c = malloc(sizeof(ConfigString) + len);
+    if (!c) return NULL;
+    memcpy(c->text, s, len);
+    c->next = config_strings;
+    config_strings = c;
+    return c->text;
 }
 
 static void ensure_config_exists(const char *path) {
@@ -52,9 +260,41 @@ static void ensure_config_exists(const char *path) {
         fprintf(f, "sphere_lat = 40\n");
         fprintf(f, "sphere_lon = 40\n");
         fprintf(f, "sphere_scale = 1.0\n");
+        fprintf(f, "sphere_mode = \"mesh\" # mesh, procedural\n");
+        fprintf(f, "lod_triangle_budget = 200000\n");
+        fprintf(f, "deform = \"stateless\" # stateless, spring\n");
+        fprintf(f, "spring_stiffness = 120.0\n");
+        fprintf(f, "spring_damping = 4.0\n");
+        fprintf(f, "spring_coupling = 600.0\n");
         fprintf(f, "rotation_speed = 0.05\n");
         fprintf(f, "window_opacity = 1.0\n");
-        fprintf(f, "color_mode = \"none\" # none, static, reactive\n\n");
+        fprintf(f, "color_mode = \"none\" # none, static, reactive\n");
+        fprintf(f, "scene = \"sphere\" # sphere, history, particles, scope\n");
+        fprintf(f, "history_frames = 256\n");
+        fprintf(f, "particle_count = 100000\n");
+        fprintf(f, "particle_size = 2.0\n");
+        fprintf(f, "scope_samples = 2048\n");
+        fprintf(f, "scope_xy = false\n");
+        fprintf(f, "scope_trigger = 0.0\n");
+        fprintf(f, "adaptive_resolution = true\n");
+        fprintf(f, "render_scale_min = 0.5\n");
+        fprintf(f, "render_scale_max = 1.0\n");
+        fprintf(f, "bloom = false\n");
+        fprintf(f, "bloom_intensity = 1.0\n");
+        fprintf(f, "bloom_threshold = 0.6\n");
+        fprintf(f, "bloom_levels = 5\n");
+        fprintf(f, "max_frames_ahead = 1 # 0-2, lower = less latency\n");
+        fprintf(f, "show_fps = false\n");
+        fprintf(f, "shader_cache = true\n");
+        fprintf(f, "gl_fast_path = true\n");
+        fprintf(f, "single_thread = false # one event loop, for 1-2 core machines\n");
+        fprintf(f, "# monitor = 0 # cover this monitor instead of floating\n");
+        fprintf(f, "# shader_dir = \"/path/to/shaders\"\n");
+        fprintf(f, "\n# More windows on the same analysis, e.g. one per monitor\n");
+        fprintf(f, "# [[render.windows]]\n");
+        fprintf(f, "# scene = \"particles\"\n");
+        fprintf(f, "# monitor = 1\n");
+        fprintf(f, "# fps = 60\n\n");
         
         fprintf(f, "[audio]\n");
         fprintf(f, "rate = 44100\n");
@@ -63,32 +303,65 @@ static void ensure_config_exists(const char *path) {
         fprintf(f, "smoothing = 0.15\n");
         fprintf(f, "intensity = 1.0\n");
         fprintf(f, "# device = \"alsa_output.pci...\"\n");
+        fprintf(f, "# workers = 2 # analysis threads shared by all sources\n");
+        fprintf(f, "publish = false\n");
+        fprintf(f, "# publish_name = \"/raviz-spectrum\"\n");
+        fprintf(f, "\n# Several sources at once (replaces device); route = mix, hue or glow\n");
+        fprintf(f, "# [[audio.sources]]\n");
+        fprintf(f, "# device = \"default\"\n");
+        fprintf(f, "# gain = 1.0\n");
+        fprintf(f, "# route = \"mix\"\n\n");
+
+        fprintf(f, "# Route analysis features to render parameters; any routes replace\n");
+        fprintf(f, "# the built-in ones (bins 0-4 -> displacement, 5-19 -> noise,\n");
+        fprintf(f, "# loudness -> glow). source = low, mid, high, bins, loudness, onset,\n");
+        fprintf(f, "# hue, chroma; target = displacement, noise, hue, rotation, scale, glow;\n");
+        fprintf(f, "# curve = linear, square, sqrt, smooth, step\n");
+        fprintf(f, "# [[modulation.routes]]\n");
+        fprintf(f, "# source = \"onset\"\n");
+        fprintf(f, "# range = [0.0, 1.0]\n");
+        fprintf(f, "# curve = \"linear\"\n");
+        fprintf(f, "# attack = 0.0\n");
+        fprintf(f, "# release = 0.25\n");
+        fprintf(f, "# scale = 0.3\n");
+        fprintf(f, "# offset = 0.0\n");
+        fprintf(f, "# target = \"scale\"\n\n");
+
+        fprintf(f, "[log]\n");
+        fprintf(f, "level = \"info\" # debug, info, warn, error\n");
+        fprintf(f, "json = false\n");
         fclose(f);
-        printf("Created default config at %s\n", path);
+        log_info(NULL, "Created default config at %s", path);
     } else {
-        fprintf(stderr, "Failed to create config file at %s\n", path);
+        log_error(NULL, "Failed to create config file at %s", path);
     }
 }
 
-void config_load(RavizConfig *config) {
+int config_dir(char *out, size_t size) {
     const char *home = getenv("HOME");
-    if (!home) return;
-
-    char path[512];
-    snprintf(path, sizeof(path), "%s/.config/raviz/config.toml", home);
+    if (!home) return 0;
+    snprintf(out, size, "%s/.config/raviz", home);
+    return 1;
+}
 
-    ensure_config_exists(path);
+static int config_path(char *out, size_t size) {
+    char dir[480];
+    if (!config_dir(dir, sizeof(dir))) return 0;
+    snprintf(out, size, "%s/config.toml", dir);
+    return 1;
+}
 
+static int config_read(RavizConfig *config, const char *path) {
     FILE *fp = fopen(path, "r");
-    if (!fp) return;
+    if (!fp) return 1;
 
     char errbuf[200];
     toml_table_t *conf = toml_parse_file(fp, errbuf, sizeof(errbuf));
     fclose(fp);
 
     if (!conf) {
-        fprintf(stderr, "Failed to parse config: %s\n", errbuf);
-        return;
+        log_error("Config", "Failed to parse config: %s", errbuf);
+        return 0;
     }
 
     toml_table_t *render = toml_table_in(conf, "render");
@@ -105,6 +378,32 @@ void config_load(RavizConfig *config) {
         toml_datum_t scale = toml_double_in(render, "sphere_scale");
         if (scale.ok) config->sphere_scale = (float)scale.u.d;
 
+        toml_datum_t sm = toml_string_in(render, "sphere_mode");
+        if (sm.ok) {
+            if (strcmp(sm.u.s, "procedural") == 0) config->sphere_mode = SPHERE_PROCEDURAL;
+            else config->sphere_mode = SPHERE_MESH;
+            free(sm.u.s);
+        }
+
+        toml_datum_t budget = toml_int_in(render, "lod_triangle_budget");
+        if (budget.ok) config->lod_triangle_budget = (int)budget.u.i;
+
+        toml_datum_t dm = toml_string_in(render, "deform");
+        if (dm.ok) {
+            if (strcmp(dm.u.s, "spring") == 0) config->deform = DEFORM_SPRING;
+            else config->deform = DEFORM_STATELESS;
+            free(dm.u.s);
+        }
+
+        toml_datum_t stiff = toml_double_in(render, "spring_stiffness");
+        if (stiff.ok) config->spring_stiffness = (float)stiff.u.d;
+
+        toml_datum_t damp = toml_double_in(render, "spring_damping");
+        if (damp.ok) config->spring_damping = (float)damp.u.d;
+
+        toml_datum_t coup = toml_double_in(render, "spring_coupling");
+        if (coup.ok) config->spring_coupling = (float)coup.u.d;
+
         toml_datum_t rot = toml_double_in(render, "rotation_speed");
         if (rot.ok) config->rotation_speed = (float)rot.u.d;
         
@@ -118,6 +417,99 @@ void config_load(RavizConfig *config) {
             else config->color_mode = COLOR_MODE_NONE;
             free(cm.u.s);
         }
+
+        toml_datum_t sc = toml_string_in(render, "scene");
+        if (sc.ok) {
+            config->scene = parse_scene(sc.u.s);
+            free(sc.u.s);
+        }
+
+        toml_datum_t hist = toml_int_in(render, "history_frames");
+        if (hist.ok) config->history_frames = (int)hist.u.i;
+
+        toml_datum_t pc = toml_int_in(render, "particle_count");
+        if (pc.ok) config->particle_count = (int)pc.u.i;
+
+        toml_datum_t ps = toml_double_in(render, "particle_size");
+        if (ps.ok) config->particle_size = (float)ps.u.d;
+
+        toml_datum_t ss = toml_int_in(render, "scope_samples");
+        if (ss.ok) config->scope_samples = (int)ss.u.i;
+
+        toml_datum_t sxy = toml_bool_in(render, "scope_xy");
+        if (sxy.ok) config->scope_xy = sxy.u.b;
+
+        toml_datum_t st = toml_double_in(render, "scope_trigger");
+        if (st.ok) config->scope_trigger = (float)st.u.d;
+
+        toml_datum_t adaptive = toml_bool_in(render, "adaptive_resolution");
+        if (adaptive.ok) config->adaptive_resolution = adaptive.u.b;
+
+        toml_datum_t smin = toml_double_in(render, "render_scale_min");
+        if (smin.ok) config->render_scale_min = (float)smin.u.d;
+
+        toml_datum_t smax = toml_double_in(render, "render_scale_max");
+        if (smax.ok) config->render_scale_max = (float)smax.u.d;
+
+        toml_datum_t bl = toml_bool_in(render, "bloom");
+        if (bl.ok) config->bloom = bl.u.b;
+
+        toml_datum_t bi = toml_double_in(render, "bloom_intensity");
+        if (bi.ok) config->bloom_intensity = (float)bi.u.d;
+
+        toml_datum_t bt = toml_double_in(render, "bloom_threshold");
+        if (bt.ok) config->bloom_threshold = (float)bt.u.d;
+
+        toml_datum_t blv = toml_int_in(render, "bloom_levels");
+        if (blv.ok) config->bloom_levels = (int)blv.u.i;
+
+        toml_datum_t ahead = toml_int_in(render, "max_frames_ahead");
+        if (ahead.ok) config->max_frames_ahead = (int)ahead.u.i;
+
+        toml_datum_t sf = toml_bool_in(render, "show_fps");
+        if (sf.ok) config->show_fps = sf.u.b;
+
+        toml_datum_t sd = toml_string_in(render, "shader_dir");
+        if (sd.ok) {
+            config->shader_dir = config_string(sd.u.s);
+            free(sd.u.s);
+        }
+
+        toml_datum_t cache = toml_bool_in(render, "shader_cache");
+        if (cache.ok) config->shader_cache = cache.u.b;
+
+        toml_datum_t fast = toml_bool_in(render, "gl_fast_path");
+        if (fast.ok) config->gl_fast_path = fast.u.b;
+
+        toml_datum_t single = toml_bool_in(render, "single_thread");
+        if (single.ok) config->single_thread = single.u.b;
+
+        toml_datum_t mon = toml_int_in(render, "monitor");
+        if (mon.ok) config->monitor = (int)mon.u.i;
+
+        // [[render.windows]] tables: scene, monitor, fps
+        toml_array_t *wins = toml_array_in(render, "windows");
+        if (wins) {
+            config->num_windows = 0;
+            for (int i = 0; i < toml_array_nelem(wins) && config->num_windows < MAX_EXTRA_WINDOWS; ++i) {
+                toml_table_t *t = toml_table_at(wins, i);
+                if (!t) continue;
+                WindowSpec *win = &config->windows[config->num_windows++];
+                win->scene = config->scene;
+                win->monitor = -1;
+                win->fps = 0;
+
+                toml_datum_t ws = toml_string_in(t, "scene");
+                if (ws.ok) {
+                    win->scene = parse_scene(ws.u.s);
+                    free(ws.u.s);
+                }
+                toml_datum_t wm = toml_int_in(t, "monitor");
+                if (wm.ok) win->monitor = (int)wm.u.i;
+                toml_datum_t wf = toml_int_in(t, "fps");
+                if (wf.ok) win->fps = (int)wf.u.i;
+            }
+        }
     }
 
     toml_table_t *audio = toml_table_in(conf, "audio");
@@ -139,15 +531,154 @@ void config_load(RavizConfig *config) {
         
         toml_datum_t dev = toml_string_in(audio, "device");
         if (dev.ok) {
-            config->audio_device = strdup(dev.u.s);
+            config->audio_device = config_string(dev.u.s);
             free(dev.u.s);
         }
+
+        // [[audio.sources]] tables: device, gain, route
+        toml_array_t *srcs = toml_array_in(audio, "sources");
+        if (srcs) {
+            config->num_sources = 0;
+            for (int i = 0; i < toml_array_nelem(srcs) && config->num_sources < MAX_AUDIO_SOURCES; ++i) {
+                toml_table_t *t = toml_table_at(srcs, i);
+                if (!t) continue;
+                AudioSource *src = &config->sources[config->num_sources++];
+                src->name = NULL;
+                src->gain = 1.0f;
+                src->route = ROUTE_MIX;
+
+                toml_datum_t sd = toml_string_in(t, "device");
+                if (sd.ok) {
+                    if (strcmp(sd.u.s, "default") != 0) src->name = config_string(sd.u.s);
+                    free(sd.u.s);
+                }
+                toml_datum_t sg = toml_double_in(t, "gain");
+                if (sg.ok) src->gain = (float)sg.u.d;
+                toml_datum_t sr = toml_string_in(t, "route");
+                if (sr.ok) {
+                    if (!parse_route(sr.u.s, &src->route)) {
+                        log_warn("Config", "Source %d: unknown route \"%s\", ignoring the source", i + 1, sr.u.s);
+                        config->num_sources--;
+                    }
+                    free(sr.u.s);
+                }
+            }
+        }
+
+        toml_datum_t wk = toml_int_in(audio, "workers");
+        if (wk.ok) config->audio_workers = (int)wk.u.i;
+
+        toml_datum_t pb = toml_bool_in(audio, "publish");
+        if (pb.ok) config->publish = pb.u.b;
+
+        toml_datum_t pn = toml_string_in(audio, "publish_name");
+        if (pn.ok) {
+            config->publish_name = config_string(pn.u.s);
+            free(pn.u.s);
+        }
+    }
+
+    // [[modulation.routes]]: a list, even an empty one, replaces the defaults
+    toml_table_t *mod = toml_table_in(conf, "modulation");
+    toml_array_t *routes = mod ? toml_array_in(mod, "routes") : NULL;
+    if (routes) {
+        config->num_mod_routes = 0;
+        for (int i = 0; i < toml_array_nelem(routes); ++i) {
+            toml_table_t *t = toml_table_at(routes, i);
+            if (!t) continue;
+            if (config->num_mod_routes == MAX_MOD_ROUTES) {
+                log_warn("Config", "At most %d modulation routes, ignoring the rest", MAX_MOD_ROUTES);
+                break;
+            }
+            if (parse_mod_route(t, i, &config->mod_routes[config->num_mod_routes])) config->num_mod_routes++;
+        }
+    }
+
+    toml_table_t *log = toml_table_in(conf, "log");
+    if (log) {
+        toml_datum_t lv = toml_string_in(log, "level");
+        if (lv.ok) {
+            log_parse_level(lv.u.s, &config->log_level);
+            free(lv.u.s);
+        }
+
+        toml_datum_t js = toml_bool_in(log, "json");
+        if (js.ok) config->log_json = js.u.b;
     }
 
     toml_free(conf);
+    return 1;
 }
 
-int config_parse_args(RavizConfig *config, int argc, char **argv) {
+int config_load(RavizConfig *config) {
+    char path[512];
+    if (!config_path(path, sizeof(path))) return 1;
+    ensure_config_exists(path);
+    return config_read(config, path);
+}
+
+static int parse_args(RavizConfig *config, int argc, char **argv, int report);
+
+int config_reload(RavizConfig *config, int argc, char **argv) {
+    // A file deleted (or mid-rename) while running is not a request for
+    // the defaults: keep what is running until it comes back
+    char path[512];
+    if (!config_path(path, sizeof(path))) return 0;
+    if (access(path, F_OK) != 0) {
+        log_info("Config", "%s is gone, keeping the running config", path);
+        return 0;
+    }
+
+    RavizConfig fresh;
+    config_init_defaults(&fresh);
+    if (!config_read(&fresh, path)) return 0;
+    parse_args(&fresh, argc, argv, 0);
+    *config = fresh;
+    return 1;
+}
+
+int config_str_changed(const char *a, const char *b) {
+    if (!a || !b) return a != b;
+    return strcmp(a, b) != 0;
+}
+
+int config_audio_sources(const RavizConfig *config, AudioSource out[MAX_AUDIO_SOURCES]) {
+    for (int i = 0; i < config->num_sources; ++i) out[i] = config->sources[i];
+    if (config->num_sources > 0) return config->num_sources;
+
+    out[0].name = config->input_file ? config->input_file : config->audio_device;
+    out[0].gain = 1.0f;
+    out[0].route = ROUTE_MIX;
+    return 1;
+}
+
+void config_window(const RavizConfig *config, int index, RavizConfig *out) {
+    const WindowSpec *win = &config->windows[index];
+    *out = *config;
+    out->scene = win->scene;
+    out->monitor = win->monitor;
+    if (win->fps > 0) out->fps = win->fps;
+    out->num_windows = 0;
+}
+
+int config_shows_scope(const RavizConfig *config) {
+    if (config->scene == SCENE_SCOPE) return 1;
+    if (config->headless) return 0;
+    for (int i = 0; i < config->num_windows; ++i) {
+        if (config->windows[i].scene == SCENE_SCOPE) return 1;
+    }
+    return 0;
+}
+
+// CLI warnings only when 'report' is set: config_reload applies the same
+// overrides on every save and has said its piece at startup
+#define ARG_WARN(...) do { if (report) log_warn("Config", __VA_ARGS__); } while (0)
+
+static int parse_args(RavizConfig *config, int argc, char **argv, int report) {
+    int cli_sources = 0;   // The first --source replaces the file's list
+    AudioSource *source = NULL; // What --gain/--route apply to: the last --source, if accepted
+    int cli_windows = 0;   // Likewise the first --window
+    WindowSpec *window = NULL;  // What --monitor/--window-fps apply to: the last --window, if accepted
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
             config->fps = atoi(argv[++i]);
@@ -162,6 +693,24 @@ int config_parse_args(RavizConfig *config, int argc, char **argv) {
             if (strcmp(mode, "static") == 0) config->color_mode = COLOR_MODE_STATIC;
             else if (strcmp(mode, "reactive") == 0) config->color_mode = COLOR_MODE_REACTIVE;
             else config->color_mode = COLOR_MODE_NONE;
+        } else if (strcmp(argv[i], "--procedural") == 0) {
+            config->sphere_mode = SPHERE_PROCEDURAL;
+        } else if (strcmp(argv[i], "--lod-budget") == 0 && i + 1 < argc) {
+            config->lod_triangle_budget = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--spring") == 0) {
+            config->deform = DEFORM_SPRING;
+        } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            config->scene = parse_scene(argv[++i]);
+        } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+            config->history_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+            config->particle_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--scope-samples") == 0 && i + 1 < argc) {
+            config->scope_samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--scope-xy") == 0) {
+            config->scope_xy = true;
+        } else if (strcmp(argv[i], "--scope-trigger") == 0 && i + 1 < argc) {
+            config->scope_trigger = atof(argv[++i]);
         } else if (strcmp(argv[i], "--no-color") == 0) {
             config->color_mode = COLOR_MODE_NONE;
         } else if (strcmp(argv[i], "--intensity") == 0 && i + 1 < argc) {
@@ -174,6 +723,113 @@ int config_parse_args(RavizConfig *config, int argc, char **argv) {
             config->sphere_scale = atof(argv[++i]);
         } else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
             config->audio_device = argv[++i];
+        } else if (strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
+            if (!cli_sources++) config->num_sources = 0;
+            char *name = argv[++i];
+            if (config->num_sources < MAX_AUDIO_SOURCES) {
+                source = &config->sources[config->num_sources++];
+                source->name = strcmp(name, "default") == 0 ? NULL : name;
+                source->gain = 1.0f;
+                source->route = ROUTE_MIX;
+            } else {
+                source = NULL;
+                ARG_WARN("At most %d sources, ignoring %s", MAX_AUDIO_SOURCES, name);
+            }
+        } else if (strcmp(argv[i], "--gain") == 0 && i + 1 < argc) {
+            // Only for a --source given here: the file's sources set their own
+            float gain = atof(argv[++i]);
+            if (source) source->gain = gain;
+            else if (cli_sources) ARG_WARN("--gain follows an ignored --source, ignored");
+            else ARG_WARN("--gain needs a --source before it, ignored");
+        } else if (strcmp(argv[i], "--route") == 0 && i + 1 < argc) {
+            SourceRoute route;
+            const char *name = argv[++i];
+            if (!parse_route(name, &route)) ARG_WARN("Unknown route \"%s\" (mix, hue or glow), ignored", name);
+            else if (source) source->route = route;
+            else if (cli_sources) ARG_WARN("--route follows an ignored --source, ignored");
+            else ARG_WARN("--route needs a --source before it, ignored");
+        } else if (strcmp(argv[i], "--audio-workers") == 0 && i + 1 < argc) {
+            config->audio_workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--publish") == 0) {
+            config->publish = true;
+        } else if (strcmp(argv[i], "--res-min") == 0 && i + 1 < argc) {
+            config->render_scale_min = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--res-max") == 0 && i + 1 < argc) {
+            config->render_scale_max = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-adaptive-res") == 0) {
+            config->adaptive_resolution = false;
+        } else if (strcmp(argv[i], "--bloom") == 0) {
+            config->bloom = true;
+        } else if (strcmp(argv[i], "--bloom-intensity") == 0 && i + 1 < argc) {
+            config->bloom_intensity = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--frames-ahead") == 0 && i + 1 < argc) {
+            config->max_frames_ahead = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            config->show_fps = true;
+        } else if (strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc) {
+            config->shader_dir = argv[++i];
+        } else if (strcmp(argv[i], "--no-shader-cache") == 0) {
+            config->shader_cache = false;
+        } else if (strcmp(argv[i], "--gl33") == 0) {
+            config->gl_fast_path = false;
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            if (!cli_windows++) config->num_windows = 0;
+            char *scene = argv[++i];
+            if (config->num_windows < MAX_EXTRA_WINDOWS) {
+                window = &config->windows[config->num_windows++];
+                window->scene = parse_scene(scene);
+                window->monitor = -1;
+                window->fps = 0;
+            } else {
+                window = NULL;
+                ARG_WARN("At most %d extra windows, ignoring --window %s", MAX_EXTRA_WINDOWS, scene);
+            }
+        } else if (strcmp(argv[i], "--monitor") == 0 && i + 1 < argc) {
+            int monitor = atoi(argv[++i]);
+            if (!cli_windows) config->monitor = monitor;
+            else if (window) window->monitor = monitor;
+            else ARG_WARN("--monitor follows an ignored --window, ignored");
+        } else if (strcmp(argv[i], "--window-fps") == 0 && i + 1 < argc) {
+            int fps = atoi(argv[++i]);
+            if (window) window->fps = fps;
+            else if (cli_windows) ARG_WARN("--window-fps follows an ignored --window, ignored");
+            else ARG_WARN("--window-fps needs a --window before it, ignored");
+        } else if (strcmp(argv[i], "--no-render") == 0) {
+            config->no_render = true;
+        } else if (strcmp(argv[i], "--single-thread") == 0) {
+            config->single_thread = true;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            config->headless = true;
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            int w, h;
+            if (sscanf(argv[++i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+                config->output_width = w;
+                config->output_height = h;
+            }
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            config->output_path = argv[++i];
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            config->input_file = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            config->max_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record-spectra") == 0 && i + 1 < argc) {
+            config->record_spectra = argv[++i];
+        } else if (strcmp(argv[i], "--replay-spectra") == 0 && i + 1 < argc) {
+            config->replay_spectra = argv[++i];
+        } else if (strcmp(argv[i], "--replay-fast") == 0) {
+            config->replay_fast = true;
+        } else if (strcmp(argv[i], "--perf-report") == 0 && i + 1 < argc) {
+            config->perf_report = argv[++i];
+        } else if (strcmp(argv[i], "--alloc-audit") == 0) {
+            config->alloc_audit = true;
+        } else if (strcmp(argv[i], "--latency-test") == 0) {
+            config->latency_test = true;
+        } else if (strcmp(argv[i], "--latency-clicks") == 0 && i + 1 < argc) {
+            config->latency_clicks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            log_parse_level(argv[++i], &config->log_level);
+        } else if (strcmp(argv[i], "--log-json") == 0) {
+            config->log_json = true;
         } else if (strcmp(argv[i], "--help") == 0) {
             printf("Usage: raviz [options]\n");
             printf("Options:\n");
@@ -182,14 +838,63 @@ int config_parse_args(RavizConfig *config, int argc, char **argv) {
             printf("  --lat <int>            Sphere latitude segments (default: 40)\n");
             printf("  --lon <int>            Sphere longitude segments (default: 40)\n");
             printf("  --scale <float>        Sphere scale (default: 1.0)\n");
+            printf("  --procedural           Generate the sphere on the GPU with per-frame LOD\n");
+            printf("  --lod-budget <int>     Triangle budget for procedural LOD (default: 200000)\n");
+            printf("  --spring               Spring-based surface dynamics (mesh mode)\n");
             printf("  --color <mode>         static|reactive|none (default: none)\n");
             printf("  --no-color             Disable color\n");
+            printf("  --scene <name>         sphere|history|particles|scope (default: sphere)\n");
+            printf("  --history <int>        Spectrogram history rows (default: 256)\n");
+            printf("  --particles <int>      Particle count for the particle scene (default: 100000)\n");
+            printf("  --scope-samples <int>  Frames per oscilloscope window, 256-4096 (default: 2048)\n");
+            printf("  --scope-xy             Oscilloscope plots left against right (Lissajous)\n");
+            printf("  --scope-trigger <float> Oscilloscope trigger level -1.0-1.0 (default: 0.0)\n");
             printf("  --intensity <float>    Reaction intensity (default: 1.0)\n");
             printf("  --opacity <float>      Window opacity 0.0-1.0 (default: 1.0)\n");
             printf("  --rotation-speed <float> Speed (default: 0.05)\n");
             printf("  --device <name>        PulseAudio source device name\n");
+            printf("  --source <name>        Capture this source too (repeatable; 'default', a device or file:<x.wav>)\n");
+            printf("  --gain <float>         Gain of the preceding --source (default: 1.0)\n");
+            printf("  --route <mix|hue|glow> What the preceding --source drives (default: mix)\n");
+            printf("  --audio-workers <int>  Analysis threads shared by all sources (default: one per core)\n");
+            printf("  --publish              Share spectrum, bands and beats in /dev/shm/raviz-spectrum\n");
+            printf("  --res-min <float>      Lowest adaptive render scale (default: 0.5)\n");
+            printf("  --res-max <float>      Highest adaptive render scale, >1 supersamples (default: 1.0)\n");
+            printf("  --no-adaptive-res      Always render at full window resolution\n");
+            printf("  --bloom                Enable the audio-driven glow post-process\n");
+            printf("  --bloom-intensity <float> Glow strength (default: 1.0)\n");
+            printf("  --frames-ahead <0-2>   Frames the GPU may queue ahead (default: 1)\n");
+            printf("  --stats                Print fps and audio-to-GPU latency every 2 s\n");
+            printf("  --shader-dir <path>    Load shaders from this directory first\n");
+            printf("  --no-shader-cache      Always compile shaders instead of using cached binaries\n");
+            printf("  --gl33                 Stick to the OpenGL 3.3 upload path even on newer drivers\n");
+            printf("  --monitor <int>        Cover this monitor, borderless (the preceding --window's, else the main one)\n");
+            printf("  --window <scene>       Open another window on the same analysis (repeatable)\n");
+            printf("  --window-fps <int>     Frame rate of the preceding --window (default: --fps)\n");
+            printf("  --headless             Render offscreen and write frames (no window)\n");
+            printf("  --no-render            Analysis daemon: capture and --publish only, no window or GL\n");
+            printf("  --single-thread        Capture, analyse and draw from one event loop (low-core machines)\n");
+            printf("  --size <WxH>           Headless frame size (default: 1280x720)\n");
+            printf("  --output <path>        '-' raw RGBA to stdout, 'frame_%%05d.png' PNGs, or raw file\n");
+            printf("  --input <file.wav>     Analyse a 16-bit PCM WAV file instead of live audio\n");
+            printf("  --frames <int>         Stop after this many frames\n");
+            printf("  --record-spectra <file> Save every analysis frame for later replay\n");
+            printf("  --replay-spectra <file> Render a recording instead of capturing audio\n");
+            printf("  --replay-fast          Replay as fast as possible (always on with --headless)\n");
+            printf("  --alloc-audit          Report every allocation after warm-up with its call stack\n");
+            printf("  --perf-report <file>   After a --headless --input or replay run, write stage timings as JSON\n");
+            printf("  --latency-test         Time clicks played into a null sink through to the screen, then exit\n");
+            printf("  --latency-clicks <int> Clicks measured by --latency-test (default: 20)\n");
+            printf("  --log-level <level>    debug|info|warn|error (default: info)\n");
+            printf("  --log-json             Write log messages as JSON lines\n");
             return 1; 
         }
     }
     return 0;
-}
\ No newline at end of file
+}
+
+#undef ARG_WARN
+
+int config_parse_args(RavizConfig *config, int argc, char **argv) {
+    return parse_args(config, argc, argv, 1);
+}
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "log.h"
 
 typedef enum {
     COLOR_MODE_NONE,
@@ -10,6 +12,94 @@ typedef enum {
     COLOR_MODE_REACTIVE
 } ColorMode;
 
+typedef enum {
+    SCENE_SPHERE,       // Stateless displacement from the current spectrum
+    SCENE_HISTORY,      // Sphere latitude mapped to spectrogram history
+    SCENE_PARTICLES,    // GPU particle field advanced by transform feedback
+    SCENE_SCOPE         // Oscilloscope of the raw PCM (waveform or XY)
+} SceneMode;
+
+// Largest oscilloscope window (stereo frames) the audio thread hands over
+#define SCOPE_MAX_FRAMES 4096
+
+// Windows opened next to the main one (--window / [[render.windows]])
+#define MAX_EXTRA_WINDOWS 7
+
+typedef struct {
+    SceneMode scene;
+    int monitor;        // Cover this monitor (0 = first), or -1 to float like the main window
+    int fps;            // 0: the main window's fps
+} WindowSpec;
+
+// Sources captured at once (--source / [[audio.sources]])
+#define MAX_AUDIO_SOURCES 16
+
+typedef enum {
+    ROUTE_MIX,          // Summed into the analysed spectrum
+    ROUTE_HUE,          // Its pitch drives the reactive hue
+    ROUTE_GLOW          // Its level drives the bloom strength
+} SourceRoute;
+
+typedef struct {
+    char *name;         // PulseAudio source, "file:<path.wav>", or NULL for the default monitor
+    float gain;         // Scales the source's spectrum (mix) or level (glow)
+    SourceRoute route;
+} AudioSource;
+
+typedef enum {
+    SPHERE_MESH,        // Indexed VBO built once from sphere_lat/sphere_lon
+    SPHERE_PROCEDURAL   // Generated from gl_VertexID, tessellation picked per frame
+} SphereMode;
+
+typedef enum {
+    DEFORM_STATELESS,   // Displacement recomputed from the spectrum every frame
+    DEFORM_SPRING       // Damped, neighbour-coupled springs integrated on the GPU
+} DeformMode;
+
+// Modulation matrix ([[modulation.routes]]): each route maps one analysis
+// feature through a range, curve and attack/release follower onto one
+// render parameter. Routes to the same target add up.
+#define MAX_MOD_ROUTES 32
+
+typedef enum {
+    MOD_SOURCE_LOW,         // Mean of the bins below 300 Hz
+    MOD_SOURCE_MID,         // 300 Hz - 4 kHz
+    MOD_SOURCE_HIGH,        // Above 4 kHz
+    MOD_SOURCE_BINS,        // Mean of bins bin_lo..bin_hi
+    MOD_SOURCE_LOUDNESS,    // Mean of all bins, or the level of sources routed to glow
+    MOD_SOURCE_ONSET,       // 1 on a low-band onset, else 0
+    MOD_SOURCE_HUE,         // Pitch class of the harmony (or the drifting hue), 0-1
+    MOD_SOURCE_CHROMA       // How clearly that key stands out, 0-1
+} ModSource;
+
+typedef enum {
+    MOD_TARGET_DISPLACEMENT, // Radial push of the sphere, times intensity
+    MOD_TARGET_NOISE,        // Amplitude of the random ripple, times intensity
+    MOD_TARGET_HUE,          // Added to the reactive hue
+    MOD_TARGET_ROTATION,     // Added to rotation_speed
+    MOD_TARGET_SCALE,        // Added to sphere_scale
+    MOD_TARGET_GLOW,         // Multiplies bloom_intensity (1 when nothing drives it)
+    MOD_TARGETS
+} ModTarget;
+
+typedef enum {
+    MOD_CURVE_LINEAR,
+    MOD_CURVE_SQUARE,       // Quiet parts stay quiet
+    MOD_CURVE_SQRT,         // Quiet parts come up
+    MOD_CURVE_SMOOTH,       // Smoothstep, saturates at the top of the range
+    MOD_CURVE_STEP          // 1 above the middle of the range, else 0
+} ModCurve;
+
+typedef struct {
+    ModSource source;
+    int bin_lo, bin_hi;     // MOD_SOURCE_BINS, inclusive
+    float in_min, in_max;   // Mapped to 0-1 before the curve (below in_min is 0)
+    ModCurve curve;
+    float attack, release;  // Seconds to follow a rise / a fall, 0 = instantly
+    float scale, offset;    // Contribution: offset + scale * followed value
+    ModTarget target;
+} ModRoute;
+
 typedef struct {
     int fps;
     int audio_rate;
@@ -18,22 +108,99 @@ typedef struct {
     int sphere_lat;     // Latitude segments
     int sphere_lon;     // Longitude segments
     float sphere_scale; // Scale of the sphere (default: 1.0)
+    SphereMode sphere_mode;
+    int lod_triangle_budget; // Max triangles per frame in procedural mode
+    DeformMode deform;
+    float spring_stiffness;
+    float spring_damping;
+    float spring_coupling;
     ColorMode color_mode;
+    SceneMode scene;
+    int history_frames; // Rows in the spectrogram history ring
+    int particle_count; // Particles in the particle scene
+    float particle_size; // Particle quad size in pixels
+    int scope_samples;  // Frames per oscilloscope window (256-SCOPE_MAX_FRAMES)
+    bool scope_xy;      // Lissajous left-vs-right plot instead of waveforms
+    float scope_trigger; // Rising-edge trigger level, -1.0 to 1.0
     float intensity;    // Global scaling for reaction
     float rotation_speed;
     float smoothing;    // 0.0 to 1.0
     float window_opacity; // 0.0 (transparent) to 1.0 (solid black)
-    bool show_fps;
+    bool adaptive_resolution; // Scale render resolution to hold the fps target
+    float render_scale_min;   // Floor for the adaptive scale (fraction of window size)
+    float render_scale_max;   // Ceiling; values above 1.0 supersample
+    bool bloom;               // Glow post-process (off: no passes, no buffers)
+    float bloom_intensity;
+    float bloom_threshold;    // Brightness where glow starts
+    int bloom_levels;         // Downsample chain length (1-8)
+    int max_frames_ahead;     // Frames the GPU may queue behind the CPU (0-2)
+    bool show_fps;            // Print fps and latency stats every 2 s
+    ModRoute mod_routes[MAX_MOD_ROUTES]; // Defaults reproduce the built-in response
+    int num_mod_routes;
+    int monitor;              // Main window covers this monitor (borderless), -1 floats
+    WindowSpec windows[MAX_EXTRA_WINDOWS]; // Extra windows sharing the analysis and GL objects
+    int num_windows;
+    char *shader_dir;   // Extra shader directory searched first, or NULL
+    bool shader_cache;  // Cache linked program binaries in ~/.cache/raviz
+    bool gl_fast_path;  // Use GL 4.4/4.5 DSA and persistent buffers when available
     char *audio_device; // PulseAudio source name or NULL for default
+    AudioSource sources[MAX_AUDIO_SOURCES]; // Captured together; replaces audio_device when set
+    int num_sources;
+    int audio_workers;  // Analysis threads shared by all sources (0 = one per core, at most one per source)
+    bool publish;       // Share each analysis frame via POSIX shared memory
+    char *publish_name; // Shared-memory object name (e.g. "/raviz-spectrum")
+    bool headless;      // Render offscreen and write frames instead of a window
+    bool no_render;     // Analysis daemon: capture + publish only, no GL at all
+    bool single_thread; // Capture, analysis and drawing on one thread, driven by one poll
+    int output_width;   // Offscreen frame size in headless mode
+    int output_height;
+    char *output_path;  // "-" for raw RGBA on stdout, "%d" pattern for PNGs, else raw file
+    char *input_file;   // WAV file to analyse instead of live capture, or NULL
+    int max_frames;     // Stop after this many frames (0 = unlimited)
+    char *record_spectra; // Write every analysis frame to this file, or NULL
+    char *replay_spectra; // Render a recording instead of capturing, or NULL
+    bool replay_fast;     // Replay as fast as frames render instead of in real time
+    char *perf_report;    // Write per-stage timings here after a headless/replay run, or NULL
+    bool alloc_audit;     // Record call stacks of allocations after warm-up
+    bool latency_test;    // Play clicks into a null sink and time them to the screen
+    int latency_clicks;   // Clicks measured by --latency-test
+    LogLevel log_level;   // Least severe message written
+    bool log_json;        // One JSON object per log line instead of "[Tag] text"
 } RavizConfig;
 
 // Initialize with defaults
 void config_init_defaults(RavizConfig *config);
 
-// Load from config file (creates default if missing)
-void config_load(RavizConfig *config);
+// Load from config file (creates default if missing). Returns 0 if the
+// file exists but does not parse; 'config' is then left untouched.
+int config_load(RavizConfig *config);
 
 // Parse CLI args (simple version)
 int config_parse_args(RavizConfig *config, int argc, char **argv);
 
+// Directory holding config.toml (~/.config/raviz). Returns 0 without $HOME.
+int config_dir(char *out, size_t size);
+
+// Rebuild a config the way startup does: defaults, then the file, then
+// the same command line, so CLI overrides keep winning. Returns 0 (and
+// leaves 'config' untouched) if the file does not parse or no longer
+// exists; unlike config_load it never creates one.
+int config_reload(RavizConfig *config, int argc, char **argv);
+
+// Non-zero if two optional strings (e.g. audio_device) differ.
+int config_str_changed(const char *a, const char *b);
+
+// The sources to capture: config->sources, or else the single
+// audio_device at unit gain, mixed. With input_file set (and no sources)
+// that one entry names the file instead. Returns the count.
+int config_audio_sources(const RavizConfig *config, AudioSource out[MAX_AUDIO_SOURCES]);
+
+// Config of extra window 'index' (into config->windows): the main config
+// with that window's scene, monitor and fps.
+void config_window(const RavizConfig *config, int index, RavizConfig *out);
+
+// Non-zero if some window shows the oscilloscope, which needs stereo
+// capture. Extra windows only count when not headless.
+int config_shows_scope(const RavizConfig *config);
+
 #endif
@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L
+#include "log.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define LOG_MAX_THREADS 32     // Threads that can hold a ring at once
+#define LOG_RING_ENTRIES 64    // Power of two
+#define LOG_TEXT_MAX 480       // Longer messages are truncated
+
+enum { RING_FREE, RING_OWNED, RING_CLOSED };
+
+typedef struct {
+    long ts_ns;             // CLOCK_REALTIME
+    const char *tag;
+    int level;
+    int suppressed;
+    char text[LOG_TEXT_MAX];
+} LogEntry;
+
+// Single producer (the owning thread), single consumer (the writer)
+typedef struct {
+    int state;
+    const char *name;
+    LogEntry *entries;
+    size_t write;
+    size_t read;
+    unsigned long dropped;  // Full-ring drops not yet reported
+} LogRing;
+
+static LogRing rings[LOG_MAX_THREADS];
+static Arena arena;
+static pthread_key_t ring_key;
+static pthread_t writer;
+static int wake_fd = -1;    // eventfd the writer sleeps on
+static int running;
+static int stopping;
+static int min_level = LOG_LEVEL_INFO;
+static int json_mode;
+static int data_on_stdout;
+static unsigned long unclaimed_drops;   // From threads that found no free ring
+
+static __thread LogRing *thread_ring;
+static __thread const char *thread_name;
+
+static const char *level_names[] = { "debug", "info", "warn", "error" };
+
+static long now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c == '\n') fputs("\\n", f);
+        else if (c == '\t') fputs("\\t", f);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void emit(int level, const char *tag, const char *thread, long ts_ns, int suppressed, const char *text) {
+    FILE *f = level >= LOG_LEVEL_WARN || data_on_stdout ? stderr : stdout;
+    if (__atomic_load_n(&json_mode, __ATOMIC_RELAXED)) {
+        fprintf(f, "{\"ts\":%ld.%06ld,\"level\":\"%s\"", ts_ns / 1000000000L,
+                (ts_ns % 1000000000L) / 1000, level_names[level]);
+        if (tag) { fputs(",\"tag\":", f); json_string(f, tag); }
+        if (thread) { fputs(",\"thread\":", f); json_string(f, thread); }
+        fputs(",\"msg\":", f);
+        json_string(f, text);
+        if (suppressed) fprintf(f, ",\"suppressed\":%d", suppressed);
+        fputs("}\n", f);
+    } else {
+        if (tag) fprintf(f, "[%s] ", tag);
+        fputs(text, f);
+        if (suppressed) fprintf(f, " (%d similar suppressed)", suppressed);
+        fputc('\n', f);
+    }
+}
+
+static void format_text(char *out, size_t size, const char *fmt, va_list ap) {
+    vsnprintf(out, size, fmt, ap);
+    size_t n = strlen(out);
+    while (n > 0 && out[n - 1] == '\n') out[--n] = '\0';
+}
+
+// Per-site limit. Returns 0 to drop; otherwise '*suppressed' is how many
+// were dropped since the site last got through.
+static int site_admit(LogSite *site, int *suppressed) {
+    long second = now_ns(CLOCK_MONOTONIC) / 1000000000L;
+    long window = __atomic_load_n(&site->window, __ATOMIC_RELAXED);
+    if (window != second &&
+        __atomic_compare_exchange_n(&site->window, &window, second, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+    }
+    if (__atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) > LOG_RATE_LIMIT) {
+        __atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    *suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    return 1;
+}
+
+static void release_ring(void *p) {
+    LogRing *ring = p;
+    thread_ring = NULL;
+    __atomic_store_n(&ring->state, RING_CLOSED, __ATOMIC_RELEASE);
+}
+
+static LogRing* claim_ring(void) {
+    for (int i = 0; i < LOG_MAX_THREADS; i++) {
+        int expected = RING_FREE;
+        if (__atomic_compare_exchange_n(&rings[i].state, &expected, RING_OWNED, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            rings[i].name = thread_name;
+            pthread_setspecific(ring_key, &rings[i]);
+            return &rings[i];
+        }
+    }
+    return NULL;
+}
+
+// Write everything queued, oldest first across all rings, then recycle
+// the rings of threads that have exited.
+static void drain(void) {
+    size_t end[LOG_MAX_THREADS];
+    for (int i = 0; i < LOG_MAX_THREADS; i++) end[i] = __atomic_load_n(&rings[i].write, __ATOMIC_ACQUIRE);
+
+    for (;;) {
+        LogRing *next = NULL;
+        const LogEntry *oldest = NULL;
+        for (int i = 0; i < LOG_MAX_THREADS; i++) {
+            if (rings[i].read == end[i]) continue;
+            const LogEntry *e = &rings[i].entries[rings[i].read & (LOG_RING_ENTRIES - 1)];
+            if (!oldest || e->ts_ns < oldest->ts_ns) { oldest = e; next = &rings[i]; }
+        }
+        if (!next) break;
+
+        char label[16];
+        const char *thread = next->name;
+        if (!thread) {
+            snprintf(label, sizeof(label), "thread-%d", (int)(next - rings));
+            thread = label;
+        }
+        emit(oldest->level, oldest->tag, thread, oldest->ts_ns, oldest->suppressed, oldest->text);
+        __atomic_store_n(&next->read, next->read + 1, __ATOMIC_RELEASE);
+    }
+
+    unsigned long dropped = __atomic_exchange_n(&unclaimed_drops, 0, __ATOMIC_RELAXED);
+    for (int i = 0; i < LOG_MAX_THREADS; i++) {
+        LogRing *ring = &rings[i];
+        dropped += __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&ring->state, __ATOMIC_ACQUIRE) == RING_CLOSED &&
+            ring->read == __atomic_load_n(&ring->write, __ATOMIC_ACQUIRE)) {
+            ring->read = ring->write = 0;
+            ring->name = NULL;
+            __atomic_store_n(&ring->state, RING_FREE, __ATOMIC_RELEASE);
+        }
+    }
+    if (dropped) {
+        char text[64];
+        snprintf(text, sizeof(text), "%lu message(s) dropped, queue full", dropped);
+        emit(LOG_LEVEL_WARN, "Log", NULL, now_ns(CLOCK_REALTIME), 0, text);
+    }
+
+    if (!data_on_stdout) fflush(stdout);
+    fflush(stderr);
+}
+
+// Never blocks: the counter only saturates after 2^64 - 2 pokes
+static void wake_writer(void) {
+    uint64_t one = 1;
+    ssize_t n = write(wake_fd, &one, sizeof(one));
+    (void)n;
+}
+
+// Whether any ring holds entries the writer has not taken. The fence
+// pairs with the one in log_message: either the writer sees the new
+// entry here, or the producer sees the ring emptied and pokes it.
+static int pending(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < LOG_MAX_THREADS; i++) {
+        if (rings[i].read != __atomic_load_n(&rings[i].write, __ATOMIC_ACQUIRE)) return 1;
+    }
+    return 0;
+}
+
+// Sleeps until a producer fills an empty ring or log_shutdown pokes it,
+// so an idle process has an idle writer.
+static void* writer_func(void *arg) {
+    (void)arg;
+    for (;;) {
+        int stop = __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+        drain();
+        if (stop) return NULL;
+        if (pending()) continue;
+
+        struct pollfd pfd = { wake_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, -1) > 0) {
+            uint64_t count;
+            ssize_t n = read(wake_fd, &count, sizeof(count));
+            (void)n;
+        }
+    }
+}
+
+int log_init(LogLevel level, int json, int stdout_is_data) {
+    __atomic_store_n(&min_level, (int)level, __ATOMIC_RELAXED);
+    __atomic_store_n(&json_mode, json, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return 1;
+    data_on_stdout = stdout_is_data;
+
+    // Kept for the life of the process: a thread may still hold its ring
+    // after shutdown.
+    if (!arena.base) {
+        arena_reserve(&arena, sizeof(LogEntry) * LOG_RING_ENTRIES * LOG_MAX_THREADS);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0 || !arena_init(&arena) || pthread_key_create(&ring_key, release_ring) != 0) {
+            if (wake_fd >= 0) close(wake_fd);
+            wake_fd = -1;
+            arena_release(&arena);
+            return 0;
+        }
+        for (int i = 0; i < LOG_MAX_THREADS; i++) {
+            rings[i].entries = arena_alloc(&arena, sizeof(LogEntry) * LOG_RING_ENTRIES);
+        }
+        atexit(log_shutdown);
+    }
+
+    stopping = 0;
+    if (pthread_create(&writer, NULL, writer_func, NULL) != 0) return 0;
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void log_shutdown(void) {
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return;
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    wake_writer();
+    pthread_join(writer, NULL);
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    drain();    // Anything queued while the writer was finishing
+}
+
+void log_thread_name(const char *name) {
+    thread_name = name;
+    if (thread_ring) thread_ring->name = name;
+}
+
+int log_parse_level(const char *s, LogLevel *out) {
+    for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_ERROR; i++) {
+        if (strcmp(s, level_names[i]) == 0) {
+            *out = (LogLevel)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void log_message(LogLevel level, const char *tag, LogSite *site, const char *fmt, ...) {
+    if ((int)level < __atomic_load_n(&min_level, __ATOMIC_RELAXED)) return;
+    int suppressed = 0;
+    if (site && !site_admit(site, &suppressed)) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        char text[LOG_TEXT_MAX];
+        format_text(text, sizeof(text), fmt, ap);
+        va_end(ap);
+        emit(level, tag, thread_name, now_ns(CLOCK_REALTIME), suppressed, text);
+        return;
+    }
+
+    LogRing *ring = thread_ring;
+    if (!ring) ring = thread_ring = claim_ring();
+    if (!ring) {
+        va_end(ap);
+        if (__atomic_fetch_add(&unclaimed_drops, 1, __ATOMIC_RELAXED) == 0) wake_writer();
+        return;
+    }
+
+    size_t w = ring->write;
+    if (w - __atomic_load_n(&ring->read, __ATOMIC_ACQUIRE) >= LOG_RING_ENTRIES) {
+        va_end(ap);
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    LogEntry *e = &ring->entries[w & (LOG_RING_ENTRIES - 1)];
+    e->ts_ns = now_ns(CLOCK_REALTIME);
+    e->tag = tag;
+    e->level = level;
+    e->suppressed = suppressed;
+    format_text(e->text, sizeof(e->text), fmt, ap);
+    va_end(ap);
+    __atomic_store_n(&ring->write, w + 1, __ATOMIC_RELEASE);
+
+    // Only the entry that makes a ring non-empty wakes the writer; it
+    // drains the rest in the same pass
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->read, __ATOMIC_ACQUIRE) == w) wake_writer();
+}
@@ -0,0 +1,66 @@
+#ifndef LOG_H
+#define LOG_H
+
+// Diagnostics that never block the caller. Each thread formats into its
+// own lock-free ring; a background writer drains the rings in time order
+// and does the actual (possibly slow) stdout/stderr writes. A full ring
+// drops the message and counts it instead of waiting.
+//
+// Every call site is rate limited on its own: past LOG_RATE_LIMIT messages
+// in one second the rest are suppressed, and the next one written says how
+// many were.
+//
+// Usage: log_warn("Audio", "Cannot open %s", path). The tag must be a
+// string literal (or otherwise outlive the program); NULL prints the
+// message bare. Before log_init and after log_shutdown messages are
+// written directly.
+
+typedef enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+} LogLevel;
+
+#define LOG_RATE_LIMIT 10   // Messages per call site per second
+
+// Rate-limit state of one call site, kept in a static by the macros below
+typedef struct {
+    long window;        // Second the count belongs to
+    int count;
+    int suppressed;     // Dropped by the limit since the last one written
+} LogSite;
+
+// Start the writer thread. Text lines look like "[Tag] message"; with
+// 'json' each message is one JSON object per line instead. Debug and info
+// go to stdout, warnings and errors to stderr; with 'data_on_stdout'
+// (raw frames on "--output -") everything goes to stderr and stdout is
+// never written or flushed. Calling it again only changes the level and
+// format. Returns 0 if the writer cannot start (messages are then
+// written directly).
+int log_init(LogLevel level, int json, int data_on_stdout);
+
+// Write everything queued and stop the writer. Registered with atexit by
+// log_init, so only needed to flush earlier.
+void log_shutdown(void);
+
+// Name the calling thread in JSON output ("audio", "capture", ...).
+void log_thread_name(const char *name);
+
+// "debug", "info", "warn" or "error"; returns 0 for anything else.
+int log_parse_level(const char *s, LogLevel *out);
+
+void log_message(LogLevel level, const char *tag, LogSite *site, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#define LOG_AT(level, tag, ...) do { \
+        static LogSite log_site_; \
+        log_message(level, tag, &log_site_, __VA_ARGS__); \
+    } while (0)
+
+#define log_debug(tag, ...) LOG_AT(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#define log_info(tag, ...)  LOG_AT(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#define log_warn(tag, ...)  LOG_AT(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#define log_error(tag, ...) LOG_AT(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,66 @@
+#define _POSIX_C_SOURCE 199309L
+#include "perf.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/resource.h>
+
+static const char *stage_names[PERF_STAGES] = { "analysis", "update", "draw" };
+
+static long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void perf_start(PerfStats *perf) {
+    memset(perf, 0, sizeof(*perf));
+    perf->start_ns = now_ns();
+    perf->mark_ns = perf->start_ns;
+}
+
+void perf_mark(PerfStats *perf, PerfStage stage) {
+    long now = now_ns();
+    perf->stage_ns[stage] += now - perf->mark_ns;
+    perf->mark_ns = now;
+}
+
+void perf_skip(PerfStats *perf) {
+    perf->mark_ns = now_ns();
+}
+
+int perf_write_report(const PerfStats *perf, const char *path, double gpu_ms, long gpu_frames) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        log_error("Perf", "Cannot write %s: %s", path, strerror(errno));
+        return 0;
+    }
+
+    double seconds = (now_ns() - perf->start_ns) / 1e9;
+    long frames = perf->frames > 0 ? perf->frames : 1;
+    // ru_maxrss is in kilobytes on Linux
+    struct rusage usage;
+    long peak_rss_kb = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"frames\": %ld,\n", perf->frames);
+    fprintf(f, "  \"seconds\": %.3f,\n", seconds);
+    fprintf(f, "  \"fps\": %.2f,\n", seconds > 0 ? perf->frames / seconds : 0.0);
+    fprintf(f, "  \"cpu_ms\": {");
+    for (int s = 0; s < PERF_STAGES; ++s) {
+        fprintf(f, "%s\"%s\": %.4f", s ? ", " : " ", stage_names[s], perf->stage_ns[s] / 1e6 / frames);
+    }
+    fprintf(f, " },\n");
+    if (gpu_frames > 0) fprintf(f, "  \"gpu_ms\": %.4f,\n", gpu_ms / gpu_frames);
+    else fprintf(f, "  \"gpu_ms\": null,\n");
+    fprintf(f, "  \"peak_rss_kb\": %ld\n", peak_rss_kb);
+    fprintf(f, "}\n");
+
+    int ok = ferror(f) == 0;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) log_error("Perf", "Write to %s failed", path);
+    else log_info("Perf", "%ld frames in %.2f s, report in %s", perf->frames, seconds, path);
+    return ok;
+}
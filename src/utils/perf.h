@@ -0,0 +1,36 @@
+#ifndef PERF_H
+#define PERF_H
+
+// Per-stage timing for --perf-report. Stages are wall-clock time spent on
+// the CPU in each part of a frame; GPU time is measured by the renderer
+// and passed in when the report is written.
+
+typedef enum {
+    PERF_ANALYSIS,  // Sample read + FFT (or record lookup when replaying)
+    PERF_UPDATE,    // render_update: smoothing, simulation, uploads
+    PERF_DRAW,      // render_draw: command submission and readback
+    PERF_STAGES
+} PerfStage;
+
+typedef struct {
+    long stage_ns[PERF_STAGES];
+    long frames;
+    long start_ns;
+    long mark_ns;
+} PerfStats;
+
+// Reset the counters and start the wall clock.
+void perf_start(PerfStats *perf);
+
+// Charge the time since the previous mark (or perf_start) to 'stage'.
+void perf_mark(PerfStats *perf, PerfStage stage);
+
+// Drop the time since the previous mark, e.g. a deliberate sleep.
+void perf_skip(PerfStats *perf);
+
+// Write a JSON summary to 'path': frames, fps, mean CPU ms per frame and
+// stage, mean GPU ms per frame ('gpu_frames' < 1 if not measured) and peak
+// RSS. Returns 0 (and logs) on failure.
+int perf_write_report(const PerfStats *perf, const char *path, double gpu_ms, long gpu_frames);
+
+#endif
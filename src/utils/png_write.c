@@ -0,0 +1,130 @@
+#include "png_write.h"
+#include <stdio.h>
+#include <string.h>
+
+// Minimal PNG encoder: no compression, so no zlib dependency. Frames are
+// meant to be piped into an encoder, where size on disk doesn't matter.
+
+static uint32_t crc_table[256];
+static int crc_table_ready = 0;
+
+static void crc_init(void) {
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+    crc_table_ready = 1;
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; ++i) crc = crc_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+typedef struct {
+    FILE *f;
+    uint32_t crc;       // Running CRC of the current chunk
+    uint32_t adler_a;   // Running Adler-32 of the zlib payload
+    uint32_t adler_b;
+} PngWriter;
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void chunk_begin(PngWriter *w, const char *type, uint32_t length) {
+    uint8_t hdr[8];
+    put_u32(hdr, length);
+    memcpy(hdr + 4, type, 4);
+    fwrite(hdr, 1, 8, w->f);
+    w->crc = crc_update(0xFFFFFFFFu, hdr + 4, 4);
+}
+
+static void chunk_data(PngWriter *w, const uint8_t *data, size_t len) {
+    fwrite(data, 1, len, w->f);
+    w->crc = crc_update(w->crc, data, len);
+}
+
+static void chunk_end(PngWriter *w) {
+    uint8_t crc[4];
+    put_u32(crc, w->crc ^ 0xFFFFFFFFu);
+    fwrite(crc, 1, 4, w->f);
+}
+
+static void adler_update(PngWriter *w, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        w->adler_a = (w->adler_a + data[i]) % 65521;
+        w->adler_b = (w->adler_b + w->adler_a) % 65521;
+    }
+}
+
+int png_write_rgba(const char *path, const uint8_t *pixels, int width, int height, int stride, int flip_y) {
+    if (!crc_table_ready) crc_init();
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+
+    PngWriter w = { f, 0, 1, 0 };
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, 8, f);
+
+    uint8_t ihdr[13];
+    put_u32(ihdr, width);
+    put_u32(ihdr + 4, height);
+    ihdr[8] = 8;    // Bit depth
+    ihdr[9] = 6;    // RGBA
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    chunk_begin(&w, "IHDR", 13);
+    chunk_data(&w, ihdr, 13);
+    chunk_end(&w);
+
+    // zlib stream of stored blocks; each scanline (filter byte + pixels) is
+    // emitted as one or more blocks of at most 65535 bytes.
+    size_t row_bytes = (size_t)width * 4 + 1;
+    size_t blocks_per_row = (row_bytes + 65534) / 65535;
+    size_t idat_len = 2 + (size_t)height * (row_bytes + blocks_per_row * 5) + 4;
+
+    chunk_begin(&w, "IDAT", (uint32_t)idat_len);
+    static const uint8_t zlib_header[2] = { 0x78, 0x01 };
+    chunk_data(&w, zlib_header, 2);
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *row = pixels + (size_t)(flip_y ? height - 1 - y : y) * stride;
+        static const uint8_t filter_none = 0;
+        size_t remaining = row_bytes;
+        size_t offset = 0; // Offset within (filter byte + pixels)
+
+        while (remaining > 0) {
+            size_t n = remaining > 65535 ? 65535 : remaining;
+            int last = (y == height - 1) && (n == remaining);
+            uint8_t block[5] = { (uint8_t)last, n & 0xff, (n >> 8) & 0xff, ~n & 0xff, (~n >> 8) & 0xff };
+            chunk_data(&w, block, 5);
+
+            size_t written = 0;
+            if (offset == 0) {
+                chunk_data(&w, &filter_none, 1);
+                adler_update(&w, &filter_none, 1);
+                written = 1;
+            }
+            const uint8_t *src = row + (offset + written - 1);
+            chunk_data(&w, src, n - written);
+            adler_update(&w, src, n - written);
+
+            offset += n;
+            remaining -= n;
+        }
+    }
+
+    uint8_t adler[4];
+    put_u32(adler, (w.adler_b << 16) | w.adler_a);
+    chunk_data(&w, adler, 4);
+    chunk_end(&w);
+
+    chunk_begin(&w, "IEND", 0);
+    chunk_end(&w);
+
+    int err = ferror(f);
+    fclose(f);
+    return err ? -1 : 0;
+}
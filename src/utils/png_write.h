@@ -0,0 +1,11 @@
+#ifndef PNG_WRITE_H
+#define PNG_WRITE_H
+
+#include <stdint.h>
+
+// Write an 8-bit RGBA image as an uncompressed PNG (stored deflate blocks).
+// 'pixels' rows are 'stride' bytes apart; if 'flip_y' is set rows are
+// written bottom-up (OpenGL readback order). Returns 0 on success.
+int png_write_rgba(const char *path, const uint8_t *pixels, int width, int height, int stride, int flip_y);
+
+#endif
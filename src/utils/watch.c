@@ -0,0 +1,63 @@
+#include "watch.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+struct FileWatch {
+    int fd;
+};
+
+FileWatch* watch_init(void) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        log_error("Watch", "inotify_init1: %s", strerror(errno));
+        return NULL;
+    }
+
+    FileWatch *w = calloc(1, sizeof(FileWatch));
+    if (!w) {
+        close(fd);
+        return NULL;
+    }
+    w->fd = fd;
+    return w;
+}
+
+int watch_add(FileWatch *w, const char *dir) {
+    if (!w) return 0;
+    // Editors often save by writing a temp file and renaming it over the
+    // original, so IN_MOVED_TO matters as much as IN_CLOSE_WRITE.
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE;
+    if (inotify_add_watch(w->fd, dir, mask) < 0) {
+        log_error("Watch", "Cannot watch %s", dir);
+        return 0;
+    }
+    return 1;
+}
+
+int watch_poll(FileWatch *w) {
+    if (!w) return 0;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    // Several events usually arrive per save; report them as one change
+    while (read(w->fd, buf, sizeof(buf)) > 0) {
+        changed = 1;
+    }
+    return changed;
+}
+
+int watch_fd(const FileWatch *w) {
+    return w ? w->fd : -1;
+}
+
+void watch_cleanup(FileWatch *w) {
+    if (w) {
+        close(w->fd);
+        free(w);
+    }
+}
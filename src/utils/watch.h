@@ -0,0 +1,23 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+typedef struct FileWatch FileWatch;
+
+// Non-blocking inotify watcher over a set of directories.
+FileWatch* watch_init(void);
+
+// Watch 'dir' for files being written, renamed into place or
+// deleted. Returns 0 on failure.
+int watch_add(FileWatch *w, const char *dir);
+
+// Drain pending events without blocking. Returns 1 if anything changed
+// since the last call.
+int watch_poll(FileWatch *w);
+
+// The inotify descriptor, readable when watch_poll has something to
+// report (-1 for NULL), for callers that sleep in poll/epoll.
+int watch_fd(const FileWatch *w);
+
+void watch_cleanup(FileWatch *w);
+
+#endif
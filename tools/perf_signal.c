@@ -0,0 +1,109 @@
+// Deterministic test signals for the performance suite (RAVIZ_PERF_TESTS)
+// and the profile-guided build workload (cmake/PgoBuild.cmake).
+//
+//   raviz-perf-signal <beats|sweep> <seconds> <out.wav>
+//
+// beats: 128 BPM kick, off-beat hats and a bass line, i.e. the dense,
+//        transient-heavy spectrum a typical music source produces.
+// sweep: exponential sine sweep 20 Hz - 20 kHz, walking a single peak
+//        across every bin.
+// Writes 44.1 kHz 16-bit mono PCM. The same arguments always produce the
+// same bytes: noise comes from a fixed-seed LCG, not rand().
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define RATE 44100
+#define BPM 128.0
+
+static uint32_t lcg_state = 0x2545F491u;
+
+static float noise(void) {
+    lcg_state = lcg_state * 1664525u + 1013904223u;
+    return (float)(lcg_state >> 8) / (float)(1u << 23) - 1.0f;
+}
+
+static float beats(long n) {
+    double t = (double)n / RATE;
+    double beat = 60.0 / BPM;
+    double tb = fmod(t, beat);             // Time since the last beat
+    double th = fmod(t + beat / 2, beat);  // Time since the last off-beat
+
+    // Kick: pitch drops from 150 Hz to 50 Hz within the first 60 ms
+    double f = 50.0 + 100.0 * exp(-tb / 0.02);
+    double kick = sin(2.0 * M_PI * f * tb) * exp(-tb / 0.15);
+    double hat = noise() * exp(-th / 0.03);
+    // Bass: root and fifth alternating per bar, three harmonics
+    static const double notes[2] = { 55.0, 82.41 };
+    double bf = notes[(long)(t / (4 * beat)) % 2];
+    double bass = 0.0;
+    for (int h = 1; h <= 3; ++h) bass += sin(2.0 * M_PI * bf * h * t) / h;
+
+    return (float)(0.6 * kick + 0.2 * hat + 0.25 * bass);
+}
+
+static float sweep(long n, long total) {
+    const double f0 = 20.0, f1 = 20000.0;
+    double duration = (double)total / RATE;
+    double t = (double)n / RATE;
+    double k = log(f1 / f0) / duration;
+    // Phase is the integral of f0 * exp(k t)
+    return (float)(0.7 * sin(2.0 * M_PI * f0 * (exp(k * t) - 1.0) / k));
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = v; p[1] = v >> 8;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4 || (strcmp(argv[1], "beats") != 0 && strcmp(argv[1], "sweep") != 0) || atof(argv[2]) <= 0) {
+        printf("Usage: %s <beats|sweep> <seconds> <out.wav>\n", argv[0]);
+        return 1;
+    }
+    int is_sweep = strcmp(argv[1], "sweep") == 0;
+    long frames = (long)(atof(argv[2]) * RATE);
+
+    FILE *f = fopen(argv[3], "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot create %s\n", argv[3]);
+        return 1;
+    }
+
+    uint32_t data_bytes = (uint32_t)frames * 2;
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    put_u32(header + 4, 36 + data_bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_u32(header + 16, 16);
+    put_u16(header + 20, 1);          // PCM
+    put_u16(header + 22, 1);          // Mono
+    put_u32(header + 24, RATE);
+    put_u32(header + 28, RATE * 2);   // Byte rate
+    put_u16(header + 32, 2);          // Block align
+    put_u16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    put_u32(header + 40, data_bytes);
+    int ok = fwrite(header, sizeof(header), 1, f) == 1;
+
+    for (long n = 0; n < frames && ok; ++n) {
+        float v = is_sweep ? sweep(n, frames) : beats(n);
+        if (v > 1.0f) v = 1.0f;
+        if (v < -1.0f) v = -1.0f;
+        uint8_t sample[2];
+        put_u16(sample, (uint16_t)(int16_t)lrintf(v * 32767.0f));
+        ok = fwrite(sample, 2, 1, f) == 1;
+    }
+
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Write to %s failed\n", argv[3]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Example consumer of the raviz shared-memory spectrum feed.
+//
+//   raviz --publish &
+//   raviz-spectrum-reader [--name /raviz-spectrum] [--count N]
+//
+// Prints one line per analysis hop: sequence number, hops missed since the
+// previous line, band energies, a beat marker and a coarse bar graph.
+#define _POSIX_C_SOURCE 200809L
+#include "raviz/spectrum_shm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define GRAPH_COLUMNS 32
+
+static void print_frame(const RavizAnalysisFrame *f, uint64_t missed) {
+    static const char levels[] = " .:-=+*#%@";
+    char graph[GRAPH_COLUMNS + 1];
+
+    int per_col = (int)(f->num_bins + GRAPH_COLUMNS - 1) / GRAPH_COLUMNS;
+    if (per_col < 1) per_col = 1;
+    int cols = 0;
+    for (uint32_t i = 0; i < f->num_bins && cols < GRAPH_COLUMNS; i += per_col) {
+        float peak = 0.0f;
+        for (uint32_t j = i; j < i + per_col && j < f->num_bins; ++j) {
+            if (f->bins[j] > peak) peak = f->bins[j];
+        }
+        int level = (int)(peak * (sizeof(levels) - 2) + 0.5f);
+        if (level < 0) level = 0;
+        if (level > (int)sizeof(levels) - 2) level = (int)sizeof(levels) - 2;
+        graph[cols++] = levels[level];
+    }
+    graph[cols] = '\0';
+
+    printf("%8llu +%-3llu low %.2f mid %.2f high %.2f  %s  |%s|\n",
+           (unsigned long long)f->seq, (unsigned long long)missed,
+           f->bands[RAVIZ_BAND_LOW], f->bands[RAVIZ_BAND_MID], f->bands[RAVIZ_BAND_HIGH],
+           (f->flags & RAVIZ_FRAME_BEAT) ? "BEAT" : "    ", graph);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    const char *name = RAVIZ_SHM_DEFAULT_NAME;
+    long count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        } else {
+            printf("Usage: %s [--name <shm name>] [--count <frames>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const RavizSpectrumShm *shm = raviz_shm_open(name);
+    if (!shm) {
+        fprintf(stderr, "No raviz feed at %s (is raviz running with --publish?)\n", name);
+        return 1;
+    }
+
+    // Polling is a plain memory read; the sleep only keeps this sample
+    // from spinning a core. Hops arrive every fft_size / sample_rate
+    // seconds (both in the frame), e.g. 11.6 ms for 512 at 44.1 kHz.
+    RavizAnalysisFrame frame;
+    uint64_t last_seq = 0;
+    long printed = 0;
+    struct timespec poll = {0, 1000000};
+    while (count == 0 || printed < count) {
+        if (raviz_shm_read(shm, &frame) && frame.seq != last_seq) {
+            // A restarted publisher counts from 1 again
+            uint64_t missed = (last_seq && frame.seq > last_seq) ? frame.seq - last_seq - 1 : 0;
+            print_frame(&frame, missed);
+            last_seq = frame.seq;
+            printed++;
+        }
+        nanosleep(&poll, NULL);
+    }
+
+    raviz_shm_close(shm);
+    return 0;
+}